@@ -1,13 +1,13 @@
 #include "AuthService.h"
 #include "DatabaseService.h"
 #include "JsonService.h"
+#include "Logger.h"
 #include <random>
 #include <sstream>
 #include <functional>
 #include <chrono>
 #include <iomanip>
 #include <regex>
-#include <iostream>
 
 AuthService::AuthService() {
     dbService = std::make_unique<DatabaseService>();
@@ -149,7 +149,7 @@ std::string AuthService::registerUser(const std::string& email, const std::strin
     responseData["email"] = user["email"];
     responseData["expiresAt"] = expiresAt;
     
-    std::cout << "✅ Новый пользователь зарегистрирован: " << email << std::endl;
+    LOG_INFO("Auth") << "✅ Новый пользователь зарегистрирован: " << email;
     
     return JsonService::createResponse(true, "Пользователь успешно зарегистрирован", responseData);
 }
@@ -188,7 +188,7 @@ std::string AuthService::loginUser(const std::string& email, const std::string&
     responseData["expiresAt"] = expiresAt;
     responseData["lastLogin"] = user["last_login"];
     
-    std::cout << "✅ Пользователь вошел в систему: " << email << std::endl;
+    LOG_INFO("Auth") << "✅ Пользователь вошел в систему: " << email;
     
     return JsonService::createResponse(true, "Вход выполнен успешно", responseData);
 }
@@ -0,0 +1,61 @@
+#ifndef CALCULATIONMETHODS_H
+#define CALCULATIONMETHODS_H
+
+// Параметры методов расчета и мазхабов как constexpr-таблицы.
+// Индекс в METHODS - номер метода в API (параметр method), поэтому новые методы
+// добавляются только в конец. PrayerTimesCalculator инстанцирует ядро расчета дня
+// для каждой пары (метод, мазхаб), так что новый метод - это одна строка таблицы.
+namespace CalculationMethods {
+
+struct MethodTraits {
+    const char* name;
+    int aladhanCode;       // Номер метода в Aladhan API (для сверки)
+    double fajrAngle;      // Градусы под горизонтом
+    double ishaAngle;      // Не используется, если задан ishaMinutes
+    double ishaMinutes;    // > 0: Иша = Магриб + интервал (минуты)
+    // Поправки к итоговым временам в минутах: fajr, sunrise, dhuhr, asr, maghrib, isha
+    double offsets[6];
+};
+
+struct MadhhabTraits {
+    const char* name;
+    double asrFactor;      // Длина тени для Аср: 1 - Shafi'i, 2 - Hanafi
+};
+
+inline constexpr MethodTraits METHODS[] = {
+    {"MWL", 3, 18.0, 17.0, 0.0, {0, 0, 0, 0, 0, 0}},                       // 0: Muslim World League
+    {"ISNA", 2, 15.0, 15.0, 0.0, {0, 0, 0, 0, 0, 0}},                      // 1: Islamic Society of North America
+    {"Egypt", 5, 19.5, 17.5, 0.0, {0, 0, 0, 0, 0, 0}},                     // 2: Egyptian General Authority of Survey
+    {"Makkah", 4, 18.5, 0.0, 90.0, {0, 0, 0, 0, 0, 0}},                    // 3: Umm al-Qura University
+    {"Karachi", 1, 18.0, 18.0, 0.0, {0, 0, 0, 0, 0, 0}},                   // 4: University of Islamic Sciences
+    {"Tehran", 7, 17.7, 14.0, 0.0, {0, 0, 0, 0, 0, 0}},                    // 5: Institute of Geophysics
+    {"Kuwait", 9, 18.0, 17.5, 0.0, {0, 0, 0, 0, 0, 0}},                    // 6
+    {"Qatar", 10, 18.0, 0.0, 90.0, {0, 0, 0, 0, 0, 0}},                    // 7
+    {"Singapore", 11, 20.0, 18.0, 0.0, {0, 0, 0, 0, 0, 0}},                // 8: MUIS
+    {"Turkey", 13, 18.0, 17.0, 0.0, {0, -7, 5, 4, 7, 0}},                  // 9: Diyanet (temkin)
+    {"Dubai", 16, 18.2, 18.2, 0.0, {0, -3, 3, 3, 3, 0}},                   // 10
+    {"France", 12, 12.0, 12.0, 0.0, {0, 0, 0, 0, 0, 0}},                   // 11: UOIF
+    {"Russia", 14, 16.0, 15.0, 0.0, {0, 0, 0, 0, 0, 0}},                   // 12: ДУМ России
+};
+
+inline constexpr MadhhabTraits MADHHABS[] = {
+    {"Shafi'i", 1.0},  // 0
+    {"Hanafi", 2.0},   // 1
+};
+
+inline constexpr int METHOD_COUNT = sizeof(METHODS) / sizeof(METHODS[0]);
+inline constexpr int MADHHAB_COUNT = sizeof(MADHHABS) / sizeof(MADHHABS[0]);
+inline constexpr int DEFAULT_METHOD = 3;  // Makkah
+
+// Неизвестный метод - метод по умолчанию, неизвестный мазхаб - Shafi'i
+constexpr int normalizeMethod(int method) {
+    return (method >= 0 && method < METHOD_COUNT) ? method : DEFAULT_METHOD;
+}
+
+constexpr int normalizeMadhhab(int madhhab) {
+    return madhhab == 1 ? 1 : 0;
+}
+
+}  // namespace CalculationMethods
+
+#endif // CALCULATIONMETHODS_H
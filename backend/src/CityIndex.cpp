@@ -0,0 +1,981 @@
+#include "CityIndex.h"
+#include "Logger.h"
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+#include <filesystem>
+#include <limits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char MAGIC[8] = {'J', 'P', 'C', 'I', 'T', 'I', 'D', 'X'};
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// Текущий снимок: читается и заменяется через std::atomic_load/atomic_store
+std::shared_ptr<const CityIndex> s_current;
+
+std::mutex s_watchMutex;
+std::condition_variable s_watchWake;
+std::thread s_watchThread;
+bool s_watchRunning = false;
+
+// Латиница U+00C0..U+00FF и U+0100..U+017F без диакритики ('*' - не буква)
+const char LATIN1_BASE[] = "aaaaaaaceeeeiiiidnooooo*ouuuuyts"
+                           "aaaaaaaceeeeiiiidnooooo*ouuuuyty";
+const char LATIN_EXT_A_BASE[] = "aaaaaaccccccccddddeeeeeeeeeegggggggghhhhiiiiiiiiiiiijjkkkllllllllll"
+                                "nnnnnnnnnoooooooorrrrrrsssssssstttttt"
+                                "uuuuuuuuuuuuwwyyyzzzzzzs";
+static_assert(sizeof(LATIN1_BASE) == 64 + 1, "U+00C0..U+00FF");
+static_assert(sizeof(LATIN_EXT_A_BASE) == 128 + 1, "U+0100..U+017F");
+
+// Транслитерация строчной кириллицы U+0430..U+045F (как в названиях GeoNames: "kh", "ts")
+const char* const CYRILLIC_LATIN[] = {
+    "a", "b", "v", "g", "d", "e", "zh", "z", "i", "y", "k", "l", "m", "n", "o", "p",
+    "r", "s", "t", "u", "f", "kh", "ts", "ch", "sh", "shch", "", "y", "", "e", "yu", "ya",
+    "e", "e", "dj", "g", "ye", "dz", "i", "yi", "j", "lj", "nj", "c", "k", "i", "u", "dz"};
+static_assert(sizeof(CYRILLIC_LATIN) / sizeof(CYRILLIC_LATIN[0]) == 0x30, "U+0430..U+045F");
+
+// Арабские буквы U+0621..U+064A после normalize(); краткие гласные на письме не
+// передаются, их восстанавливает нечеткий поиск
+const char* const ARABIC_LATIN[] = {
+    "", "a", "a", "u", "i", "y", "a", "b", "a", "t", "th", "j", "h", "kh", "d", "dh",
+    "r", "z", "s", "sh", "s", "d", "t", "z", "", "gh", "", "", "", "", "", "",
+    "f", "q", "k", "l", "m", "n", "h", "w", "a", "y"};
+static_assert(sizeof(ARABIC_LATIN) / sizeof(ARABIC_LATIN[0]) == 0x2A, "U+0621..U+064A");
+
+const double EARTH_RADIUS_KM = 6371.0088;
+const double DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+
+// Расстояние по большому кругу (гаверсинус)
+double distanceKm(double lat1, double lon1, double lat2, double lon2) {
+    const double dLat = (lat2 - lat1) * DEG_TO_RAD;
+    const double dLon = (lon2 - lon1) * DEG_TO_RAD;
+    const double a = std::sin(dLat / 2) * std::sin(dLat / 2) +
+                     std::cos(lat1 * DEG_TO_RAD) * std::cos(lat2 * DEG_TO_RAD) * std::sin(dLon / 2) * std::sin(dLon / 2);
+    return 2.0 * EARTH_RADIUS_KM * std::asin(std::min(1.0, std::sqrt(a)));
+}
+
+// Ячейка сетки; ее строка и столбец - row * GRID_COLS + col
+size_t cellOf(double latitude, double longitude, int degrees, int rows, int cols) {
+    const int row = std::clamp(static_cast<int>(std::floor((latitude + 90.0) / degrees)), 0, rows - 1);
+    const int col = std::clamp(static_cast<int>(std::floor((longitude + 180.0) / degrees)), 0, cols - 1);
+    return static_cast<size_t>(row) * cols + col;
+}
+
+// Смещения разделов файла; разделы идут подряд в порядке полей
+struct Layout {
+    uint64_t cities;
+    uint64_t names;
+    uint64_t variants;
+    uint64_t cellStart;
+    uint64_t trigrams;
+    uint64_t postings;
+    uint64_t timezones;
+    uint64_t strings;
+    uint64_t size;
+};
+
+Layout layoutOf(const CityIndex::Header& header, size_t cellCount) {
+    Layout layout{};
+    layout.cities = sizeof(CityIndex::Header);
+    layout.names = layout.cities + static_cast<uint64_t>(header.cityCount) * sizeof(CityIndex::CityRecord);
+    layout.variants = layout.names + static_cast<uint64_t>(header.nameCount) * sizeof(CityIndex::NameRecord);
+    layout.cellStart = layout.variants + static_cast<uint64_t>(header.variantCount) * sizeof(CityIndex::VariantRecord);
+    layout.trigrams = layout.cellStart + (cellCount + 1) * sizeof(uint32_t);
+    layout.postings = layout.trigrams + (static_cast<uint64_t>(header.trigramCount) + 1) * sizeof(CityIndex::TrigramRecord);
+    layout.timezones = layout.postings + static_cast<uint64_t>(header.postingCount) * sizeof(uint32_t);
+    layout.strings = layout.timezones + static_cast<uint64_t>(header.timezoneCount) * sizeof(CityIndex::StringRef);
+    layout.size = layout.strings + header.stringPoolSize;
+    return layout;
+}
+
+// Поля строки через разделитель, без копирования
+std::vector<std::string_view> split(std::string_view line, char separator) {
+    std::vector<std::string_view> fields;
+    size_t start = 0;
+    while (true) {
+        const size_t end = line.find(separator, start);
+        fields.push_back(line.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start));
+        if (end == std::string_view::npos) break;
+        start = end + 1;
+    }
+    return fields;
+}
+
+// Справочник GeoNames "код<TAB>...": строки с '#' - комментарии
+std::unordered_map<std::string, std::string> loadNames(const std::filesystem::path& path, size_t nameColumn) {
+    std::unordered_map<std::string, std::string> names;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        if (line.back() == '\r') line.pop_back();
+        const auto fields = split(line, '\t');
+        if (fields.size() <= nameColumn || fields[nameColumn].empty()) continue;
+        names.emplace(std::string(fields[0]), std::string(fields[nameColumn]));
+    }
+    return names;
+}
+
+// Коды аэропортов и т.п. среди альтернативных названий ("MOW", "LED")
+bool isCode(std::string_view name) {
+    if (name.size() > 4) return false;
+    return std::all_of(name.begin(), name.end(), [](char c) { return c >= 'A' && c <= 'Z'; });
+}
+
+// Пул строк файла: одинаковые строки (страны, регионы, зоны, ключи) хранятся один раз
+class StringPool {
+public:
+    // false - пул превысил бы 4 ГБ (смещения 32-битные)
+    bool add(std::string_view text, uint32_t& offset) {
+        auto found = m_offsets.find(std::string(text));
+        if (found != m_offsets.end()) {
+            offset = found->second;
+            return true;
+        }
+        if (m_data.size() + text.size() > std::numeric_limits<uint32_t>::max()) return false;
+        offset = static_cast<uint32_t>(m_data.size());
+        m_data += text;
+        m_offsets.emplace(std::string(text), offset);
+        return true;
+    }
+    const std::string& data() const { return m_data; }
+
+private:
+    std::string m_data;
+    std::unordered_map<std::string, uint32_t> m_offsets;
+};
+
+} // namespace
+
+std::string CityIndex::normalize(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    bool space = false;  // Отложенный пробел: схлопываем подряд идущие и убираем по краям
+
+    auto append = [&out, &space](std::string_view piece) {
+        if (space && !out.empty()) out += ' ';
+        space = false;
+        out += piece;
+    };
+
+    for (size_t i = 0; i < text.size();) {
+        const unsigned char c = static_cast<unsigned char>(text[i]);
+
+        if (c < 0x80) {
+            ++i;
+            if (c >= 'A' && c <= 'Z') {
+                const char lower = static_cast<char>(c - 'A' + 'a');
+                append(std::string_view(&lower, 1));
+            } else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
+                append(std::string_view(reinterpret_cast<const char*>(&text[i - 1]), 1));
+            } else {
+                space = true;  // Пробелы, дефисы, апострофы, скобки
+            }
+            continue;
+        }
+
+        // Двухбайтовые последовательности UTF-8: латиница с диакритикой и кириллица
+        if ((c & 0xE0) == 0xC0 && i + 1 < text.size() && (static_cast<unsigned char>(text[i + 1]) & 0xC0) == 0x80) {
+            const unsigned cp = ((c & 0x1Fu) << 6) | (static_cast<unsigned char>(text[i + 1]) & 0x3Fu);
+            i += 2;
+            char base = 0;
+            if (cp >= 0xC0 && cp <= 0xFF) base = LATIN1_BASE[cp - 0xC0];
+            else if (cp >= 0x100 && cp <= 0x17F) base = LATIN_EXT_A_BASE[cp - 0x100];
+
+            if (base == '*') {
+                space = true;
+            } else if (base) {
+                if (cp == 0xDF) append("ss");
+                else if (cp == 0xC6 || cp == 0xE6) append("ae");
+                else append(std::string_view(&base, 1));
+            } else if (cp >= 0x400 && cp <= 0x45F) {
+                unsigned lower = cp;
+                if (cp == 0x401 || cp == 0x451) lower = 0x435;         // Ё, ё -> е
+                else if (cp >= 0x410 && cp <= 0x42F) lower = cp + 0x20;
+                else if (cp < 0x410) lower = cp + 0x50;
+                const char utf8[2] = {static_cast<char>(0xC0 | (lower >> 6)), static_cast<char>(0x80 | (lower & 0x3F))};
+                append(std::string_view(utf8, 2));
+            } else if (cp >= 0x600 && cp <= 0x6FF) {
+                // Арабское письмо: без огласовок и татвиля, варианты алифа - алиф,
+                // та марбута - ха, алиф максура - йа
+                if ((cp >= 0x64B && cp <= 0x65F) || cp == 0x640 || cp == 0x670) continue;
+                if (cp == 0x60C || cp == 0x61B || cp == 0x61F || cp == 0x6D4) {
+                    space = true;
+                    continue;
+                }
+                if (cp >= 0x660 && cp <= 0x669) {
+                    const char digit = static_cast<char>('0' + (cp - 0x660));
+                    append(std::string_view(&digit, 1));
+                    continue;
+                }
+                unsigned base = cp;
+                if (cp == 0x622 || cp == 0x623 || cp == 0x625 || cp == 0x671) base = 0x627;
+                else if (cp == 0x629) base = 0x647;
+                else if (cp == 0x649) base = 0x64A;
+                const char utf8[2] = {static_cast<char>(0xC0 | (base >> 6)), static_cast<char>(0x80 | (base & 0x3F))};
+                append(std::string_view(utf8, 2));
+            } else {
+                append(text.substr(i - 2, 2));
+            }
+            continue;
+        }
+
+        // Прочие символы (арабское письмо и т.п.) - как есть
+        size_t length = 1;
+        if ((c & 0xF0) == 0xE0) length = 3;
+        else if ((c & 0xF8) == 0xF0) length = 4;
+        length = std::min(length, text.size() - i);
+        append(text.substr(i, length));
+        i += length;
+    }
+    return out;
+}
+
+std::string CityIndex::transliterate(std::string_view normalized) {
+    std::string out;
+    out.reserve(normalized.size());
+    for (size_t i = 0; i < normalized.size();) {
+        const unsigned char c = static_cast<unsigned char>(normalized[i]);
+        if ((c & 0xE0) == 0xC0 && i + 1 < normalized.size() &&
+            (static_cast<unsigned char>(normalized[i + 1]) & 0xC0) == 0x80) {
+            const unsigned cp = ((c & 0x1Fu) << 6) | (static_cast<unsigned char>(normalized[i + 1]) & 0x3Fu);
+            const char* latin = nullptr;
+            if (cp >= 0x430 && cp <= 0x45F) latin = CYRILLIC_LATIN[cp - 0x430];
+            else if (cp >= 0x621 && cp <= 0x64A) latin = ARABIC_LATIN[cp - 0x621];
+            else if (cp == 0x67E) latin = "p";               // Персидские буквы
+            else if (cp == 0x686) latin = "ch";
+            else if (cp == 0x698) latin = "zh";
+            else if (cp == 0x6A9) latin = "k";
+            else if (cp == 0x6AF) latin = "g";
+            else if (cp == 0x6CC) latin = "y";
+            if (latin) {
+                out += latin;
+                i += 2;
+                continue;
+            }
+        }
+        out += normalized[i++];
+    }
+    return out;
+}
+
+bool CityIndex::build(const std::string& sourcePath, const std::string& path) {
+    std::ifstream in(sourcePath);
+    if (!in) {
+        LOG_ERROR("Cities") << "❌ Выгрузка GeoNames не найдена: " << sourcePath;
+        return false;
+    }
+
+    const std::filesystem::path directory = std::filesystem::path(sourcePath).parent_path();
+    const auto countries = loadNames(directory / "countryInfo.txt", 4);
+    const auto regions = loadNames(directory / "admin1CodesASCII.txt", 1);
+
+    StringPool pool;
+    std::vector<CityRecord> cities;
+    std::vector<NameRecord> names;
+    std::vector<StringRef> timezones;
+    std::unordered_map<std::string, uint16_t> timezoneIds;
+    const size_t lengthLimit = std::numeric_limits<uint16_t>::max();
+    bool overflow = false;
+
+    auto addString = [&](std::string_view text, uint32_t& offset, uint16_t& length) {
+        text = text.substr(0, lengthLimit);
+        length = static_cast<uint16_t>(text.size());
+        if (!pool.add(text, offset)) overflow = true;
+    };
+
+    auto addName = [&](std::string_view name, uint8_t rank) {
+        const std::string normalized = normalize(name);
+        if (normalized.size() < 2 || normalized.size() > lengthLimit || name.size() > lengthLimit) return;
+        NameRecord entry{};
+        entry.city = static_cast<uint32_t>(cities.size() - 1);
+        entry.rank = rank;
+        addString(normalized, entry.keyOffset, entry.keyLength);
+        addString(name, entry.nameOffset, entry.nameLength);
+        names.push_back(entry);
+    };
+
+    std::string line;
+    while (std::getline(in, line) && !overflow) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        const auto fields = split(line, '\t');
+        if (fields.size() < 15 || fields[6] != "P" || fields[1].empty()) continue;  // Только населенные пункты
+
+        CityRecord city{};
+        city.id = static_cast<uint32_t>(std::strtoul(std::string(fields[0]).c_str(), nullptr, 10));
+        city.latitude = std::strtod(std::string(fields[4]).c_str(), nullptr);
+        city.longitude = std::strtod(std::string(fields[5]).c_str(), nullptr);
+        city.population = std::strtoull(std::string(fields[14]).c_str(), nullptr, 10);
+        city.prior = static_cast<uint16_t>(std::lround(
+            std::min(1.0, std::log10(static_cast<double>(city.population) + 1.0) / 8.0) * PRIOR_MAX));
+
+        const std::string countryCode(fields[8].substr(0, sizeof(city.countryCode)));
+        std::memcpy(city.countryCode, countryCode.data(), countryCode.size());
+        auto country = countries.find(countryCode);
+        addString(country != countries.end() ? std::string_view(country->second) : std::string_view(countryCode),
+                  city.countryOffset, city.countryLength);
+        auto region = regions.find(countryCode + "." + std::string(fields[10]));
+        addString(region != regions.end() ? std::string_view(region->second) : std::string_view(),
+                  city.regionOffset, city.regionLength);
+        addString(fields[1], city.nameOffset, city.nameLength);
+
+        const std::string timezone(fields.size() > 17 ? fields[17] : std::string_view());
+        auto zone = timezoneIds.find(timezone);
+        if (zone == timezoneIds.end()) {
+            if (timezones.size() > std::numeric_limits<uint16_t>::max()) {
+                overflow = true;
+                break;
+            }
+            StringRef ref{};
+            if (!pool.add(timezone, ref.offset)) overflow = true;
+            ref.length = static_cast<uint32_t>(timezone.size());
+            zone = timezoneIds.emplace(timezone, static_cast<uint16_t>(timezones.size())).first;
+            timezones.push_back(ref);
+        }
+        city.timezone = zone->second;
+        cities.push_back(city);
+
+        addName(fields[1], 0);
+        addName(fields[2], 1);
+        for (std::string_view alternate : split(fields[3], ',')) {
+            if (!isCode(alternate)) addName(alternate, 2);
+        }
+    }
+
+    if (overflow || cities.size() > std::numeric_limits<uint32_t>::max() ||
+        names.size() > std::numeric_limits<uint32_t>::max()) {
+        LOG_ERROR("Cities") << "❌ Выгрузка слишком велика для формата индекса: " << sourcePath;
+        return false;
+    }
+    if (cities.empty()) {
+        LOG_ERROR("Cities") << "❌ В " << sourcePath << " нет городов";
+        return false;
+    }
+
+    // Города - по ячейкам сетки: обход ячейки читает записи подряд, а начала ячеек
+    // заменяют отдельный массив точек
+    std::vector<uint32_t> order(cities.size());
+    std::vector<size_t> cells(cities.size());
+    for (size_t i = 0; i < cities.size(); ++i) {
+        order[i] = static_cast<uint32_t>(i);
+        cells[i] = cellOf(cities[i].latitude, cities[i].longitude, GRID_DEGREES, GRID_ROWS, GRID_COLS);
+    }
+    std::sort(order.begin(), order.end(), [&cells, &cities](uint32_t a, uint32_t b) {
+        if (cells[a] != cells[b]) return cells[a] < cells[b];
+        return cities[a].id < cities[b].id;
+    });
+
+    std::vector<CityRecord> sorted(cities.size());
+    std::vector<uint32_t> position(cities.size());
+    std::vector<uint32_t> cellStart(GRID_CELLS + 1, 0);
+    for (size_t i = 0; i < order.size(); ++i) {
+        sorted[i] = cities[order[i]];
+        position[order[i]] = static_cast<uint32_t>(i);
+        ++cellStart[cells[order[i]] + 1];
+    }
+    for (size_t i = 0; i < GRID_CELLS; ++i) {
+        cellStart[i + 1] += cellStart[i];
+    }
+    for (NameRecord& entry : names) {
+        entry.city = position[entry.city];
+    }
+
+    // Ключ, затем город и ранг: одинаковые названия одного города остаются одной записью
+    const std::string& strings = pool.data();
+    auto keyOf = [&strings](const NameRecord& entry) {
+        return std::string_view(strings).substr(entry.keyOffset, entry.keyLength);
+    };
+    std::sort(names.begin(), names.end(), [&keyOf](const NameRecord& a, const NameRecord& b) {
+        const int compare = keyOf(a).compare(keyOf(b));
+        if (compare != 0) return compare < 0;
+        if (a.city != b.city) return a.city < b.city;
+        return a.rank < b.rank;
+    });
+    names.erase(std::unique(names.begin(), names.end(), [&keyOf](const NameRecord& a, const NameRecord& b) {
+        return a.city == b.city && keyOf(a) == keyOf(b);
+    }), names.end());
+
+    // Варианты для нечеткого поиска: названия, которые после транслитерации записаны
+    // латиницей (остальные письменности ищутся только по префиксу); одно написание на город
+    struct Variant {
+        std::string key;
+        uint32_t name;
+        uint32_t city;
+        uint8_t rank;
+    };
+    std::vector<Variant> variants;
+    for (size_t i = 0; i < names.size(); ++i) {
+        std::string folded = transliterate(keyOf(names[i]));
+        const bool latin = std::all_of(folded.begin(), folded.end(), [](char c) { return (c & 0x80) == 0; });
+        if (!latin || folded.size() < 2 || folded.size() > FUZZY_MAX_LENGTH) continue;
+        variants.push_back({std::move(folded), static_cast<uint32_t>(i), names[i].city, names[i].rank});
+    }
+    std::sort(variants.begin(), variants.end(), [](const Variant& a, const Variant& b) {
+        if (a.key != b.key) return a.key < b.key;
+        if (a.city != b.city) return a.city < b.city;
+        return a.rank < b.rank;
+    });
+    variants.erase(std::unique(variants.begin(), variants.end(), [](const Variant& a, const Variant& b) {
+        return a.city == b.city && a.key == b.key;
+    }), variants.end());
+
+    std::vector<VariantRecord> variantRecords;
+    std::vector<std::pair<uint32_t, uint32_t>> occurrences;  // Триграмма, вариант
+    variantRecords.reserve(variants.size());
+    for (const Variant& variant : variants) {
+        VariantRecord record{};
+        record.name = variant.name;
+        addString(variant.key, record.keyOffset, record.keyLength);
+        const uint32_t index = static_cast<uint32_t>(variantRecords.size());
+        variantRecords.push_back(record);
+
+        // Триграммы "^^ключ": начало слова отличается от середины
+        const std::string padded = "^^" + variant.key;
+        for (size_t i = 0; i + 2 < padded.size(); ++i) {
+            occurrences.emplace_back(trigramCode(static_cast<unsigned char>(padded[i]), static_cast<unsigned char>(padded[i + 1]),
+                                                 static_cast<unsigned char>(padded[i + 2])),
+                                     index);
+        }
+    }
+    std::sort(occurrences.begin(), occurrences.end());
+    occurrences.erase(std::unique(occurrences.begin(), occurrences.end()), occurrences.end());
+    if (overflow || occurrences.size() > std::numeric_limits<uint32_t>::max()) {
+        LOG_ERROR("Cities") << "❌ Выгрузка слишком велика для формата индекса: " << sourcePath;
+        return false;
+    }
+
+    std::vector<TrigramRecord> trigrams;
+    std::vector<uint32_t> postings;
+    postings.reserve(occurrences.size());
+    for (const auto& occurrence : occurrences) {
+        if (trigrams.empty() || trigrams.back().code != occurrence.first) {
+            trigrams.push_back({occurrence.first, static_cast<uint32_t>(postings.size())});
+        }
+        postings.push_back(occurrence.second);
+    }
+    const uint32_t trigramCount = static_cast<uint32_t>(trigrams.size());
+    trigrams.push_back({std::numeric_limits<uint32_t>::max(), static_cast<uint32_t>(postings.size())});
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.cityRecordSize = sizeof(CityRecord);
+    header.nameRecordSize = sizeof(NameRecord);
+    header.cityCount = static_cast<uint32_t>(sorted.size());
+    header.nameCount = static_cast<uint32_t>(names.size());
+    header.timezoneCount = static_cast<uint32_t>(timezones.size());
+    header.gridDegrees = GRID_DEGREES;
+    header.variantRecordSize = sizeof(VariantRecord);
+    header.variantCount = static_cast<uint32_t>(variantRecords.size());
+    header.trigramCount = trigramCount;
+    header.postingCount = static_cast<uint32_t>(postings.size());
+    header.stringPoolSize = strings.size();
+    header.builtAt = static_cast<int64_t>(std::time(nullptr));
+
+    std::filesystem::path target = path;
+    if (target.has_parent_path()) {
+        std::filesystem::create_directories(target.parent_path());
+    }
+
+    // Пишем во временный файл и переименовываем: работающие процессы продолжают читать
+    // старый файл и переходят на новый целиком
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            LOG_ERROR("Cities") << "❌ Не удалось создать " << tmpPath;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(sorted.data()),
+                  static_cast<std::streamsize>(sorted.size() * sizeof(CityRecord)));
+        out.write(reinterpret_cast<const char*>(names.data()),
+                  static_cast<std::streamsize>(names.size() * sizeof(NameRecord)));
+        out.write(reinterpret_cast<const char*>(variantRecords.data()),
+                  static_cast<std::streamsize>(variantRecords.size() * sizeof(VariantRecord)));
+        out.write(reinterpret_cast<const char*>(cellStart.data()),
+                  static_cast<std::streamsize>(cellStart.size() * sizeof(uint32_t)));
+        out.write(reinterpret_cast<const char*>(trigrams.data()),
+                  static_cast<std::streamsize>(trigrams.size() * sizeof(TrigramRecord)));
+        out.write(reinterpret_cast<const char*>(postings.data()),
+                  static_cast<std::streamsize>(postings.size() * sizeof(uint32_t)));
+        out.write(reinterpret_cast<const char*>(timezones.data()),
+                  static_cast<std::streamsize>(timezones.size() * sizeof(StringRef)));
+        out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+        if (!out) {
+            LOG_ERROR("Cities") << "❌ Ошибка записи " << tmpPath;
+            return false;
+        }
+    }
+    std::filesystem::rename(tmpPath, path);
+
+    LOG_INFO("Cities") << "✅ Индекс построен: " << path << " (городов " << sorted.size()
+                       << ", названий " << names.size() << ", вариантов " << variantRecords.size()
+                       << ", триграмм " << trigramCount << ", часовых поясов " << timezones.size()
+                       << ", стран " << countries.size() << ", регионов " << regions.size() << ")";
+    return true;
+}
+
+std::shared_ptr<const CityIndex> CityIndex::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG_WARN("Cities") << "⚠️ Индекс городов не найден: " << path << " (поиск через Nominatim)";
+        return nullptr;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        LOG_ERROR("Cities") << "❌ Некорректный файл индекса: " << path;
+        ::close(fd);
+        return nullptr;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("Cities") << "❌ Ошибка mmap: " << path;
+        return nullptr;
+    }
+
+    // Проверяется только заголовок и размеры разделов: загрузка не зависит от размера
+    // индекса, а ссылки на строки проверяются при чтении
+    std::shared_ptr<CityIndex> index(new CityIndex());
+    index->m_mapping = mapping;
+    index->m_mappingSize = size;
+    std::memcpy(&index->m_header, mapping, sizeof(Header));
+    const Header& header = index->m_header;
+    const Layout layout = layoutOf(header, GRID_CELLS);
+    const char* base = static_cast<const char*>(mapping);
+
+    bool valid = std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 header.version == VERSION &&
+                 header.byteOrder == BYTE_ORDER_MARK &&
+                 header.cityRecordSize == sizeof(CityRecord) &&
+                 header.nameRecordSize == sizeof(NameRecord) &&
+                 header.variantRecordSize == sizeof(VariantRecord) &&
+                 header.gridDegrees == GRID_DEGREES &&
+                 size == layout.size;
+    if (valid) {
+        index->m_cellStart = reinterpret_cast<const uint32_t*>(base + layout.cellStart);
+        index->m_trigrams = reinterpret_cast<const TrigramRecord*>(base + layout.trigrams);
+        valid = index->m_cellStart[GRID_CELLS] == header.cityCount &&
+                index->m_trigrams[header.trigramCount].start == header.postingCount;
+    }
+    if (!valid) {
+        LOG_ERROR("Cities") << "❌ Неподдерживаемый формат или версия индекса: " << path
+                            << " (соберите его утилитой build_city_index)";
+        return nullptr;
+    }
+
+    index->m_cities = reinterpret_cast<const CityRecord*>(base + layout.cities);
+    index->m_names = reinterpret_cast<const NameRecord*>(base + layout.names);
+    index->m_variants = reinterpret_cast<const VariantRecord*>(base + layout.variants);
+    index->m_postings = reinterpret_cast<const uint32_t*>(base + layout.postings);
+    index->m_timezones = reinterpret_cast<const StringRef*>(base + layout.timezones);
+    index->m_strings = base + layout.strings;
+    index->m_device = static_cast<uint64_t>(st.st_dev);
+    index->m_inode = static_cast<uint64_t>(st.st_ino);
+    index->m_modified = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+
+    char built[32] = "?";
+    const std::time_t builtAt = static_cast<std::time_t>(header.builtAt);
+    std::tm tm{};
+    if (gmtime_r(&builtAt, &tm)) std::strftime(built, sizeof(built), "%Y-%m-%d %H:%M UTC", &tm);
+    LOG_INFO("Cities") << "✅ Индекс городов загружен: " << path << " (городов " << header.cityCount
+                       << ", названий " << header.nameCount << ", " << size / 1024 << " КБ, построен "
+                       << built << ")";
+    return index;
+}
+
+CityIndex::~CityIndex() {
+    if (m_mapping != nullptr) {
+        munmap(m_mapping, m_mappingSize);
+    }
+}
+
+bool CityIndex::load(const std::string& path) {
+    std::shared_ptr<const CityIndex> index = open(path);
+    if (!index) return false;
+    std::atomic_store(&s_current, std::move(index));
+    return true;
+}
+
+std::shared_ptr<const CityIndex> CityIndex::current() {
+    return std::atomic_load(&s_current);
+}
+
+bool CityIndex::reloadIfChanged(const std::string& path) {
+    struct stat st{};
+    if (::stat(path.c_str(), &st) != 0) return false;  // Файла нет - остается текущий снимок
+
+    const std::shared_ptr<const CityIndex> loaded = current();
+    const int64_t modified = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    if (loaded && loaded->m_device == static_cast<uint64_t>(st.st_dev) &&
+        loaded->m_inode == static_cast<uint64_t>(st.st_ino) && loaded->m_modified == modified &&
+        loaded->m_mappingSize == static_cast<size_t>(st.st_size)) {
+        return false;
+    }
+
+    LOG_INFO("Cities") << "🔄 Файл индекса заменен, загружаем заново: " << path;
+    return load(path);
+}
+
+void CityIndex::watchLoop(std::string path, int intervalSeconds) {
+    std::unique_lock<std::mutex> lock(s_watchMutex);
+    while (s_watchRunning) {
+        s_watchWake.wait_for(lock, std::chrono::seconds(intervalSeconds));
+        if (!s_watchRunning) break;
+        lock.unlock();
+        reloadIfChanged(path);
+        lock.lock();
+    }
+}
+
+void CityIndex::startWatching(const std::string& path, int intervalSeconds) {
+    std::lock_guard<std::mutex> lock(s_watchMutex);
+    if (s_watchRunning) return;
+    s_watchRunning = true;
+    s_watchThread = std::thread(&CityIndex::watchLoop, path, intervalSeconds > 0 ? intervalSeconds : 60);
+}
+
+void CityIndex::stopWatching() {
+    {
+        std::lock_guard<std::mutex> lock(s_watchMutex);
+        s_watchRunning = false;
+    }
+    s_watchWake.notify_all();
+    if (s_watchThread.joinable()) s_watchThread.join();
+}
+
+CityIndex::City CityIndex::city(uint32_t index) const {
+    const CityRecord& record = m_cities[index];
+    City city;
+    city.id = record.id;
+    city.latitude = record.latitude;
+    city.longitude = record.longitude;
+    city.population = record.population;
+    city.name = text(record.nameOffset, record.nameLength);
+    city.countryCode = std::string_view(record.countryCode, record.countryCode[0] == '\0' ? 0 :
+                                                            record.countryCode[1] == '\0' ? 1 : 2);
+    city.country = text(record.countryOffset, record.countryLength);
+    city.region = text(record.regionOffset, record.regionLength);
+    if (record.timezone < m_header.timezoneCount) {
+        const StringRef& zone = m_timezones[record.timezone];
+        city.timezone = text(zone.offset, zone.length);
+    }
+    return city;
+}
+
+// Кандидат поиска: выше - точные совпадения, затем меньшая стоимость
+struct CityIndex::Candidate {
+    bool exact;
+    int cost;
+    uint8_t rank;
+    uint32_t city;
+    uint32_t name;              // Номер NameRecord
+};
+
+// Лучшие limit кандидатов по убыванию; не больше одного кандидата на город
+class CityIndex::TopMatches {
+public:
+    explicit TopMatches(size_t limit) : m_limit(limit) { m_best.reserve(limit + 1); }
+
+    static bool better(const Candidate& a, const Candidate& b) {
+        if (a.exact != b.exact) return a.exact;
+        if (a.cost != b.cost) return a.cost < b.cost;
+        return a.rank < b.rank;
+    }
+
+    // Большинство кандидатов отсекается сравнением с последним, не доходя до поиска дубликата
+    void add(const Candidate& candidate) {
+        if (m_best.size() == m_limit && !better(candidate, m_best.back())) return;
+
+        // Город уже в списке под другим названием: остается лучшее из двух
+        auto same = std::find_if(m_best.begin(), m_best.end(),
+                                 [&candidate](const Candidate& other) { return other.city == candidate.city; });
+        if (same != m_best.end()) {
+            if (!better(candidate, *same)) return;
+            m_best.erase(same);
+        }
+        m_best.insert(std::upper_bound(m_best.begin(), m_best.end(), candidate, better), candidate);
+        if (m_best.size() > m_limit) m_best.pop_back();
+    }
+
+    const std::vector<Candidate>& best() const { return m_best; }
+
+private:
+    size_t m_limit;
+    std::vector<Candidate> m_best;
+};
+
+void CityIndex::editDistance(std::string_view query, std::string_view key, int maxEdits,
+                             int& prefixDistance, int& fullDistance) {
+    const int over = maxEdits + 1;
+    const int m = static_cast<int>(query.size());
+    const int n = std::min(static_cast<int>(key.size()), m + maxEdits);  // Дальше префиксы заведомо хуже
+    prefixDistance = over;
+    fullDistance = over;
+
+    // Строки матрицы по символам запроса, столбцы - по символам key; вне полосы - over.
+    // Перестановка соседних символов - одна правка (нужна строка i - 2)
+    int rows[3][FUZZY_MAX_LENGTH + 4];
+    int* beforePrevious = rows[0];
+    int* previous = rows[1];
+    int* current = rows[2];
+    for (int j = 0; j <= n; ++j) previous[j] = std::min(j, over);
+
+    for (int i = 1; i <= m; ++i) {
+        const int from = std::max(1, i - maxEdits);
+        const int to = std::min(n, i + maxEdits);
+        current[from - 1] = from == 1 ? std::min(i, over) : over;
+        int rowMin = current[from - 1];
+        for (int j = from; j <= to; ++j) {
+            int value = previous[j - 1] + (query[i - 1] != key[j - 1] ? 1 : 0);
+            value = std::min(value, previous[j] + 1);
+            value = std::min(value, current[j - 1] + 1);
+            if (i > 1 && j > 1 && query[i - 1] == key[j - 2] && query[i - 2] == key[j - 1]) {
+                value = std::min(value, beforePrevious[j - 2] + 1);
+            }
+            current[j] = std::min(value, over);
+            rowMin = std::min(rowMin, current[j]);
+        }
+        if (to < n) current[to + 1] = over;
+        if (rowMin >= over) return;
+        int* reused = beforePrevious;
+        beforePrevious = previous;
+        previous = current;
+        current = reused;
+    }
+
+    for (int j = std::max(0, m - maxEdits); j <= n; ++j) {
+        prefixDistance = std::min(prefixDistance, previous[j]);
+    }
+    const int length = static_cast<int>(key.size());
+    if (length <= n && length >= m - maxEdits) fullDistance = previous[length];
+}
+
+void CityIndex::searchPrefix(std::string_view prefix, TopMatches& top) const {
+    const NameRecord* end = m_names + m_header.nameCount;
+    const NameRecord* it = std::lower_bound(m_names, end, prefix,
+                                            [this](const NameRecord& entry, std::string_view value) { return key(entry) < value; });
+    for (; it != end; ++it) {
+        const std::string_view entryKey = key(*it);
+        if (entryKey.compare(0, prefix.size(), prefix) != 0) break;
+        if (it->city >= m_header.cityCount) continue;
+
+        const bool complete = entryKey.size() == prefix.size();
+        top.add({complete, (complete ? 0 : PREFIX_COST) - m_cities[it->city].prior, it->rank, it->city,
+                 static_cast<uint32_t>(it - m_names)});
+    }
+}
+
+void CityIndex::searchVariants(std::string_view folded, TopMatches& top) const {
+    const VariantRecord* end = m_variants + m_header.variantCount;
+    const VariantRecord* it = std::lower_bound(m_variants, end, folded,
+                                               [this](const VariantRecord& variant, std::string_view value) { return key(variant) < value; });
+    for (; it != end; ++it) {
+        const std::string_view variantKey = key(*it);
+        if (variantKey.compare(0, folded.size(), folded) != 0) break;
+        if (it->name >= m_header.nameCount) continue;
+        const NameRecord& name = m_names[it->name];
+        if (name.city >= m_header.cityCount) continue;
+
+        const bool complete = variantKey.size() == folded.size();
+        top.add({complete, (complete ? 0 : PREFIX_COST) - m_cities[name.city].prior, name.rank, name.city, it->name});
+    }
+}
+
+void CityIndex::searchFuzzy(std::string_view folded, TopMatches& top) const {
+    const int edits = maxEdits(folded.size());
+
+    // Триграммы запроса без повторов; у варианта в пределах edits правок от запроса
+    // их общих не меньше count - 4 * edits (перестановка задевает до четырех)
+    const std::string padded = "^^" + std::string(folded);
+    std::vector<uint32_t> codes;
+    codes.reserve(padded.size());
+    for (size_t i = 0; i + 2 < padded.size(); ++i) {
+        codes.push_back(trigramCode(static_cast<unsigned char>(padded[i]), static_cast<unsigned char>(padded[i + 1]),
+                                    static_cast<unsigned char>(padded[i + 2])));
+    }
+    std::sort(codes.begin(), codes.end());
+    codes.erase(std::unique(codes.begin(), codes.end()), codes.end());
+    const int trigramTotal = static_cast<int>(codes.size());
+    int threshold = std::max(1, trigramTotal - 4 * edits);
+
+    // Счетчики общих триграмм по вариантам; обнуляются только затронутые
+    thread_local std::vector<uint8_t> counts;
+    thread_local std::vector<uint32_t> touched;
+    if (counts.size() < m_header.variantCount) counts.assign(m_header.variantCount, 0);
+    touched.clear();
+
+    const TrigramRecord* trigramsEnd = m_trigrams + m_header.trigramCount;
+    for (uint32_t code : codes) {
+        const TrigramRecord* trigram = std::lower_bound(m_trigrams, trigramsEnd, code,
+                                                        [](const TrigramRecord& record, uint32_t value) { return record.code < value; });
+        if (trigram == trigramsEnd || trigram->code != code) continue;
+        const uint32_t last = std::min(trigram[1].start, m_header.postingCount);
+        for (uint32_t i = trigram->start; i < last; ++i) {
+            const uint32_t variant = m_postings[i];
+            if (variant >= m_header.variantCount) continue;
+            if (counts[variant]++ == 0) touched.push_back(variant);
+        }
+    }
+
+    // Слишком много кандидатов (короткий запрос из частых триграмм): порог поднимается,
+    // пока расстояние не останется считать для FUZZY_MAX_CANDIDATES самых похожих
+    size_t histogram[FUZZY_MAX_LENGTH + 2] = {};
+    for (uint32_t variant : touched) ++histogram[counts[variant]];
+    size_t candidates = 0;
+    for (int count = threshold; count <= trigramTotal; ++count) candidates += histogram[count];
+    while (candidates > FUZZY_MAX_CANDIDATES && threshold < trigramTotal) {
+        candidates -= histogram[threshold++];
+    }
+
+    for (uint32_t variant : touched) {
+        const int common = counts[variant];
+        counts[variant] = 0;
+        if (common < threshold) continue;
+
+        const VariantRecord& record = m_variants[variant];
+        if (record.name >= m_header.nameCount) continue;
+        const NameRecord& name = m_names[record.name];
+        if (name.city >= m_header.cityCount) continue;
+
+        int prefixDistance, fullDistance;
+        editDistance(folded, key(record), edits, prefixDistance, fullDistance);
+        if (prefixDistance > edits) continue;
+
+        const int cost = std::min(prefixDistance * EDIT_COST + PREFIX_COST, fullDistance * EDIT_COST);
+        top.add({fullDistance == 0, cost - m_cities[name.city].prior, name.rank, name.city, record.name});
+    }
+}
+
+std::vector<CityIndex::Match> CityIndex::search(std::string_view query, size_t limit) const {
+    std::vector<Match> result;
+    const std::string prefix = normalize(query);
+    if (prefix.empty() || limit == 0) return result;
+
+    TopMatches top(limit);
+    searchPrefix(prefix, top);
+
+    // Транслитерация в латиницу: кириллический запрос находит латинские названия и наоборот.
+    // Запросы подлиннее ищутся и с опечатками; префиксные совпадения вариантов - подмножество
+    // нечетких (содержат все триграммы запроса)
+    const std::string folded = transliterate(prefix);
+    const bool latin = std::all_of(folded.begin(), folded.end(), [](char c) { return (c & 0x80) == 0; });
+    if (latin && m_header.variantCount > 0 && folded.size() <= FUZZY_MAX_LENGTH) {
+        if (folded.size() < FUZZY_MIN_LENGTH) searchVariants(folded, top);
+        else searchFuzzy(folded, top);
+    }
+
+    result.reserve(top.best().size());
+    for (const Candidate& candidate : top.best()) {
+        const NameRecord& name = m_names[candidate.name];
+        result.push_back({city(candidate.city), text(name.nameOffset, name.nameLength)});
+    }
+    return result;
+}
+
+std::vector<CityIndex::Nearby> CityIndex::nearby(double latitude, double longitude, double radiusKm, size_t limit) const {
+    std::vector<Nearby> result;
+    if (m_header.cityCount == 0 || limit == 0 || !(radiusKm >= 0.0)) return result;
+
+    struct Found {
+        uint32_t city;
+        double distanceKm;
+    };
+    std::vector<Found> best;
+    best.reserve(limit + 1);
+
+    latitude = std::clamp(latitude, -90.0, 90.0);
+    longitude = longitude - 360.0 * std::floor((longitude + 180.0) / 360.0);
+    const size_t center = cellOf(latitude, longitude, GRID_DEGREES, GRID_ROWS, GRID_COLS);
+    const int row = static_cast<int>(center / GRID_COLS);
+    const int col = static_cast<int>(center % GRID_COLS);
+    const double cosLatitude = std::cos(latitude * DEG_TO_RAD);
+
+    auto visitCell = [&](int r, int c) {
+        const size_t cell = static_cast<size_t>(r) * GRID_COLS + ((c % GRID_COLS) + GRID_COLS) % GRID_COLS;
+        const uint32_t last = std::min(m_cellStart[cell + 1], m_header.cityCount);
+        for (uint32_t i = m_cellStart[cell]; i < last; ++i) {
+            const CityRecord& record = m_cities[i];
+            const double distance = distanceKm(latitude, longitude, record.latitude, record.longitude);
+            if (distance > radiusKm) continue;
+            if (best.size() == limit && distance >= best.back().distanceKm) continue;
+            const Found found{i, distance};
+            best.insert(std::upper_bound(best.begin(), best.end(), found,
+                                         [](const Found& a, const Found& b) { return a.distanceKm < b.distanceKm; }),
+                        found);
+            if (best.size() > limit) best.pop_back();
+        }
+    };
+
+    for (int ring = 0;; ++ring) {
+        // Кольцо: верхняя и нижняя строки целиком, в остальных - крайние столбцы.
+        // Когда кольцо шире сетки по долготе, каждая ячейка обходится один раз: крайние
+        // столбцы могут совпасть (2 * ring == GRID_COLS) или уже быть обойдены
+        const bool allColumns = 2 * ring + 1 >= GRID_COLS;       // После этого кольца
+        const bool sidesVisited = 2 * ring - 1 >= GRID_COLS;     // Предыдущими кольцами
+        for (int r = std::max(0, row - ring); r <= std::min(GRID_ROWS - 1, row + ring); ++r) {
+            const bool edgeRow = r == row - ring || r == row + ring;
+            if (edgeRow) {
+                if (allColumns) {
+                    for (int c = 0; c < GRID_COLS; ++c) visitCell(r, c);
+                } else {
+                    for (int c = col - ring; c <= col + ring; ++c) visitCell(r, c);
+                }
+            } else if (!sidesVisited) {
+                visitCell(r, col - ring);
+                if (2 * ring != GRID_COLS) visitCell(r, col + ring);
+            }
+        }
+
+        // Нижняя оценка расстояния до необойденных ячеек: либо по широте за пределами
+        // обойденных строк, либо по долготе за пределами столбцов - тогда не меньше
+        // расстояния до меридиана на границе (asin(cos φ · sin Δλ))
+        const double infinity = std::numeric_limits<double>::infinity();
+        double latitudeGap = infinity;
+        if (row - ring > 0) latitudeGap = latitude - ((row - ring) * GRID_DEGREES - 90.0);
+        if (row + ring < GRID_ROWS - 1) latitudeGap = std::min(latitudeGap, (row + ring + 1) * GRID_DEGREES - 90.0 - latitude);
+        double boundKm = latitudeGap * DEG_TO_RAD * EARTH_RADIUS_KM;
+        if (!allColumns) {
+            const double longitudeGap = std::min(longitude - ((col - ring) * GRID_DEGREES - 180.0),
+                                                 (col + ring + 1) * GRID_DEGREES - 180.0 - longitude);
+            const double meridianKm = std::asin(std::min(1.0, cosLatitude * std::sin(std::min(longitudeGap, 90.0) * DEG_TO_RAD)))
+                                      * EARTH_RADIUS_KM;
+            boundKm = std::min(boundKm, meridianKm);
+        }
+
+        if (boundKm == infinity) break;                              // Обойдена вся сетка
+        if (boundKm > radiusKm) break;
+        if (best.size() == limit && boundKm >= best.back().distanceKm) break;
+    }
+
+    result.reserve(best.size());
+    for (const Found& found : best) {
+        result.push_back({city(found.city), found.distanceKm});
+    }
+    return result;
+}
+
+std::optional<CityIndex::Nearby> CityIndex::nearest(double latitude, double longitude, double maxKm) const {
+    auto found = nearby(latitude, longitude, maxKm, 1);
+    if (found.empty()) return std::nullopt;
+    return found.front();
+}
@@ -0,0 +1,238 @@
+#ifndef CITYINDEX_H
+#define CITYINDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+
+// Офлайн-индекс городов для /api/cities/search и обратного геокодирования (Nominatim -
+// только запасной вариант).
+//
+// Индекс - один версионированный двоичный файл (data/cities.bin), который утилита
+// build_city_index собирает из выгрузки GeoNames (cities15000.txt и т.п., рядом -
+// countryInfo.txt и admin1CodesASCII.txt). Сервер отображает его в память (mmap) только
+// для чтения, как таблицу SolarEphemeris: запуск не зависит от размера индекса, страницы
+// общие для всех процессов. Разделы файла после заголовка:
+//   - записи городов фиксированной длины (координаты, население, ссылки на строки,
+//     номер часового пояса), упорядоченные по ячейкам сетки 1°x1°;
+//   - названия: нормализованный ключ (нижний регистр, ё -> е, латиница без диакритики),
+//     исходное написание и номер города, отсортированы по ключу - поиск по префиксу
+//     сводится к двоичному поиску диапазона;
+//   - варианты для нечеткого поиска: названия, транслитерированные в латиницу
+//     (кириллица и арабское письмо), по одному на город и написание;
+//   - начала ячеек сетки: города ячейки лежат в файле подряд, отдельного массива точек нет;
+//   - триграммный индекс вариантов: триграммы по возрастанию и списки вариантов для каждой;
+//   - таблица часовых поясов и общий пул строк (одинаковые строки хранятся один раз).
+//
+// Поиск объединяет совпадения по префиксу (исходные названия и транслитерация, так что
+// "Махачкала" находит и "Makhachkala") и нечеткие совпадения с опечатками: кандидаты -
+// варианты, у которых достаточно общих с запросом триграмм (каждая правка меняет не больше
+// четырех), затем ограниченное расстояние Дамерау-Левенштейна до префикса варианта.
+// Порядок: точные совпадения, затем число правок с поправкой на население города.
+//
+// Индекс обновляется атомарной заменой файла (build_city_index пишет во временный файл и
+// переименовывает). Каждый загруженный файл - отдельный снимок CityIndex; запросы берут
+// current() и держат его, пока используют результаты (строки указывают в отображение),
+// поэтому замена не затрагивает выполняющиеся запросы, а старое отображение снимается
+// после последнего из них.
+class CityIndex {
+public:
+    static constexpr uint32_t VERSION = 2;
+
+    struct Header {
+        char magic[8];            // "JPCITIDX"
+        uint32_t version;
+        uint32_t byteOrder;       // 0x01020304 в порядке байт машины, создавшей файл
+        uint32_t cityRecordSize;
+        uint32_t nameRecordSize;
+        uint32_t cityCount;
+        uint32_t nameCount;
+        uint32_t timezoneCount;
+        uint32_t gridDegrees;
+        uint32_t variantRecordSize;
+        uint32_t variantCount;
+        uint32_t trigramCount;    // Без завершающей записи
+        uint32_t postingCount;
+        uint64_t stringPoolSize;
+        int64_t builtAt;          // Время построения, unix
+    };
+
+    // Строки - смещение и длина в пуле строк
+    struct CityRecord {
+        double latitude;
+        double longitude;
+        uint64_t population;
+        uint32_t id;              // geonameid
+        uint32_t nameOffset;
+        uint32_t countryOffset;
+        uint32_t regionOffset;
+        uint16_t nameLength;
+        uint16_t countryLength;
+        uint16_t regionLength;
+        uint16_t timezone;        // Номер в таблице часовых поясов
+        char countryCode[2];      // ISO 3166-1, "RU"
+        uint16_t prior;           // Вес населения для ранжирования: 0..PRIOR_MAX ~ log10(население)
+        uint8_t reserved[4];
+    };
+
+    struct NameRecord {
+        uint32_t keyOffset;       // Нормализованный ключ
+        uint32_t nameOffset;      // Исходное написание
+        uint32_t city;
+        uint16_t keyLength;
+        uint16_t nameLength;
+        uint8_t rank;             // 0 - основное название, 1 - ASCII, 2 - альтернативное
+        uint8_t reserved[3];
+    };
+
+    // Транслитерированное название: ключ в пуле строк и запись NameRecord с городом
+    struct VariantRecord {
+        uint32_t keyOffset;
+        uint32_t name;
+        uint16_t keyLength;
+        uint16_t reserved;
+    };
+
+    // Триграмма и начало ее списка вариантов; конец - начало следующей записи
+    struct TrigramRecord {
+        uint32_t code;
+        uint32_t start;
+    };
+
+    struct StringRef {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    // Город из индекса; строки указывают в отображение снимка
+    struct City {
+        uint32_t id;
+        double latitude;
+        double longitude;
+        uint64_t population;
+        std::string_view name;         // Основное название
+        std::string_view countryCode;
+        std::string_view country;      // Название страны (или код)
+        std::string_view region;       // Регион первого уровня (admin1), может быть пустым
+        std::string_view timezone;     // Зона IANA
+    };
+
+    struct Match {
+        City city;
+        std::string_view name;         // Название, по которому найден город
+    };
+
+    struct Nearby {
+        City city;
+        double distanceKm;
+    };
+
+    ~CityIndex();
+    CityIndex(const CityIndex&) = delete;
+    CityIndex& operator=(const CityIndex&) = delete;
+
+    // Отобразить файл индекса и сделать его текущим; false, если файла нет или он некорректен
+    static bool load(const std::string& path);
+    // Текущий снимок (nullptr - индекс не загружен); безопасно из любых потоков
+    static std::shared_ptr<const CityIndex> current();
+    static bool isAvailable() { return current() != nullptr; }
+
+    // Загрузить файл заново, если он заменен (другой inode, время изменения или размер)
+    static bool reloadIfChanged(const std::string& path);
+    // Фоновая проверка замены файла; stopWatching - до выхода из main()
+    static void startWatching(const std::string& path, int intervalSeconds = 60);
+    static void stopWatching();
+
+    // Собрать файл индекса из выгрузки GeoNames (используется build_city_index)
+    static bool build(const std::string& sourcePath, const std::string& path);
+
+    // Нормализация названия для сравнения
+    static std::string normalize(std::string_view text);
+    // Транслитерация нормализованного названия в латиницу (кириллица, арабское письмо);
+    // прочие символы остаются как есть
+    static std::string transliterate(std::string_view normalized);
+
+    size_t size() const { return m_header.cityCount; }
+    size_t nameCount() const { return m_header.nameCount; }
+    size_t bytes() const { return m_mappingSize; }
+
+    // Города, одно из названий которых начинается с query (в том числе в транслитерации
+    // и с опечатками): сначала точные совпадения, затем по числу правок и населению;
+    // каждый город - один раз
+    std::vector<Match> search(std::string_view query, size_t limit) const;
+
+    // Города не дальше radiusKm от точки по возрастанию расстояния, не больше limit
+    std::vector<Nearby> nearby(double latitude, double longitude, double radiusKm, size_t limit) const;
+    // Ближайший город не дальше maxKm
+    std::optional<Nearby> nearest(double latitude, double longitude, double maxKm) const;
+
+private:
+    static constexpr int GRID_DEGREES = 1;
+    static constexpr int GRID_ROWS = 180 / GRID_DEGREES;
+    static constexpr int GRID_COLS = 360 / GRID_DEGREES;
+    static constexpr size_t GRID_CELLS = static_cast<size_t>(GRID_ROWS) * GRID_COLS;
+
+    static constexpr uint16_t PRIOR_MAX = 255;           // log10(население) = 8
+    // Стоимость совпадения в единицах PRIOR_MAX: правка - EDIT_COST, неполное название -
+    // PREFIX_COST, вычитается prior города
+    static constexpr int EDIT_COST = 256;
+    static constexpr int PREFIX_COST = 64;
+    static constexpr size_t FUZZY_MIN_LENGTH = 4;        // Короче - только по префиксу
+    static constexpr size_t FUZZY_MAX_LENGTH = 64;       // Длиннее - варианты не индексируются
+    static constexpr size_t FUZZY_MAX_CANDIDATES = 4000; // Кандидатов на расчет расстояния
+
+    struct Candidate;
+    class TopMatches;
+
+    // Допустимое число правок для запроса длины length
+    static int maxEdits(size_t length) { return length >= 12 ? 3 : length >= 8 ? 2 : 1; }
+    static uint32_t trigramCode(unsigned char a, unsigned char b, unsigned char c) {
+        return (static_cast<uint32_t>(a) << 16) | (static_cast<uint32_t>(b) << 8) | c;
+    }
+    // Расстояние Дамерау-Левенштейна (перестановка соседних символов - одна правка) от query
+    // до ближайшего префикса key и до key целиком, не больше maxEdits (больше -
+    // maxEdits + 1); считается только полоса |i - j| <= maxEdits
+    static void editDistance(std::string_view query, std::string_view key, int maxEdits,
+                             int& prefixDistance, int& fullDistance);
+
+    void searchPrefix(std::string_view prefix, TopMatches& top) const;
+    void searchVariants(std::string_view folded, TopMatches& top) const;
+    void searchFuzzy(std::string_view folded, TopMatches& top) const;
+
+    CityIndex() = default;
+
+    static std::shared_ptr<const CityIndex> open(const std::string& path);
+    static void watchLoop(std::string path, int intervalSeconds);
+
+    // Строка из пула; ссылка за пределы пула (поврежденный файл) - пустая строка
+    std::string_view text(uint32_t offset, uint32_t length) const {
+        if (offset > m_header.stringPoolSize || length > m_header.stringPoolSize - offset) return {};
+        return std::string_view(m_strings + offset, length);
+    }
+    std::string_view key(const NameRecord& entry) const { return text(entry.keyOffset, entry.keyLength); }
+    std::string_view key(const VariantRecord& variant) const { return text(variant.keyOffset, variant.keyLength); }
+    City city(uint32_t index) const;
+
+    Header m_header{};
+    const CityRecord* m_cities = nullptr;
+    const NameRecord* m_names = nullptr;     // По ключу
+    const VariantRecord* m_variants = nullptr;  // По ключу
+    const TrigramRecord* m_trigrams = nullptr;  // trigramCount + 1
+    const uint32_t* m_postings = nullptr;
+    const uint32_t* m_cellStart = nullptr;   // GRID_CELLS + 1
+    const StringRef* m_timezones = nullptr;
+    const char* m_strings = nullptr;
+
+    void* m_mapping = nullptr;
+    size_t m_mappingSize = 0;
+    // Какой файл отображен: для reloadIfChanged
+    uint64_t m_device = 0;
+    uint64_t m_inode = 0;
+    int64_t m_modified = 0;
+};
+
+#endif // CITYINDEX_H
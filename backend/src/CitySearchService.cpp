@@ -1,15 +1,21 @@
 #define CPPHTTPLIB_OPENSSL_SUPPORT
 #define CPPHTTPLIB_USE_CERTS_FROM_MACOSX_KEYCHAIN
 #include "CitySearchService.h"
+#include "UpstreamExecutor.h"
+#include "CityIndex.h"
+#include "JsonService.h"
+#include "Logger.h"
 #include <httplib.h>
-#include <iostream>
 #include <sstream>
 #include <iomanip>
 #include <thread>
 #include <map>
+#include <algorithm>
+#include <cctype>
 
 std::mutex CitySearchService::nominatimMutex;
 std::chrono::steady_clock::time_point CitySearchService::lastNominatimRequest = std::chrono::steady_clock::now();
+SingleFlight<std::string, std::string> CitySearchService::nominatimFlights;
 
 std::string CitySearchService::urlEncode(const std::string& str) {
     std::ostringstream encoded;
@@ -29,84 +35,194 @@ std::string CitySearchService::urlEncode(const std::string& str) {
     return encoded.str();
 }
 
-std::string CitySearchService::httpGetNominatim(const std::string& endpoint, const std::map<std::string, std::string>& params) {
-    std::cout << "🚀 Начало запроса к Nominatim, endpoint: " << endpoint << std::endl;
+std::string CitySearchService::httpGetNominatim(const std::string& endpoint, const std::map<std::string, std::string>& params,
+                                                std::chrono::steady_clock::time_point deadline) {
+    LOG_DEBUG("Cities") << "🚀 Начало запроса к Nominatim, endpoint: " << endpoint;
     
-    // Добавляем задержку между запросами (Nominatim требует минимум 1 секунду между запросами)
-    {
-        std::lock_guard<std::mutex> lock(nominatimMutex);
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastNominatimRequest);
-        
-        if (elapsed.count() < 1000) {
-            int delay = 1000 - elapsed.count();
-            std::cout << "⏳ Задержка " << delay << " мс перед запросом (политика Nominatim)" << std::endl;
-            std::this_thread::sleep_for(std::chrono::milliseconds(delay));
-        }
-        
-        lastNominatimRequest = std::chrono::steady_clock::now();
+    // Параметры в std::map упорядочены, поэтому одинаковые запросы дают одинаковый URL
+    std::ostringstream url;
+    url << endpoint << "?";
+    
+    bool first = true;
+    for (const auto& [key, value] : params) {
+        if (!first) url << "&";
+        first = false;
+        url << urlEncode(key) << "=" << urlEncode(value);
     }
+    std::string fullUrl = url.str();
     
+    // Одинаковые одновременные запросы (популярный город) выполняются один раз:
+    // остальные ждут ответа первого, включая пустой ответ при ошибке. Сам запрос идет
+    // в исполнителе внешних запросов, поток обработчика ждет его не дольше дедлайна
     try {
-        httplib::SSLClient cli("nominatim.openstreetmap.org", 443);
-        cli.set_follow_location(true);
-        cli.set_connection_timeout(10);
-        cli.set_read_timeout(10);
-        
-        std::ostringstream url;
-        url << endpoint << "?";
-        
-        bool first = true;
-        for (const auto& [key, value] : params) {
-            if (!first) url << "&";
-            first = false;
-            url << urlEncode(key) << "=" << urlEncode(value);
-        }
-        
-        httplib::Headers headers = {
-            {"User-Agent", "JummahPrayer/1.0 (https://github.com/jummah-prayer; contact@jummahprayer.app)"},
-            {"Accept", "application/json"},
-            {"Accept-Language", "ru,en"}
-        };
-        
-        std::string fullUrl = url.str();
-        std::cout << "🌐 Полный URL запроса: https://nominatim.openstreetmap.org" << fullUrl << std::endl;
-        
-        auto response = cli.Get(fullUrl.c_str(), headers);
-        
-        if (response && response->status == 200) {
-            std::cout << "✅ Получен ответ от Nominatim, размер: " << response->body.size() << " байт" << std::endl;
-            return response->body;
-        } else {
-            std::cout << "❌ Ошибка подключения к Nominatim" << std::endl;
-            if (response) {
-                std::cout << "   Статус: " << response->status << std::endl;
+        const auto waitTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+        auto body = nominatimFlights.run(fullUrl, waitTime, [&fullUrl, deadline] {
+            auto response = UpstreamExecutor::run(NOMINATIM_HOST, deadline,
+                [fullUrl](std::chrono::steady_clock::time_point taskDeadline) {
+                    return fetchNominatim(fullUrl, taskDeadline);
+                });
+            
+            if (response.status == 200) {
+                LOG_DEBUG("Cities") << "✅ Получен ответ от Nominatim, размер: " << response.body.size() << " байт";
+                return response.body;
             }
+            
+            if (response.status != 0) {
+                LOG_ERROR("Cities").field("status", response.status) << "❌ Ошибка подключения к Nominatim";
+            } else {
+                LOG_ERROR("Cities").field("error", response.error) << "❌ Ошибка подключения к Nominatim";
+            }
+            return std::string();
+        });
+        if (!body) {
+            LOG_WARN("Cities") << "⏱️ Ответ Nominatim не получен до дедлайна запроса";
+            return "";
         }
+        return *body;
     } catch (const std::exception& e) {
-        std::cout << "❌ Исключение при запросе к Nominatim: " << e.what() << std::endl;
+        LOG_ERROR("Cities") << "❌ Исключение при запросе к Nominatim: " << e.what();
     }
     
     return "";
 }
 
-std::string CitySearchService::searchCities(const std::string& query, int limit) {
+bool CitySearchService::isAvailable() {
+    return !UpstreamPool::circuitOpen(NOMINATIM_HOST);
+}
+
+// Выполняется в потоке исполнителя (не больше одного запроса к Nominatim одновременно)
+UpstreamPool::Response CitySearchService::fetchNominatim(const std::string& fullUrl,
+                                                         std::chrono::steady_clock::time_point deadline) {
+    UpstreamPool::Response response;
+    
+    // При разомкнутой цепи не ждем очереди политики Nominatim: ответ все равно будет отказом
+    if (!isAvailable()) {
+        response.error = "цепь разомкнута";
+        response.circuitOpen = true;
+        return response;
+    }
+    
+    // Nominatim требует минимум 1 секунду между запросами: под блокировкой только
+    // резервируется время запроса, ожидание до него идет без блокировки
+    std::chrono::steady_clock::time_point slot;
+    {
+        std::lock_guard<std::mutex> lock(nominatimMutex);
+        slot = std::max(std::chrono::steady_clock::now(), lastNominatimRequest + std::chrono::seconds(1));
+        if (slot >= deadline) {
+            response.error = "дедлайн истечет до разрешенного времени запроса";
+            return response;
+        }
+        lastNominatimRequest = slot;
+    }
+    
+    const auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(slot - std::chrono::steady_clock::now());
+    if (delay.count() > 0) {
+        LOG_DEBUG("Cities") << "⏳ Задержка " << delay.count() << " мс перед запросом (политика Nominatim)";
+        std::this_thread::sleep_until(slot);
+    }
+    
+    UpstreamPool::Headers headers = {
+        {"User-Agent", "JummahPrayer/1.0 (https://github.com/jummah-prayer; contact@jummahprayer.app)"},
+        {"Accept", "application/json"},
+        {"Accept-Language", "ru,en"}
+    };
+    
+    LOG_DEBUG("Cities") << "🌐 Полный URL запроса: https://nominatim.openstreetmap.org" << fullUrl;
+    
+    return UpstreamPool::get(NOMINATIM_HOST, fullUrl, headers, deadline);
+}
+
+// Город в формате ответа Nominatim: lat/lon строками, address.city/state/country
+void CitySearchService::writeCity(std::ostringstream& json, const CityIndex::City& city, std::string_view name,
+                                  double distanceKm) {
+    const std::string escapedName = JsonService::escapeJsonString(std::string(name));
+    const std::string region = JsonService::escapeJsonString(std::string(city.region));
+    const std::string country = JsonService::escapeJsonString(std::string(city.country));
+    
+    std::string countryCode(city.countryCode);
+    std::transform(countryCode.begin(), countryCode.end(), countryCode.begin(), ::tolower);
+    
+    json << std::fixed << std::setprecision(5);  // Координаты GeoNames - 5 знаков
+    json << "{\"place_id\":" << city.id
+         << ",\"name\":\"" << escapedName << "\""
+         << ",\"display_name\":\"" << escapedName << (region.empty() ? "" : ", " + region) << ", " << country << "\""
+         << ",\"lat\":\"" << city.latitude << "\",\"lon\":\"" << city.longitude << "\""
+         << ",\"type\":\"city\",\"population\":" << city.population
+         << ",\"timezone\":\"" << JsonService::escapeJsonString(std::string(city.timezone)) << "\"";
+    if (distanceKm >= 0.0) json << std::setprecision(2) << ",\"distance_km\":" << distanceKm;
+    json << ",\"address\":{\"city\":\"" << escapedName << "\"";
+    if (!region.empty()) json << ",\"state\":\"" << region << "\"";
+    json << ",\"country\":\"" << country << "\",\"country_code\":\"" << countryCode << "\"}}";
+}
+
+std::string CitySearchService::searchOffline(const std::string& query, int limit) {
+    // Снимок держим до конца: строки результатов указывают в отображенный файл
+    const auto index = CityIndex::current();
+    if (!index) return "";
+    
+    const auto started = std::chrono::steady_clock::now();
+    const auto matches = index->search(query, static_cast<size_t>(std::max(1, limit)));
+    
+    std::ostringstream json;
+    json << "[";
+    for (size_t i = 0; i < matches.size(); ++i) {
+        if (i > 0) json << ",";
+        writeCity(json, matches[i].city, matches[i].name);
+    }
+    json << "]";
+    
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started);
+    LOG_DEBUG("Cities").field("found", matches.size()).field("us", elapsed.count()) << "📚 Офлайн-индекс";
+    return json.str();
+}
+
+std::string CitySearchService::nearestOffline(double lat, double lon) {
+    const auto index = CityIndex::current();
+    if (!index) return "";
+    
+    const auto nearest = index->nearest(lat, lon, NEAREST_MAX_KM);
+    if (!nearest) return "";
+    
+    std::ostringstream json;
+    writeCity(json, nearest->city, nearest->city.name, nearest->distanceKm);
+    return json.str();
+}
+
+std::string CitySearchService::nearbyOffline(double lat, double lon, double radiusKm, int limit) {
+    const auto index = CityIndex::current();
+    if (!index) return "";
+    
+    const auto cities = index->nearby(lat, lon, radiusKm, static_cast<size_t>(std::max(1, limit)));
+    std::ostringstream json;
+    json << "[";
+    for (size_t i = 0; i < cities.size(); ++i) {
+        if (i > 0) json << ",";
+        writeCity(json, cities[i].city, cities[i].city.name, cities[i].distanceKm);
+    }
+    json << "]";
+    return json.str();
+}
+
+std::string CitySearchService::searchCities(const std::string& query, int limit,
+                                            std::chrono::steady_clock::time_point deadline) {
     std::map<std::string, std::string> params;
     params["q"] = query;
     params["format"] = "json";
     params["limit"] = std::to_string(limit);
     params["addressdetails"] = "1";
     
-    return CitySearchService::httpGetNominatim("/search", params);
+    return CitySearchService::httpGetNominatim("/search", params, deadline);
 }
 
-std::string CitySearchService::findNearestCity(double lat, double lon) {
+std::string CitySearchService::findNearestCity(double lat, double lon,
+                                               std::chrono::steady_clock::time_point deadline) {
     std::map<std::string, std::string> params;
     params["lat"] = std::to_string(lat);
     params["lon"] = std::to_string(lon);
     params["format"] = "json";
     params["addressdetails"] = "1";
     
-    return CitySearchService::httpGetNominatim("/reverse", params);
+    return CitySearchService::httpGetNominatim("/reverse", params, deadline);
 }
 
@@ -1,22 +1,54 @@
 #ifndef CITYSEARCHSERVICE_H
 #define CITYSEARCHSERVICE_H
 
+#include "SingleFlight.h"
+#include "UpstreamPool.h"
+#include "CityIndex.h"
 #include <string>
 #include <mutex>
 #include <chrono>
 #include <map>
+#include <sstream>
+#include <string_view>
 
 class CitySearchService {
 private:
     static std::mutex nominatimMutex;
     static std::chrono::steady_clock::time_point lastNominatimRequest;
+    static SingleFlight<std::string, std::string> nominatimFlights;  // Ключ - URL запроса
     
     static std::string urlEncode(const std::string& str);
-    static std::string httpGetNominatim(const std::string& endpoint, const std::map<std::string, std::string>& params);
+    static std::string httpGetNominatim(const std::string& endpoint, const std::map<std::string, std::string>& params,
+                                        std::chrono::steady_clock::time_point deadline);
+    static UpstreamPool::Response fetchNominatim(const std::string& fullUrl,
+                                                 std::chrono::steady_clock::time_point deadline);
+    static void writeCity(std::ostringstream& json, const CityIndex::City& city, std::string_view name,
+                          double distanceKm = -1.0);
     
 public:
-    static std::string searchCities(const std::string& query, int limit = 20);
-    static std::string findNearestCity(double lat, double lon);
+    static constexpr const char* NOMINATIM_HOST = "nominatim.openstreetmap.org";
+    // Сколько обработчик готов ждать Nominatim (включая очередь политики 1 запрос/с)
+    static constexpr std::chrono::milliseconds REQUEST_TIMEOUT{8000};
+    
+    // false - Nominatim отключен автоматом защиты и запросы к нему сейчас не отправляются
+    static bool isAvailable();
+    
+    // Поиск по офлайн-индексу CityIndex: JSON-массив в формате ответа Nominatim (lat/lon
+    // строками, address.city/state/country), чтобы фронтенд разбирал оба источника одинаково.
+    // Пустая строка - индекс не загружен
+    static std::string searchOffline(const std::string& query, int limit);
+    
+    // Обратное геокодирование по офлайн-индексу: ближайший город не дальше NEAREST_MAX_KM
+    // (объект в формате Nominatim /reverse, с distance_km); пустая строка - индекс не
+    // загружен или рядом нет городов
+    static constexpr double NEAREST_MAX_KM = 50.0;
+    static std::string nearestOffline(double lat, double lon);
+    // Города в радиусе radiusKm по возрастанию расстояния (JSON-массив)
+    static std::string nearbyOffline(double lat, double lon, double radiusKm, int limit);
+    static std::string searchCities(const std::string& query, int limit,
+                                    std::chrono::steady_clock::time_point deadline);
+    static std::string findNearestCity(double lat, double lon,
+                                       std::chrono::steady_clock::time_point deadline);
 };
 
 #endif // CITYSEARCHSERVICE_H
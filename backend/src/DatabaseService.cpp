@@ -1,6 +1,6 @@
 #include "DatabaseService.h"
 #include "JsonService.h"
-#include <iostream>
+#include "Logger.h"
 #include <sstream>
 #include <chrono>
 #include <iomanip>
@@ -9,24 +9,29 @@
 DatabaseService::DatabaseService(const std::string& dbPath) : db(nullptr), dbPath(dbPath) {
     // Создаем директорию для базы данных, если она не существует
     std::filesystem::path path = dbPath;
-    std::filesystem::create_directories(path.parent_path());
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path());
+    }
     
     // Открываем соединение с базой данных
     int rc = sqlite3_open(dbPath.c_str(), &db);
     if (rc != SQLITE_OK) {
-        std::cerr << "❌ Ошибка открытия базы данных: " << sqlite3_errmsg(db) << std::endl;
+        LOG_ERROR("Database") << "❌ Ошибка открытия базы данных: " << sqlite3_errmsg(db);
         db = nullptr;
         return;
     }
     
-    std::cout << "✅ База данных открыта: " << dbPath << std::endl;
+    LOG_INFO("Database") << "✅ База данных открыта: " << dbPath;
+    
+    // Базу открывают и AuthService, и постоянный кеш: при одновременной записи ждем блокировку
+    sqlite3_busy_timeout(db, 5000);
     
     // Включаем поддержку внешних ключей
     executeStatement("PRAGMA foreign_keys = ON;");
     
     // Инициализируем базу данных
     if (!initializeDatabase()) {
-        std::cerr << "❌ Ошибка инициализации базы данных" << std::endl;
+        LOG_ERROR("Database") << "❌ Ошибка инициализации базы данных";
     }
 }
 
@@ -48,8 +53,7 @@ bool DatabaseService::executeStatement(const std::string& sql) {
     int rc = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errMsg);
     
     if (rc != SQLITE_OK) {
-        std::cerr << "❌ Ошибка SQL: " << errMsg << std::endl;
-        std::cerr << "   Запрос: " << sql << std::endl;
+        LOG_ERROR("Database").field("sql", sql) << "❌ Ошибка SQL: " << errMsg;
         sqlite3_free(errMsg);
         return false;
     }
@@ -88,18 +92,60 @@ bool DatabaseService::createTokensTable() {
     return executeStatement(sql);
 }
 
+bool DatabaseService::createPrayerCacheTable() {
+    // Таблица без столбца version (до версионирования) - это только кеш, она пересоздается
+    bool hasVersion = true;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT version FROM prayer_cache LIMIT 0", -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_finalize(stmt);
+    } else {
+        hasVersion = std::string(sqlite3_errmsg(db)).find("no such column") == std::string::npos;
+    }
+    if (!hasVersion) {
+        LOG_INFO("Database") << "🔄 Таблица prayer_cache без версии записей, пересоздается";
+        executeStatement("DROP TABLE prayer_cache;");
+    }
+    
+    std::string sql = R"(
+        CREATE TABLE IF NOT EXISTS prayer_cache (
+            lat_cell INTEGER NOT NULL,
+            lon_cell INTEGER NOT NULL,
+            days INTEGER NOT NULL,
+            zone TEXT NOT NULL,
+            time_zone INTEGER NOT NULL,
+            method INTEGER NOT NULL,
+            madhhab INTEGER NOT NULL,
+            cell_degrees REAL NOT NULL,
+            body TEXT NOT NULL,
+            timeline BLOB NOT NULL,
+            expires_at INTEGER NOT NULL,
+            hits INTEGER NOT NULL DEFAULT 0,
+            version TEXT NOT NULL,
+            PRIMARY KEY (version, lat_cell, lon_cell, days, zone, time_zone, method, madhhab, cell_degrees)
+        ) WITHOUT ROWID
+    )";
+    
+    return executeStatement(sql);
+}
+
 bool DatabaseService::initializeDatabase() {
     bool success = true;
     
     // Создаем таблицу пользователей
     if (!createUsersTable()) {
-        std::cerr << "❌ Не удалось создать таблицу users" << std::endl;
+        LOG_ERROR("Database") << "❌ Не удалось создать таблицу users";
         success = false;
     }
     
     // Создаем таблицу токенов
     if (!createTokensTable()) {
-        std::cerr << "❌ Не удалось создать таблицу tokens" << std::endl;
+        LOG_ERROR("Database") << "❌ Не удалось создать таблицу tokens";
+        success = false;
+    }
+    
+    // Создаем таблицу постоянного кеша времени молитв
+    if (!createPrayerCacheTable()) {
+        LOG_ERROR("Database") << "❌ Не удалось создать таблицу prayer_cache";
         success = false;
     }
     
@@ -107,6 +153,8 @@ bool DatabaseService::initializeDatabase() {
     executeStatement("CREATE INDEX IF NOT EXISTS idx_users_email ON users(email);");
     executeStatement("CREATE INDEX IF NOT EXISTS idx_tokens_user_id ON tokens(user_id);");
     executeStatement("CREATE INDEX IF NOT EXISTS idx_tokens_expires ON tokens(expires_at);");
+    executeStatement("CREATE INDEX IF NOT EXISTS idx_prayer_cache_hits ON prayer_cache(hits);");
+    executeStatement("CREATE INDEX IF NOT EXISTS idx_prayer_cache_expires ON prayer_cache(expires_at);");
     
     // Удаляем просроченные токены
     deleteExpiredTokens();
@@ -125,7 +173,7 @@ bool DatabaseService::createUser(const std::string& email, const std::string& pa
     sqlite3_stmt* stmt;
     int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db) << std::endl;
+        LOG_ERROR("Database") << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db);
         return false;
     }
     
@@ -151,7 +199,7 @@ std::map<std::string, std::string> DatabaseService::getUserByEmail(const std::st
     sqlite3_stmt* stmt;
     int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db) << std::endl;
+        LOG_ERROR("Database") << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db);
         return user;
     }
     
@@ -183,7 +231,7 @@ std::map<std::string, std::string> DatabaseService::getUserById(const std::strin
     sqlite3_stmt* stmt;
     int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db) << std::endl;
+        LOG_ERROR("Database") << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db);
         return user;
     }
     
@@ -215,7 +263,7 @@ std::vector<std::map<std::string, std::string>> DatabaseService::getAllUsers() {
     sqlite3_stmt* stmt;
     int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db) << std::endl;
+        LOG_ERROR("Database") << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db);
         return users;
     }
     
@@ -241,7 +289,7 @@ bool DatabaseService::updateUserPassword(const std::string& userId, const std::s
     sqlite3_stmt* stmt;
     int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db) << std::endl;
+        LOG_ERROR("Database") << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db);
         return false;
     }
     
@@ -272,7 +320,7 @@ bool DatabaseService::createToken(const std::string& token, const std::string& u
     sqlite3_stmt* stmt;
     int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db) << std::endl;
+        LOG_ERROR("Database") << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db);
         return false;
     }
     
@@ -296,7 +344,7 @@ std::map<std::string, std::string> DatabaseService::getToken(const std::string&
     sqlite3_stmt* stmt;
     int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db) << std::endl;
+        LOG_ERROR("Database") << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db);
         return tokenInfo;
     }
     
@@ -324,7 +372,7 @@ std::vector<std::map<std::string, std::string>> DatabaseService::getUserTokens(c
     sqlite3_stmt* stmt;
     int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db) << std::endl;
+        LOG_ERROR("Database") << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db);
         return tokens;
     }
     
@@ -350,7 +398,7 @@ bool DatabaseService::deleteToken(const std::string& token) {
     sqlite3_stmt* stmt;
     int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db) << std::endl;
+        LOG_ERROR("Database") << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db);
         return false;
     }
     
@@ -378,7 +426,7 @@ bool DatabaseService::userExists(const std::string& email) {
     sqlite3_stmt* stmt;
     int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db) << std::endl;
+        LOG_ERROR("Database") << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db);
         return false;
     }
     
@@ -411,7 +459,7 @@ int DatabaseService::getUserCount() {
     sqlite3_stmt* stmt;
     int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db) << std::endl;
+        LOG_ERROR("Database") << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db);
         return 0;
     }
     
@@ -433,7 +481,7 @@ int DatabaseService::getActiveTokenCount() {
     sqlite3_stmt* stmt;
     int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db) << std::endl;
+        LOG_ERROR("Database") << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db);
         return 0;
     }
     
@@ -445,4 +493,152 @@ int DatabaseService::getActiveTokenCount() {
     
     sqlite3_finalize(stmt);
     return count;
-}
\ No newline at end of file
+}
+
+bool DatabaseService::savePrayerCache(const std::vector<PrayerCacheRecord>& records) {
+    if (!db) return false;
+    if (records.empty()) return true;
+    
+    std::string sql = R"(
+        INSERT INTO prayer_cache (lat_cell, lon_cell, days, zone, time_zone, method, madhhab,
+                                  cell_degrees, body, timeline, expires_at, hits, version)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+        ON CONFLICT (version, lat_cell, lon_cell, days, zone, time_zone, method, madhhab, cell_degrees)
+        DO UPDATE SET body = excluded.body, timeline = excluded.timeline,
+                      expires_at = excluded.expires_at, hits = hits + excluded.hits
+    )";
+    
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        LOG_ERROR("Database") << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db);
+        return false;
+    }
+    
+    // Одна транзакция на пакет: тысячи вставок без fsync на каждую
+    if (!executeStatement("BEGIN TRANSACTION;")) {
+        sqlite3_finalize(stmt);
+        return false;
+    }
+    
+    bool success = true;
+    for (const PrayerCacheRecord& record : records) {
+        sqlite3_bind_int(stmt, 1, record.latitudeCell);
+        sqlite3_bind_int(stmt, 2, record.longitudeCell);
+        sqlite3_bind_int(stmt, 3, record.days);
+        sqlite3_bind_text(stmt, 4, record.zone.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 5, record.timeZone);
+        sqlite3_bind_int(stmt, 6, record.method);
+        sqlite3_bind_int(stmt, 7, record.madhhab);
+        sqlite3_bind_double(stmt, 8, record.cellDegrees);
+        sqlite3_bind_text(stmt, 9, record.body.c_str(), static_cast<int>(record.body.size()), SQLITE_STATIC);
+        sqlite3_bind_blob(stmt, 10, record.timeline.data(), static_cast<int>(record.timeline.size()), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 11, record.expiresAt);
+        sqlite3_bind_int64(stmt, 12, record.hits);
+        sqlite3_bind_text(stmt, 13, record.version.c_str(), -1, SQLITE_STATIC);
+        
+        rc = sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+        if (rc != SQLITE_DONE) {
+            LOG_ERROR("Database") << "❌ Ошибка сохранения кеша: " << sqlite3_errmsg(db);
+            success = false;
+            break;
+        }
+    }
+    
+    sqlite3_finalize(stmt);
+    executeStatement(success ? "COMMIT;" : "ROLLBACK;");
+    return success;
+}
+
+std::vector<DatabaseService::PrayerCacheRecord> DatabaseService::loadHotPrayerCache(const std::string& version, double cellDegrees,
+                                                                                   int64_t now, int limit) {
+    std::vector<PrayerCacheRecord> records;
+    if (!db || limit <= 0) return records;
+    
+    std::string sql = R"(
+        SELECT lat_cell, lon_cell, days, zone, time_zone, method, madhhab, cell_degrees,
+               body, timeline, expires_at, hits, version
+        FROM prayer_cache
+        WHERE version = ? AND cell_degrees = ? AND expires_at > ?
+        ORDER BY hits DESC
+        LIMIT ?
+    )";
+    
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        LOG_ERROR("Database") << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db);
+        return records;
+    }
+    
+    sqlite3_bind_text(stmt, 1, version.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_double(stmt, 2, cellDegrees);
+    sqlite3_bind_int64(stmt, 3, now);
+    sqlite3_bind_int(stmt, 4, limit);
+    
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        PrayerCacheRecord record;
+        record.latitudeCell = sqlite3_column_int(stmt, 0);
+        record.longitudeCell = sqlite3_column_int(stmt, 1);
+        record.days = sqlite3_column_int(stmt, 2);
+        record.zone = sqlite3_column_text(stmt, 3) ?
+            reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3)) : "";
+        record.timeZone = sqlite3_column_int(stmt, 4);
+        record.method = sqlite3_column_int(stmt, 5);
+        record.madhhab = sqlite3_column_int(stmt, 6);
+        record.cellDegrees = sqlite3_column_double(stmt, 7);
+        record.body.assign(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 8)),
+                           sqlite3_column_bytes(stmt, 8));
+        const void* timeline = sqlite3_column_blob(stmt, 9);
+        record.timeline.assign(timeline ? static_cast<const char*>(timeline) : "",
+                               sqlite3_column_bytes(stmt, 9));
+        record.expiresAt = sqlite3_column_int64(stmt, 10);
+        record.hits = sqlite3_column_int64(stmt, 11);
+        record.version = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 12));
+        records.push_back(std::move(record));
+    }
+    
+    sqlite3_finalize(stmt);
+    return records;
+}
+
+int DatabaseService::deleteExpiredPrayerCache(int64_t now) {
+    if (!db) return 0;
+    
+    std::string sql = "DELETE FROM prayer_cache WHERE expires_at <= ?";
+    
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        LOG_ERROR("Database") << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db);
+        return 0;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, now);
+    rc = sqlite3_step(stmt);
+    int deleted = rc == SQLITE_DONE ? sqlite3_changes(db) : 0;
+    
+    sqlite3_finalize(stmt);
+    return deleted;
+}
+
+int DatabaseService::deleteOtherPrayerCacheVersions(const std::string& version) {
+    if (!db) return 0;
+    
+    std::string sql = "DELETE FROM prayer_cache WHERE version <> ?";
+    
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        LOG_ERROR("Database") << "❌ Ошибка подготовки запроса: " << sqlite3_errmsg(db);
+        return 0;
+    }
+    
+    sqlite3_bind_text(stmt, 1, version.c_str(), -1, SQLITE_STATIC);
+    rc = sqlite3_step(stmt);
+    int deleted = rc == SQLITE_DONE ? sqlite3_changes(db) : 0;
+    
+    sqlite3_finalize(stmt);
+    return deleted;
+}
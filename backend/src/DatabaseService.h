@@ -6,6 +6,7 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <cstdint>
 
 class DatabaseService {
 private:
@@ -16,8 +17,26 @@ private:
     bool initializeDatabase();
     bool createUsersTable();
     bool createTokensTable();
+    bool createPrayerCacheTable();
     
 public:
+    // Запись постоянного кеша времени молитв (ключ PrayerTimesCache + готовые данные)
+    struct PrayerCacheRecord {
+        int latitudeCell;
+        int longitudeCell;
+        int days;                  // Местная дата (дни от 1970-01-01)
+        std::string zone;          // Имя зоны IANA; пусто - фиксированное смещение
+        int timeZone;              // Закодированное фиксированное смещение, если zone пусто
+        int method;
+        int madhhab;
+        double cellDegrees;        // Шаг сетки, с которым записан ключ
+        std::string body;
+        std::string timeline;      // PrayerTimeline::serialize()
+        int64_t expiresAt;         // UTC, секунды
+        int64_t hits;
+        std::string version;       // Версия расчета и tzdata, с которой запись получена
+    };
+    
     DatabaseService(const std::string& dbPath = "data/jummah_prayer.db");
     ~DatabaseService();
     
@@ -37,6 +56,15 @@ public:
     bool deleteToken(const std::string& token);
     bool deleteExpiredTokens();
     
+    // Постоянный кеш времени молитв: сохранение одной транзакцией (hits прибавляются
+    // к сохраненным), загрузка самых популярных неистекших записей версии version, очистка
+    // истекших и записей других версий
+    bool savePrayerCache(const std::vector<PrayerCacheRecord>& records);
+    std::vector<PrayerCacheRecord> loadHotPrayerCache(const std::string& version, double cellDegrees,
+                                                      int64_t now, int limit);
+    int deleteExpiredPrayerCache(int64_t now);
+    int deleteOtherPrayerCacheVersions(const std::string& version);
+    
     // Проверка существования пользователя
     bool userExists(const std::string& email);
     
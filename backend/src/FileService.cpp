@@ -1,7 +1,7 @@
 #include "FileService.h"
+#include "Logger.h"
 #include <fstream>
 #include <sstream>
-#include <iostream>
 #include <vector>
 
 std::string FileService::readFile(const std::string& path) {
@@ -42,7 +42,7 @@ std::string FileService::findWebRoot(int argc, char* argv[]) {
         if (webRoot.back() != '/') {
             webRoot += "/";
         }
-        std::cout << "📁 Используем указанный путь: " << webRoot << std::endl;
+        LOG_INFO("Files") << "📁 Используем указанный путь: " << webRoot;
     } else {
         // Пробуем разные варианты в зависимости от места запуска
         std::vector<std::string> possiblePaths = {
@@ -57,7 +57,7 @@ std::string FileService::findWebRoot(int argc, char* argv[]) {
             if (testFile.good()) {
                 webRoot = path;
                 testFile.close();
-                std::cout << "✅ Найдена папка с веб-файлами: " << webRoot << std::endl;
+                LOG_INFO("Files") << "✅ Найдена папка с веб-файлами: " << webRoot;
                 break;
             }
             testFile.close();
@@ -66,17 +66,16 @@ std::string FileService::findWebRoot(int argc, char* argv[]) {
         // Если ничего не нашли, используем относительный путь
         if (webRoot.empty()) {
             webRoot = "../frontend/";
-            std::cout << "⚠️  Предупреждение: используем путь по умолчанию: " << webRoot << std::endl;
-            std::cout << "   Убедитесь, что папка frontend/ существует относительно места запуска" << std::endl;
-            std::cout << "   Или укажите путь: ./JummahPrayerBackend /путь/к/frontend/" << std::endl;
+            LOG_WARN("Files") << "⚠️ Используем путь по умолчанию: " << webRoot
+                              << " (папка frontend/ должна существовать относительно места запуска,"
+                              << " или укажите путь: ./JummahPrayerBackend /путь/к/frontend/)";
         }
     }
     
     // Проверяем, что index.html существует
     std::ifstream checkIndex(webRoot + "index.html");
     if (!checkIndex.good()) {
-        std::cerr << "❌ ОШИБКА: Не найден файл " << webRoot << "index.html" << std::endl;
-        std::cerr << "   Проверьте путь к веб-файлам!" << std::endl;
+        LOG_ERROR("Files") << "❌ Не найден файл " << webRoot << "index.html, проверьте путь к веб-файлам";
         return "";
     }
     checkIndex.close();
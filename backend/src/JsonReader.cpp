@@ -0,0 +1,314 @@
+#include "JsonReader.h"
+#include <cctype>
+
+JsonReader::JsonReader(std::string_view json) : m_json(json) {}
+
+JsonReader::Token JsonReader::fail(const char* message) {
+    if (!m_error) m_error = message;
+    m_text = {};
+    return Token::Error;
+}
+
+void JsonReader::skipWhitespace() {
+    while (m_pos < m_json.size()) {
+        const char c = m_json[m_pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') break;
+        ++m_pos;
+    }
+}
+
+JsonReader::Token JsonReader::next() {
+    if (m_error) return Token::Error;
+    skipWhitespace();
+
+    if (m_done) {
+        if (m_pos != m_json.size()) return fail("лишние символы после значения");
+        m_text = {};
+        return Token::End;
+    }
+    if (m_pos >= m_json.size()) return fail("неожиданный конец текста");
+
+    if (m_afterKey) {
+        if (m_json[m_pos] != ':') return fail("ожидалось ':'");
+        ++m_pos;
+        m_afterKey = false;
+        skipWhitespace();
+        if (m_pos >= m_json.size()) return fail("неожиданный конец текста");
+        return readValue();
+    }
+
+    if (m_depth == 0) return readValue();
+
+    const bool inObject = m_stack[m_depth - 1] == '{';
+    char c = m_json[m_pos];
+
+    if (c == (inObject ? '}' : ']')) {
+        ++m_pos;
+        --m_depth;
+        m_text = {};
+        return valueDone(inObject ? Token::EndObject : Token::EndArray);
+    }
+
+    if (m_afterValue) {
+        if (c != ',') return fail(inObject ? "ожидалось ',' или '}'" : "ожидалось ',' или ']'");
+        ++m_pos;
+        m_afterValue = false;
+        skipWhitespace();
+        if (m_pos >= m_json.size()) return fail("неожиданный конец текста");
+        c = m_json[m_pos];
+    }
+
+    if (inObject) {
+        if (c != '"') return fail("ожидался ключ");
+        return readString(Token::Key);
+    }
+    return readValue();
+}
+
+JsonReader::Token JsonReader::readValue() {
+    switch (m_json[m_pos]) {
+        case '{':
+        case '[':
+            if (m_depth == MAX_DEPTH) return fail("слишком глубокая вложенность");
+            m_stack[m_depth++] = m_json[m_pos];
+            ++m_pos;
+            m_afterValue = false;
+            m_text = {};
+            return m_stack[m_depth - 1] == '{' ? Token::BeginObject : Token::BeginArray;
+        case '"':
+            return readString(Token::String);
+        case 't':
+            return readLiteral("true", Token::True);
+        case 'f':
+            return readLiteral("false", Token::False);
+        case 'n':
+            return readLiteral("null", Token::Null);
+        default:
+            return readNumber();
+    }
+}
+
+JsonReader::Token JsonReader::valueDone(Token kind) {
+    m_afterValue = true;
+    if (m_depth == 0) m_done = true;
+    return kind;
+}
+
+JsonReader::Token JsonReader::readString(Token kind) {
+    const size_t start = ++m_pos;  // После открывающей кавычки
+    bool escaped = false;
+
+    while (m_pos < m_json.size()) {
+        const unsigned char c = static_cast<unsigned char>(m_json[m_pos]);
+        if (c == '"') {
+            m_text = m_json.substr(start, m_pos - start);
+            m_escaped = escaped;
+            ++m_pos;
+            if (kind == Token::Key) {
+                m_afterKey = true;
+                return kind;
+            }
+            return valueDone(kind);
+        }
+        if (c < 0x20) return fail("управляющий символ в строке");
+        if (c == '\\') {
+            escaped = true;
+            if (++m_pos >= m_json.size()) break;
+            switch (m_json[m_pos]) {
+                case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+                    break;
+                case 'u':
+                    for (int i = 0; i < 4; ++i) {
+                        if (++m_pos >= m_json.size() || !std::isxdigit(static_cast<unsigned char>(m_json[m_pos]))) {
+                            return fail("некорректная последовательность \\u");
+                        }
+                    }
+                    break;
+                default:
+                    return fail("некорректная escape-последовательность");
+            }
+        }
+        ++m_pos;
+    }
+    return fail("незакрытая строка");
+}
+
+JsonReader::Token JsonReader::readNumber() {
+    const size_t start = m_pos;
+    auto digits = [this]() {
+        const size_t from = m_pos;
+        while (m_pos < m_json.size() && m_json[m_pos] >= '0' && m_json[m_pos] <= '9') ++m_pos;
+        return m_pos - from;
+    };
+
+    if (m_json[m_pos] == '-') ++m_pos;
+    if (m_pos < m_json.size() && m_json[m_pos] == '0') {
+        ++m_pos;  // Ведущие нули запрещены
+    } else if (digits() == 0) {
+        return fail("некорректное значение");
+    }
+    if (m_pos < m_json.size() && m_json[m_pos] == '.') {
+        ++m_pos;
+        if (digits() == 0) return fail("некорректное число");
+    }
+    if (m_pos < m_json.size() && (m_json[m_pos] == 'e' || m_json[m_pos] == 'E')) {
+        ++m_pos;
+        if (m_pos < m_json.size() && (m_json[m_pos] == '+' || m_json[m_pos] == '-')) ++m_pos;
+        if (digits() == 0) return fail("некорректное число");
+    }
+
+    m_text = m_json.substr(start, m_pos - start);
+    m_escaped = false;
+    return valueDone(Token::Number);
+}
+
+JsonReader::Token JsonReader::readLiteral(std::string_view literal, Token kind) {
+    if (m_json.compare(m_pos, literal.size(), literal) != 0) return fail("некорректное значение");
+    m_text = m_json.substr(m_pos, literal.size());
+    m_escaped = false;
+    m_pos += literal.size();
+    return valueDone(kind);
+}
+
+bool JsonReader::skipValue() {
+    const Token token = next();
+    switch (token) {
+        case Token::BeginObject:
+        case Token::BeginArray:
+            return skipContainer();
+        case Token::String:
+        case Token::Number:
+        case Token::True:
+        case Token::False:
+        case Token::Null:
+            return true;
+        default:
+            if (!failed()) fail("ожидалось значение");
+            return false;
+    }
+}
+
+bool JsonReader::skipContainer() {
+    const size_t depth = m_depth;
+    while (m_depth >= depth) {
+        if (next() == Token::Error) return false;
+    }
+    return true;
+}
+
+bool JsonReader::nextObject() {
+    const Token token = next();
+    if (token == Token::BeginObject) return true;
+    if (token == Token::BeginArray) skipContainer();
+    return false;
+}
+
+std::string JsonReader::nextString() {
+    const Token token = next();
+    if (token == Token::String) return string();
+    if (token == Token::BeginObject || token == Token::BeginArray) skipContainer();
+    return "";
+}
+
+std::string JsonReader::string() const {
+    return m_escaped ? unescape(m_text) : std::string(m_text);
+}
+
+std::string JsonReader::unescape(std::string_view raw) {
+    auto hex4 = [&raw](size_t pos) -> int {
+        if (pos + 4 > raw.size()) return -1;
+        int value = 0;
+        for (size_t i = pos; i < pos + 4; ++i) {
+            const char c = raw[i];
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else return -1;
+        }
+        return value;
+    };
+    auto appendUtf8 = [](std::string& out, uint32_t cp) {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    };
+
+    std::string out;
+    out.reserve(raw.size());
+    for (size_t i = 0; i < raw.size(); ++i) {
+        if (raw[i] != '\\' || i + 1 >= raw.size()) {
+            out += raw[i];
+            continue;
+        }
+        const char c = raw[++i];
+        switch (c) {
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                int cp = hex4(i + 1);
+                if (cp < 0) {
+                    out += c;
+                    break;
+                }
+                i += 4;
+                // Суррогатная пара UTF-16; непарный суррогат заменяется на U+FFFD
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    const int low = (i + 2 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u') ? hex4(i + 3) : -1;
+                    if (low >= 0xDC00 && low <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    } else {
+                        cp = 0xFFFD;
+                    }
+                } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    cp = 0xFFFD;
+                }
+                appendUtf8(out, static_cast<uint32_t>(cp));
+                break;
+            }
+            default: out += c; break;  // \" \\ \/
+        }
+    }
+    return out;
+}
+
+bool JsonReader::valid(std::string_view json, size_t* elements) {
+    JsonReader reader(json);
+    size_t count = 0;
+    const Token first = reader.next();
+    if (first == Token::BeginObject || first == Token::BeginArray) {
+        // Считаем токены, открывающие элементы верхнего уровня
+        while (reader.depth() > 0) {
+            const Token token = reader.next();
+            if (token == Token::Error) return false;
+            if (reader.depth() == 1 && token != Token::EndObject && token != Token::EndArray &&
+                (first == Token::BeginArray || token == Token::Key)) {
+                ++count;
+            } else if (reader.depth() == 2 && first == Token::BeginArray &&
+                       (token == Token::BeginObject || token == Token::BeginArray)) {
+                ++count;
+            }
+        }
+    } else if (first == Token::Error) {
+        return false;
+    }
+    if (reader.next() != Token::End) return false;
+    if (elements) *elements = count;
+    return true;
+}
@@ -0,0 +1,113 @@
+#ifndef JSONREADER_H
+#define JSONREADER_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+// Потоковый (pull) разбор JSON за один проход.
+// next() возвращает очередной токен; строки и числа доступны через text() как string_view
+// внутрь исходного текста, без копирования. Escape-последовательности декодируются только
+// по запросу (string()), поэтому ключи и значения без них не аллоцируются вовсе.
+// Синтаксис проверяется строго (RFC 8259): после первой ошибки next() всегда возвращает Error.
+// Исходный текст должен жить, пока используются text() и сам reader.
+class JsonReader {
+public:
+    enum class Token {
+        BeginObject, EndObject,
+        BeginArray, EndArray,
+        Key,            // Ключ члена объекта, text() - без кавычек
+        String,         // text() - без кавычек, escape-последовательности не декодированы
+        Number,         // text() - литерал числа как есть
+        True, False, Null,
+        End,            // Текст разобран целиком
+        Error
+    };
+
+    explicit JsonReader(std::string_view json);
+
+    Token next();
+
+    std::string_view text() const { return m_text; }
+    bool hasEscapes() const { return m_escaped; }
+    // Декодированная строка текущего Key/String
+    std::string string() const;
+
+    size_t depth() const { return m_depth; }
+    bool failed() const { return m_error != nullptr; }
+    const char* error() const { return m_error; }
+    size_t offset() const { return m_pos; }
+
+    // Пропустить следующее значение целиком (вызывать после Key или на месте элемента массива)
+    bool skipValue();
+    // Дочитать контейнер, BeginObject/BeginArray которого только что возвращен
+    bool skipContainer();
+
+    // Прочитать значение, ожидая объект: true - прочитан BeginObject; значение другого
+    // типа пропускается целиком
+    bool nextObject();
+    // Прочитать строковое значение (декодированное); значение другого типа пропускается,
+    // результат пустой
+    std::string nextString();
+
+    // Обход членов объекта, BeginObject которого только что возвращен. onMember(key) либо
+    // читает значение сам и возвращает true, либо возвращает false - тогда значение
+    // пропускается. true - объект дочитан до '}' без ошибок
+    template <typename Fn>
+    bool forEachMember(Fn&& onMember) {
+        while (true) {
+            Token token = next();
+            if (token == Token::EndObject) return true;
+            if (token != Token::Key) return false;
+            if (!onMember(m_text) && !skipValue()) return false;
+            if (failed()) return false;
+        }
+    }
+
+    // Обход элементов массива, BeginArray которого только что возвращен. onElement(token)
+    // получает первый токен элемента; если он вернул false, элемент-контейнер дочитывается
+    template <typename Fn>
+    bool forEachElement(Fn&& onElement) {
+        while (true) {
+            Token token = next();
+            if (token == Token::EndArray) return true;
+            if (token == Token::Error) return false;
+            const bool container = token == Token::BeginObject || token == Token::BeginArray;
+            if (!onElement(token) && container && !skipContainer()) return false;
+            if (failed()) return false;
+        }
+    }
+
+    // Декодирование escape-последовательностей (\uXXXX - в UTF-8)
+    static std::string unescape(std::string_view raw);
+
+    // Текст - ровно одно корректное JSON-значение; elements - число элементов/членов
+    // верхнего массива или объекта
+    static bool valid(std::string_view json, size_t* elements = nullptr);
+
+private:
+    static constexpr size_t MAX_DEPTH = 64;
+
+    Token fail(const char* message);
+    Token readValue();
+    Token readString(Token kind);
+    Token readNumber();
+    Token readLiteral(std::string_view literal, Token kind);
+    Token valueDone(Token kind);
+    void skipWhitespace();
+
+    std::string_view m_json;
+    size_t m_pos = 0;
+    std::string_view m_text;
+    bool m_escaped = false;
+    const char* m_error = nullptr;
+
+    char m_stack[MAX_DEPTH];      // '{' или '[' для каждого открытого контейнера
+    size_t m_depth = 0;
+    bool m_afterValue = false;    // Значение текущего уровня прочитано, ждем ',' или закрытия
+    bool m_afterKey = false;      // Прочитан ключ, ждем ':' и значение
+    bool m_done = false;          // Верхнее значение прочитано
+};
+
+#endif // JSONREADER_H
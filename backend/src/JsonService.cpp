@@ -1,7 +1,9 @@
 #include "JsonService.h"
+#include "JsonReader.h"
 #include <sstream>
 #include <random>
 #include <iomanip>
+#include <cstdio>
 
 std::string JsonService::generateUuid() {
     std::random_device rd;
@@ -29,75 +31,35 @@ std::string JsonService::generateUuid() {
     return ss.str();
 }
 
+// Тело запроса - плоский объект {"email":"...","password":"..."}: строки декодируются,
+// числа и true/false/null сохраняются как есть, вложенные объекты и массивы пропускаются.
+// При ошибке синтаксиса возвращается то, что успели прочитать до нее
 std::map<std::string, std::string> JsonService::parseJson(const std::string& json) {
     std::map<std::string, std::string> result;
-    size_t pos = 0;
-    
-    // Убираем пробелы в начале и конце
-    std::string cleanJson = json;
-    while (!cleanJson.empty() && (cleanJson[0] == ' ' || cleanJson[0] == '\n' || cleanJson[0] == '\t')) {
-        cleanJson.erase(0, 1);
-    }
-    while (!cleanJson.empty() && (cleanJson.back() == ' ' || cleanJson.back() == '\n' || cleanJson.back() == '\t')) {
-        cleanJson.pop_back();
-    }
-    
-    // Убираем фигурные скобки
-    if (cleanJson.front() == '{') cleanJson.erase(0, 1);
-    if (cleanJson.back() == '}') cleanJson.pop_back();
-    
-    pos = 0;
-    while (pos < cleanJson.length()) {
-        // Пропускаем пробелы и запятые
-        while (pos < cleanJson.length() && (cleanJson[pos] == ' ' || cleanJson[pos] == ',' || cleanJson[pos] == '\n' || cleanJson[pos] == '\t')) {
-            pos++;
-        }
-        if (pos >= cleanJson.length()) break;
-        
-        // Ищем ключ
-        if (cleanJson[pos] != '"') {
-            pos++;
-            continue;
-        }
-        
-        size_t keyStart = pos + 1;
-        size_t keyEnd = cleanJson.find('"', keyStart);
-        if (keyEnd == std::string::npos) break;
-        
-        std::string key = cleanJson.substr(keyStart, keyEnd - keyStart);
-        pos = keyEnd + 1;
-        
-        // Пропускаем до двоеточия
-        while (pos < cleanJson.length() && cleanJson[pos] != ':') pos++;
-        if (pos >= cleanJson.length()) break;
-        pos++; // Пропускаем двоеточие
-        
-        // Пропускаем пробелы
-        while (pos < cleanJson.length() && (cleanJson[pos] == ' ' || cleanJson[pos] == '\t')) pos++;
-        if (pos >= cleanJson.length()) break;
-        
-        // Ищем значение
-        if (cleanJson[pos] == '"') {
-            size_t valueStart = pos + 1;
-            size_t valueEnd = cleanJson.find('"', valueStart);
-            if (valueEnd != std::string::npos) {
-                std::string value = cleanJson.substr(valueStart, valueEnd - valueStart);
-                result[key] = value;
-                pos = valueEnd + 1;
-            } else {
-                pos++;
-            }
-        } else {
-            // Значение без кавычек (число, true, false, null)
-            size_t valueStart = pos;
-            while (pos < cleanJson.length() && cleanJson[pos] != ',' && cleanJson[pos] != '}' && cleanJson[pos] != ' ') {
-                pos++;
-            }
-            std::string value = cleanJson.substr(valueStart, pos - valueStart);
-            result[key] = value;
+    JsonReader reader(json);
+    if (reader.next() != JsonReader::Token::BeginObject) return result;
+
+    reader.forEachMember([&](std::string_view) {
+        std::string key = reader.string();
+        switch (reader.next()) {
+            case JsonReader::Token::String:
+                result[key] = reader.string();
+                break;
+            case JsonReader::Token::Number:
+            case JsonReader::Token::True:
+            case JsonReader::Token::False:
+            case JsonReader::Token::Null:
+                result[key] = std::string(reader.text());
+                break;
+            case JsonReader::Token::BeginObject:
+            case JsonReader::Token::BeginArray:
+                reader.skipContainer();
+                break;
+            default:
+                break;
         }
-    }
-    
+        return true;
+    });
     return result;
 }
 
@@ -122,3 +84,26 @@ std::string JsonService::createResponse(bool success, const std::string& message
     return json.str();
 }
 
+
+std::string JsonService::escapeJsonString(const std::string& str) {
+    std::string escaped;
+    escaped.reserve(str.size() + 2);
+    for (char c : str) {
+        switch (c) {
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned char>(c));
+                    escaped += buffer;
+                } else {
+                    escaped += c;
+                }
+        }
+    }
+    return escaped;
+}
@@ -0,0 +1,564 @@
+#include "Logger.h"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <charconv>
+#include <csignal>
+#include <cstring>
+#include <cctype>
+#include <cstdio>
+#include <ctime>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+std::atomic<int> Logger::s_level{static_cast<int>(Logger::Level::Info)};
+thread_local bool Logger::t_sampled = true;
+
+namespace {
+
+// Запись в буфере потока: компонент, сообщение и поля подряд в data
+struct Record {
+    int64_t timestamp;
+    uint8_t level;
+    uint8_t componentLength;
+    uint16_t messageLength;
+    uint16_t fieldsLength;
+    uint8_t reserved[2];
+    char data[Logger::RECORD_SIZE - 16];
+};
+static_assert(sizeof(Record) == Logger::RECORD_SIZE, "запись буфера - RECORD_SIZE байт");
+
+// Кольцевой буфер потока: head двигает поток-владелец, tail - фоновый поток
+struct Ring {
+    explicit Ring(size_t capacity, uint32_t number) : slots(capacity), mask(capacity - 1), thread(number) {}
+
+    std::vector<Record> slots;
+    const uint64_t mask;
+    const uint32_t thread;                  // Номер потока в журнале (по порядку регистрации)
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> closed{false};        // Поток завершился: буфер удаляется, когда опустеет
+};
+
+const char FIELD_KEY_END = '\x1F';
+const char FIELD_END = '\x1E';
+const size_t COMPONENT_MAX = 32;
+
+std::atomic<bool> s_running{false};
+std::atomic<int> s_baseLevel{static_cast<int>(Logger::Level::Info)};  // Уровень без отладки (SIGUSR1)
+std::atomic<uint64_t> s_droppedTotal{0};
+std::atomic<bool> s_toggleRequested{false};  // SIGUSR1; обрабатывается фоновым потоком
+
+Logger::Format s_format = Logger::Format::Text;
+size_t s_ringCapacity = 1024;
+int s_flushIntervalMs = 50;
+std::atomic<int> s_fd{STDOUT_FILENO};
+
+std::mutex s_ringsMutex;
+std::vector<std::shared_ptr<Ring>>* s_rings = nullptr;  // Под s_ringsMutex
+uint32_t s_nextThread = 1;
+
+std::mutex s_writerMutex;
+std::condition_variable s_writerWake;
+std::thread s_writerThread;
+bool s_writerStop = false;
+
+// Вывод до start() и после stop(): по строке, сразу
+std::mutex s_syncMutex;
+
+// Маршруты с выборкой: порог для 32-битного случайного числа; заполняется до приема запросов
+std::vector<std::pair<std::string, uint64_t>> s_sampling;
+
+thread_local std::chrono::steady_clock::time_point t_requestStart;
+thread_local uint64_t t_random = 0;
+
+// Буфер потока; при завершении потока помечается закрытым
+struct RingHolder {
+    std::shared_ptr<Ring> ring;
+    ~RingHolder() {
+        if (ring) ring->closed.store(true, std::memory_order_release);
+    }
+};
+thread_local RingHolder t_ring;
+
+uint32_t nextRandom() {
+    if (t_random == 0) {
+        t_random = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) ^
+                   (reinterpret_cast<uintptr_t>(&t_random) * 0x9E3779B97F4A7C15ULL) ^ 1;
+    }
+    // xorshift64*
+    t_random ^= t_random >> 12;
+    t_random ^= t_random << 25;
+    t_random ^= t_random >> 27;
+    return static_cast<uint32_t>((t_random * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+void appendJsonString(std::string& out, std::string_view text) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+// Значение поля в текстовом формате: в кавычках, если в нем пробелы или кавычки
+void appendTextValue(std::string& out, std::string_view value) {
+    const bool plain = !value.empty() && value.find_first_of(" \t\n\r\"=") == std::string_view::npos;
+    if (plain) {
+        out += value;
+    } else {
+        appendJsonString(out, value);
+    }
+}
+
+// Длина не больше limit, не разрывая символ UTF-8
+size_t utf8Prefix(std::string_view text, size_t limit) {
+    if (text.size() <= limit) return text.size();
+    size_t length = limit;
+    while (length > 0 && (static_cast<unsigned char>(text[length]) & 0xC0) == 0x80) --length;
+    return length;
+}
+
+// Локальное время с миллисекундами; секунда форматируется один раз
+void appendTimestamp(std::string& out, int64_t timestampNs, bool iso) {
+    thread_local time_t cachedSecond = -1;
+    thread_local bool cachedIso = false;
+    thread_local char cachedText[32];
+
+    const time_t second = static_cast<time_t>(timestampNs / 1000000000);
+    if (second != cachedSecond || iso != cachedIso) {
+        std::tm local{};
+        localtime_r(&second, &local);
+        std::strftime(cachedText, sizeof(cachedText), iso ? "%Y-%m-%dT%H:%M:%S" : "%Y-%m-%d %H:%M:%S", &local);
+        cachedSecond = second;
+        cachedIso = iso;
+    }
+    char millis[8];
+    std::snprintf(millis, sizeof(millis), ".%03d", static_cast<int>((timestampNs / 1000000) % 1000));
+    out += cachedText;
+    out += millis;
+}
+
+void writeOut(const std::string& text) {
+    const char* data = text.data();
+    size_t remaining = text.size();
+    while (remaining > 0) {
+        const ssize_t written = ::write(s_fd.load(std::memory_order_relaxed), data, remaining);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += written;
+        remaining -= static_cast<size_t>(written);
+    }
+}
+
+void format(const Record& record, uint32_t thread, std::string& out) {
+    const std::string_view component(record.data, record.componentLength);
+    const std::string_view message(record.data + record.componentLength, record.messageLength);
+    std::string_view fields(record.data + record.componentLength + record.messageLength, record.fieldsLength);
+    const char* name = Logger::levelName(static_cast<Logger::Level>(record.level));
+
+    if (s_format == Logger::Format::Json) {
+        out += "{\"ts\":\"";
+        appendTimestamp(out, record.timestamp, true);
+        out += "\",\"level\":\"";
+        out += name;
+        out += "\",\"component\":";
+        appendJsonString(out, component);
+        out += ",\"thread\":";
+        out += std::to_string(thread);
+        out += ",\"msg\":";
+        appendJsonString(out, message);
+    } else {
+        appendTimestamp(out, record.timestamp, false);
+        out += ' ';
+        out += name;
+        out.append(6 - std::strlen(name), ' ');
+        out += '[';
+        out += component;
+        out += "] ";
+        out += message;
+    }
+
+    while (!fields.empty()) {
+        const size_t keyEnd = fields.find(FIELD_KEY_END);
+        const size_t end = fields.find(FIELD_END);
+        if (keyEnd == std::string_view::npos || end == std::string_view::npos || keyEnd > end) break;
+        const bool number = fields[0] == 'n';
+        const std::string_view key = fields.substr(1, keyEnd - 1);
+        const std::string_view value = fields.substr(keyEnd + 1, end - keyEnd - 1);
+        if (s_format == Logger::Format::Json) {
+            out += ',';
+            appendJsonString(out, key);
+            out += ':';
+            if (number) {
+                out += value;
+            } else {
+                appendJsonString(out, value);
+            }
+        } else {
+            out += ' ';
+            out += key;
+            out += '=';
+            appendTextValue(out, value);
+        }
+        fields.remove_prefix(end + 1);
+    }
+
+    out += s_format == Logger::Format::Json ? "}\n" : "\n";
+}
+
+// Буфер текущего потока; регистрируется при первой записи
+Ring* threadRing() {
+    if (!t_ring.ring) {
+        std::lock_guard<std::mutex> lock(s_ringsMutex);
+        if (!s_rings) return nullptr;
+        t_ring.ring = std::make_shared<Ring>(s_ringCapacity, s_nextThread++);
+        s_rings->push_back(t_ring.ring);
+    }
+    return t_ring.ring.get();
+}
+
+void onToggleSignal(int) {
+    s_toggleRequested.store(true, std::memory_order_relaxed);
+}
+
+} // namespace
+
+void Logger::start(const Options& options) {
+    std::lock_guard<std::mutex> lock(s_writerMutex);
+    if (s_running.load()) return;
+
+    s_format = options.format;
+    s_flushIntervalMs = std::max(1, options.flushIntervalMs);
+    size_t capacity = 16;
+    while (capacity < options.ringCapacity) capacity <<= 1;
+    s_ringCapacity = capacity;
+    s_level.store(static_cast<int>(options.level));
+    s_baseLevel.store(static_cast<int>(options.level));
+
+    if (!options.path.empty()) {
+        const int fd = ::open(options.path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd >= 0) {
+            s_fd.store(fd);
+        } else {
+            std::string message = "⚠️ [Logger] Не удалось открыть " + options.path + ": " + std::strerror(errno) +
+                                  ", журнал пишется в stdout\n";
+            writeOut(message);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> ringsLock(s_ringsMutex);
+        if (!s_rings) s_rings = new std::vector<std::shared_ptr<Ring>>();
+    }
+    s_writerStop = false;
+    s_running.store(true, std::memory_order_release);
+    s_writerThread = std::thread(&Logger::writerLoop);
+}
+
+void Logger::stop() {
+    {
+        std::lock_guard<std::mutex> lock(s_writerMutex);
+        if (!s_running.load()) return;
+        // Новые записи - сразу в вывод; фоновый поток дописывает накопленное
+        s_running.store(false, std::memory_order_release);
+        s_writerStop = true;
+    }
+    s_writerWake.notify_all();
+    if (s_writerThread.joinable()) s_writerThread.join();
+    // Записи потоков, успевших застать s_running до остановки
+    drain();
+
+    const int fd = s_fd.exchange(STDOUT_FILENO);
+    if (fd != STDOUT_FILENO) ::close(fd);
+}
+
+void Logger::setLevel(Level level) {
+    s_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+Logger::Level Logger::parseLevel(std::string_view name, Level fallback) {
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (lower == "debug") return Level::Debug;
+    if (lower == "info") return Level::Info;
+    if (lower == "warn" || lower == "warning") return Level::Warn;
+    if (lower == "error") return Level::Error;
+    if (lower == "off" || lower == "none") return Level::Off;
+    return fallback;
+}
+
+const char* Logger::levelName(Level level) {
+    switch (level) {
+        case Level::Debug: return "DEBUG";
+        case Level::Info: return "INFO";
+        case Level::Warn: return "WARN";
+        case Level::Error: return "ERROR";
+        case Level::Off: return "OFF";
+    }
+    return "?";
+}
+
+void Logger::installSignalHandlers() {
+    struct sigaction action {};
+    action.sa_handler = onToggleSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, nullptr);
+}
+
+void Logger::setSampling(const std::string& route, double rate) {
+    rate = std::clamp(rate, 0.0, 1.0);
+    const uint64_t threshold = static_cast<uint64_t>(rate * 4294967296.0);
+    for (auto& entry : s_sampling) {
+        if (entry.first == route) {
+            entry.second = threshold;
+            return;
+        }
+    }
+    s_sampling.emplace_back(route, threshold);
+}
+
+void Logger::configureSampling(const std::string& spec) {
+    size_t start = 0;
+    while (start < spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == std::string::npos) end = spec.size();
+        const std::string item = spec.substr(start, end - start);
+        const size_t equals = item.find('=');
+        if (equals != std::string::npos && equals > 0) {
+            try {
+                setSampling(item.substr(0, equals), std::stod(item.substr(equals + 1)));
+            } catch (const std::exception&) {
+                LOG_WARN("Logger") << "⚠️ Некорректная доля выборки: " << item;
+            }
+        }
+        start = end + 1;
+    }
+}
+
+void Logger::beginRequest(std::string_view route) {
+    t_requestStart = std::chrono::steady_clock::now();
+    t_sampled = true;
+    for (const auto& entry : s_sampling) {
+        if (entry.first == route) {
+            t_sampled = nextRandom() < entry.second;
+            break;
+        }
+    }
+}
+
+double Logger::requestElapsedMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_requestStart).count();
+}
+
+uint64_t Logger::dropped() {
+    uint64_t total = s_droppedTotal.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(s_ringsMutex);
+    if (s_rings) {
+        for (const auto& ring : *s_rings) total += ring->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+// ---- Запись ----
+
+Logger::Line::Line(Level level, std::string_view component)
+    : m_timestamp(std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch()).count()),
+      m_level(level),
+      m_component(component) {}
+
+Logger::Line::~Line() {
+    Logger::submit(*this);
+}
+
+void Logger::Line::appendMessage(std::string_view text) {
+    const size_t length = utf8Prefix(text, MESSAGE_CAPACITY - m_messageLength);
+    std::memcpy(m_message + m_messageLength, text.data(), length);
+    m_messageLength += length;
+}
+
+void Logger::Line::appendField(std::string_view key, std::string_view value, bool number) {
+    // Поле целиком или никак: обрезанное значение вводило бы в заблуждение
+    const size_t length = 1 + key.size() + 1 + value.size() + 1;
+    if (length > FIELDS_CAPACITY - m_fieldsLength) return;
+    char* out = m_fields + m_fieldsLength;
+    *out++ = number ? 'n' : 's';
+    std::memcpy(out, key.data(), key.size());
+    out += key.size();
+    *out++ = FIELD_KEY_END;
+    std::memcpy(out, value.data(), value.size());
+    out += value.size();
+    *out++ = FIELD_END;
+    m_fieldsLength += length;
+}
+
+Logger::Line::Number Logger::Line::formatNumber(long long value) {
+    Number number{};
+    number.length = static_cast<size_t>(std::to_chars(number.text, number.text + sizeof(number.text), value).ptr - number.text);
+    return number;
+}
+
+Logger::Line::Number Logger::Line::formatNumber(unsigned long long value) {
+    Number number{};
+    number.length = static_cast<size_t>(std::to_chars(number.text, number.text + sizeof(number.text), value).ptr - number.text);
+    return number;
+}
+
+Logger::Line::Number Logger::Line::formatNumber(double value) {
+    Number number{};
+    const int length = std::snprintf(number.text, sizeof(number.text), "%.6g", value);
+    number.length = length > 0 ? std::min(static_cast<size_t>(length), sizeof(number.text) - 1) : 0;
+    return number;
+}
+
+// ---- Буферы и фоновый поток ----
+
+void Logger::submit(const Line& line) {
+    Record record;
+    record.timestamp = line.m_timestamp;
+    record.level = static_cast<uint8_t>(line.m_level);
+
+    // Поля важнее хвоста сообщения: сообщение обрезается под оставшееся место
+    const size_t component = utf8Prefix(line.m_component, COMPONENT_MAX);
+    size_t fields = line.m_fieldsLength;
+    const size_t capacity = sizeof(record.data) - component;
+    while (fields > capacity) {
+        --fields;
+        while (fields > 0 && line.m_fields[fields - 1] != FIELD_END) --fields;
+    }
+    const size_t message = utf8Prefix(std::string_view(line.m_message, line.m_messageLength), capacity - fields);
+
+    record.componentLength = static_cast<uint8_t>(component);
+    record.messageLength = static_cast<uint16_t>(message);
+    record.fieldsLength = static_cast<uint16_t>(fields);
+    std::memcpy(record.data, line.m_component.data(), component);
+    std::memcpy(record.data + component, line.m_message, message);
+    std::memcpy(record.data + component + message, line.m_fields, fields);
+
+    if (!s_running.load(std::memory_order_acquire)) {
+        std::string text;
+        format(record, 0, text);
+        std::lock_guard<std::mutex> lock(s_syncMutex);
+        writeOut(text);
+        return;
+    }
+
+    Ring* ring = threadRing();
+    if (!ring) return;
+
+    const uint64_t head = ring->head.load(std::memory_order_relaxed);
+    const uint64_t tail = ring->tail.load(std::memory_order_acquire);
+    if (head - tail >= ring->slots.size()) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ring->slots[head & ring->mask] = record;
+    ring->head.store(head + 1, std::memory_order_release);
+
+    // Ошибки и заполненный наполовину буфер не ждут очередного интервала
+    if (line.m_level >= Level::Error || head - tail + 1 == ring->slots.size() / 2) {
+        s_writerWake.notify_one();
+    }
+}
+
+void Logger::writerLoop() {
+    while (true) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(s_writerMutex);
+            s_writerWake.wait_for(lock, std::chrono::milliseconds(s_flushIntervalMs), [] { return s_writerStop; });
+            stopping = s_writerStop;
+        }
+
+        if (s_toggleRequested.exchange(false, std::memory_order_relaxed)) {
+            const Level next = level() == Level::Debug
+                ? std::max(static_cast<Level>(s_baseLevel.load()), Level::Info)
+                : Level::Debug;
+            setLevel(next);
+            LOG_WARN("Logger") << "🔧 Уровень журнала: " << levelName(next) << " (SIGUSR1)";
+        }
+
+        // Сообщение о переполнении попадает в буфер этого потока и выводится следующим проходом
+        if (!drain() && stopping) break;
+    }
+}
+
+bool Logger::drain() {
+    struct Pending {
+        size_t index;
+        uint32_t thread;
+    };
+    thread_local std::vector<Record> batch;
+    thread_local std::vector<Pending> pending;
+    thread_local std::string out;
+
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(s_ringsMutex);
+        if (!s_rings) return false;
+        rings = *s_rings;
+    }
+
+    // Копии записей: буфер освобождается до форматирования и записи
+    batch.clear();
+    pending.clear();
+    uint64_t dropped = 0;
+    for (const auto& ring : rings) {
+        const uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        for (uint64_t i = tail; i < head; ++i) {
+            batch.push_back(ring->slots[i & ring->mask]);
+            pending.push_back({batch.size() - 1, ring->thread});
+        }
+        ring->tail.store(head, std::memory_order_release);
+        dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+    // Потоки пишут независимо: общий порядок - по времени записи
+    std::stable_sort(pending.begin(), pending.end(), [](const Pending& a, const Pending& b) {
+        return batch[a.index].timestamp < batch[b.index].timestamp;
+    });
+    out.clear();
+    for (const auto& entry : pending) format(batch[entry.index], entry.thread, out);
+    if (!out.empty()) writeOut(out);
+
+    if (dropped > 0) {
+        s_droppedTotal.fetch_add(dropped, std::memory_order_relaxed);
+        LOG_WARN("Logger").field("dropped", dropped) << "⚠️ Буферы журнала переполнены, записи отброшены";
+    }
+
+    // Буферы завершившихся потоков, из которых все прочитано
+    {
+        std::lock_guard<std::mutex> lock(s_ringsMutex);
+        s_rings->erase(std::remove_if(s_rings->begin(), s_rings->end(), [](const std::shared_ptr<Ring>& ring) {
+            return ring->closed.load(std::memory_order_acquire) &&
+                   ring->tail.load(std::memory_order_relaxed) == ring->head.load(std::memory_order_acquire);
+        }), s_rings->end());
+    }
+
+    return !pending.empty() || dropped > 0;
+}
+
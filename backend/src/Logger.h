@@ -0,0 +1,167 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <vector>
+#include <utility>
+#include <atomic>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+// Асинхронный структурированный журнал сервера.
+// Запись (LOG_INFO("Cities").field("key", value) << "сообщение") собирается на
+// стеке и копируется в кольцевой буфер своего потока (один писатель, один читатель, без
+// блокировок); фоновый поток раз в flushIntervalMs забирает записи из всех буферов и
+// пишет их одним write() - обработчики запросов не ждут вывода и не делят lock iostream.
+// Переполненный буфер не блокирует поток: запись отбрасывается и учитывается в счетчике.
+//
+// Формат строки - текст ("время УРОВЕНЬ [компонент] сообщение key=value") или JSON
+// (по объекту на строку). Уровень проверяется до вычисления аргументов, поэтому отладочные
+// записи при выключенном Debug стоят одно атомарное чтение. Уровень меняется на ходу:
+// setLevel() или сигнал SIGUSR1 (переключение между заданным уровнем и Debug).
+//
+// Для частых маршрутов можно задать долю запросов, записи Debug/Info которых попадают в
+// журнал (setSampling): решение принимается один раз на запрос (beginRequest), Warn и
+// Error пишутся всегда. До start() и после stop() записи выводятся сразу (утилиты).
+class Logger {
+public:
+    enum class Level : int { Debug = 0, Info, Warn, Error, Off };
+    enum class Format { Text, Json };
+
+    struct Options {
+        Level level = Level::Info;
+        Format format = Format::Text;
+        std::string path;               // Файл журнала (дописывается); пусто - stdout
+        size_t ringCapacity = 1024;     // Записей в буфере потока (степень двойки)
+        int flushIntervalMs = 50;
+    };
+
+    // Размер записи в буфере: длиннее - сообщение и поля обрезаются
+    static constexpr size_t RECORD_SIZE = 512;
+
+    static void start(const Options& options);
+    // Дописать накопленное и остановить фоновый поток (до выхода из main())
+    static void stop();
+
+    static void setLevel(Level level);
+    static Level level() { return static_cast<Level>(s_level.load(std::memory_order_relaxed)); }
+    // "debug", "info", "warn", "error", "off"; иначе fallback
+    static Level parseLevel(std::string_view name, Level fallback);
+    static const char* levelName(Level level);
+    // SIGUSR1 - переключить Debug
+    static void installSignalHandlers();
+
+    // Доля запросов маршрута (точное совпадение пути), записи Debug/Info которых пишутся.
+    // Вызывать до приема запросов; spec - "путь=доля,путь=доля"
+    static void setSampling(const std::string& route, double rate);
+    static void configureSampling(const std::string& spec);
+    // Начало обработки запроса в текущем потоке: решение о выборке и время начала
+    static void beginRequest(std::string_view route);
+    static bool requestSampled() { return t_sampled; }
+    static double requestElapsedMs();
+    static void endRequest() { t_sampled = true; }
+
+    static bool enabled(Level level) {
+        const int value = static_cast<int>(level);
+        return value >= s_level.load(std::memory_order_relaxed) &&
+               (value >= static_cast<int>(Level::Warn) || t_sampled);
+    }
+
+    // Отброшено записей из-за переполненных буферов
+    static uint64_t dropped();
+
+    // Запись журнала; отправляется в буфер потока в деструкторе
+    class Line {
+    public:
+        Line(Level level, std::string_view component);
+        ~Line();
+        Line(const Line&) = delete;
+        Line& operator=(const Line&) = delete;
+
+        Line& operator<<(std::string_view text) { appendMessage(text); return *this; }
+        Line& operator<<(const char* text) { appendMessage(text ? std::string_view(text) : std::string_view("(null)")); return *this; }
+        Line& operator<<(const std::string& text) { appendMessage(text); return *this; }
+        Line& operator<<(char c) { appendMessage(std::string_view(&c, 1)); return *this; }
+        Line& operator<<(bool value) { appendMessage(value ? "true" : "false"); return *this; }
+        template <typename T>
+        Line& operator<<(const T& value) {
+            if constexpr (std::is_integral_v<T> || std::is_floating_point_v<T>) {
+                appendMessage(formatNumber(value));
+            } else {
+                std::ostringstream out;
+                out << value;
+                appendMessage(out.str());
+            }
+            return *this;
+        }
+
+        Line& field(std::string_view key, std::string_view value) { appendField(key, value, false); return *this; }
+        Line& field(std::string_view key, const char* value) { return field(key, std::string_view(value ? value : "")); }
+        Line& field(std::string_view key, const std::string& value) { return field(key, std::string_view(value)); }
+        Line& field(std::string_view key, bool value) { appendField(key, value ? "true" : "false", true); return *this; }
+        template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+        Line& field(std::string_view key, T value) {
+            appendField(key, formatNumber(value), std::is_integral_v<T> || std::isfinite(static_cast<double>(value)));
+            return *this;
+        }
+
+    private:
+        friend class Logger;
+
+        void appendMessage(std::string_view text);
+        void appendField(std::string_view key, std::string_view value, bool number);
+
+        struct Number {
+            char text[32];
+            size_t length;
+            operator std::string_view() const { return std::string_view(text, length); }
+        };
+        static Number formatNumber(long long value);
+        static Number formatNumber(unsigned long long value);
+        static Number formatNumber(double value);
+        template <typename T>
+        static Number formatNumber(T value) {
+            if constexpr (std::is_floating_point_v<T>) return formatNumber(static_cast<double>(value));
+            else if constexpr (std::is_signed_v<T>) return formatNumber(static_cast<long long>(value));
+            else return formatNumber(static_cast<unsigned long long>(value));
+        }
+
+        static constexpr size_t MESSAGE_CAPACITY = 384;
+        static constexpr size_t FIELDS_CAPACITY = 256;
+
+        int64_t m_timestamp;            // Наносекунды от эпохи (system_clock)
+        Level m_level;
+        std::string_view m_component;
+        size_t m_messageLength = 0;
+        size_t m_fieldsLength = 0;
+        char m_message[MESSAGE_CAPACITY];
+        char m_fields[FIELDS_CAPACITY];  // Поля: тип ('s'/'n'), ключ, \x1F, значение, \x1E
+    };
+
+    // Превращает выражение записи в void: LOG_* - выражение, а не if без else
+    struct Voidify {
+        void operator&(const Line&) {}
+    };
+
+private:
+    static void submit(const Line& line);
+    static void writerLoop();
+    // Вывести записи из всех буферов; false - выводить было нечего
+    static bool drain();
+
+    static std::atomic<int> s_level;
+    static thread_local bool t_sampled;
+};
+
+#define LOG_AT(level, component) \
+    !Logger::enabled(level) ? (void)0 : Logger::Voidify() & Logger::Line(level, component)
+#define LOG_DEBUG(component) LOG_AT(Logger::Level::Debug, component)
+#define LOG_INFO(component) LOG_AT(Logger::Level::Info, component)
+#define LOG_WARN(component) LOG_AT(Logger::Level::Warn, component)
+#define LOG_ERROR(component) LOG_AT(Logger::Level::Error, component)
+
+#endif // LOGGER_H
@@ -0,0 +1,146 @@
+#include "PrayerTimeline.h"
+#include <cmath>
+#include <limits>
+
+PrayerTimeline::PrayerTimeline(const PrayerTimesCalculator::Times& yesterday,
+                               const PrayerTimesCalculator::Times& today,
+                               const PrayerTimesCalculator::Times& tomorrow) {
+    append(yesterday, -1);
+    append(today, 0);
+    append(tomorrow, 1);
+
+    // Соседние дни могут перекрываться (Иша вчера после Фаджра сегодня в высоких широтах):
+    // сортировка вставками - событий не больше 18
+    for (size_t i = 1; i < m_count; ++i) {
+        const int32_t second = m_seconds[i];
+        const Prayer prayer = m_prayers[i];
+        size_t j = i;
+        for (; j > 0 && m_seconds[j - 1] > second; --j) {
+            m_seconds[j] = m_seconds[j - 1];
+            m_prayers[j] = m_prayers[j - 1];
+        }
+        m_seconds[j] = second;
+        m_prayers[j] = prayer;
+    }
+
+    pad();
+}
+
+// Хвост заполняется максимальным значением, чтобы поиск шел по массиву полного размера
+void PrayerTimeline::pad() {
+    for (size_t i = m_count; i < MAX_EVENTS; ++i) {
+        m_seconds[i] = std::numeric_limits<int32_t>::max();
+        m_prayers[i] = Prayer::Isha;
+    }
+}
+
+std::string PrayerTimeline::serialize() const {
+    std::string data;
+    data.reserve(m_count * 5);
+    for (size_t i = 0; i < m_count; ++i) {
+        const uint32_t second = static_cast<uint32_t>(m_seconds[i]);
+        for (int shift = 0; shift < 32; shift += 8) {
+            data.push_back(static_cast<char>((second >> shift) & 0xFF));
+        }
+        data.push_back(static_cast<char>(m_prayers[i]));
+    }
+    return data;
+}
+
+std::optional<PrayerTimeline> PrayerTimeline::deserialize(const std::string& data) {
+    if (data.size() % 5 != 0 || data.size() / 5 > MAX_EVENTS) return std::nullopt;
+
+    PrayerTimeline timeline;
+    timeline.m_count = data.size() / 5;
+    for (size_t i = 0; i < timeline.m_count; ++i) {
+        uint32_t second = 0;
+        for (int byte = 0; byte < 4; ++byte) {
+            second |= static_cast<uint32_t>(static_cast<unsigned char>(data[i * 5 + byte])) << (8 * byte);
+        }
+        const int prayer = static_cast<unsigned char>(data[i * 5 + 4]);
+        if (prayer > static_cast<int>(Prayer::Isha)) return std::nullopt;
+
+        timeline.m_seconds[i] = static_cast<int32_t>(second);
+        timeline.m_prayers[i] = static_cast<Prayer>(prayer);
+        if (i > 0 && timeline.m_seconds[i] < timeline.m_seconds[i - 1]) return std::nullopt;
+    }
+    timeline.pad();
+    return timeline;
+}
+
+PrayerTimeline PrayerTimeline::build(const PrayerTimesCalculator::Request& request,
+                                     PrayerTimesCalculator::Times& today) {
+    const PrayerTimesCalculator::Context context = PrayerTimesCalculator::prepare(request);
+    const double julianDay = PrayerTimesCalculator::julianDayFromDays(
+        PrayerTimesCalculator::daysFromCivil(request.year, request.month, request.day));
+    today = PrayerTimesCalculator::computeDay(context, julianDay);
+    return PrayerTimeline(PrayerTimesCalculator::computeDay(context, julianDay - 1.0), today,
+                          PrayerTimesCalculator::computeDay(context, julianDay + 1.0));
+}
+
+void PrayerTimeline::append(const PrayerTimesCalculator::Times& times, int dayOffset) {
+    const std::pair<double, Prayer> events[] = {
+        {times.fajr, Prayer::Fajr},
+        {times.sunrise, Prayer::Sunrise},
+        {times.dhuhr, Prayer::Dhuhr},
+        {times.asr, Prayer::Asr},
+        {times.maghrib, Prayer::Maghrib},
+        {times.isha, Prayer::Isha}
+    };
+
+    // Времена нормализованы в 0-24, поэтому опорой служит полдень (Зухр): утренние события
+    // позже него относятся к предыдущим суткам, вечерние раньше него - к следующим
+    const double dhuhr = std::isnan(times.dhuhr) ? 12.0 : times.dhuhr;
+    for (size_t i = 0; i < 6; ++i) {
+        double hours = events[i].first;
+        if (std::isnan(hours)) continue;
+        if (i < 2 && hours > dhuhr) hours -= 24.0;
+        if (i > 2 && hours < dhuhr) hours += 24.0;
+
+        // Округление до минуты, как в отображаемом времени (formatTime)
+        const int32_t minute = static_cast<int32_t>(std::lround(hours * 60.0));
+        m_seconds[m_count] = (dayOffset * 24 * 60 + minute) * 60;
+        m_prayers[m_count] = events[i].second;
+        ++m_count;
+    }
+}
+
+ptrdiff_t PrayerTimeline::lastAtOrBefore(int32_t now) const {
+    // Бинарный поиск без ветвлений: условие превращается в условное перемещение (cmov)
+    const int32_t* base = m_seconds;
+    size_t length = MAX_EVENTS;
+    while (length > 1) {
+        const size_t half = length / 2;
+        base = (base[half] <= now) ? base + half : base;
+        length -= half;
+    }
+    return (base - m_seconds) - (*base > now ? 1 : 0);
+}
+
+PrayerTimeline::Position PrayerTimeline::locate(int32_t now) const {
+    Position position;
+    if (m_count == 0) {
+        position.current = {now, Prayer::Isha};
+        position.next = {now, Prayer::Fajr};
+        position.secondsUntilNext = 0;
+        return position;
+    }
+
+    ptrdiff_t index = lastAtOrBefore(now);
+    // Вне шкалы (не бывает для now в пределах суток при обычных широтах) - крайние события
+    if (index < 0) index = 0;
+    const size_t next = static_cast<size_t>(index) + 1 < m_count ? static_cast<size_t>(index) + 1 : m_count - 1;
+
+    position.current = {m_seconds[index], m_prayers[index]};
+    position.next = {m_seconds[next], m_prayers[next]};
+    position.secondsUntilNext = position.next.second > now ? position.next.second - now : 0;
+    return position;
+}
+
+size_t PrayerTimeline::upcoming(int32_t now, Event* out, size_t count) const {
+    size_t written = 0;
+    for (size_t i = static_cast<size_t>(lastAtOrBefore(now) + 1); i < m_count && written < count; ++i) {
+        out[written++] = {m_seconds[i], m_prayers[i]};
+    }
+    return written;
+}
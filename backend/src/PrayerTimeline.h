@@ -0,0 +1,67 @@
+#ifndef PRAYERTIMELINE_H
+#define PRAYERTIMELINE_H
+
+#include "PrayerTimesCalculator.h"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <optional>
+
+// Временная шкала событий (Fajr..Isha) за вчера, сегодня и завтра: отсортированный массив
+// секунд от местной полуночи текущего дня (вчерашние события отрицательные, завтрашние
+// больше 86400). Иша после полуночи и Фаджр до нее остаются на своем месте в шкале,
+// поэтому текущая/следующая молитва на стыке суток определяются правильно.
+// Поиск - бинарный без ветвлений по массиву фиксированного размера.
+class PrayerTimeline {
+public:
+    using Prayer = PrayerTimesCalculator::Prayer;
+
+    static constexpr size_t MAX_EVENTS = 18;  // 3 дня по 6 событий
+
+    struct Event {
+        int32_t second;  // Секунды от местной полуночи текущего дня
+        Prayer prayer;
+    };
+
+    struct Position {
+        Event current;
+        Event next;
+        int32_t secondsUntilNext;
+    };
+
+    // Шкала из времен трех соседних дней (часы местного времени, как у computeDay).
+    // События, которых нет (полярный день/ночь, NaN), пропускаются
+    PrayerTimeline(const PrayerTimesCalculator::Times& yesterday,
+                   const PrayerTimesCalculator::Times& today,
+                   const PrayerTimesCalculator::Times& tomorrow);
+
+    // Расчет дня запроса и соседних дней; времена дня запроса записываются в today
+    static PrayerTimeline build(const PrayerTimesCalculator::Request& request,
+                                PrayerTimesCalculator::Times& today);
+
+    // Текущее и следующее событие для момента now (секунды от местной полуночи сегодня)
+    Position locate(int32_t now) const;
+
+    // До count ближайших событий после now; возвращает, сколько записано в out
+    size_t upcoming(int32_t now, Event* out, size_t count) const;
+
+    size_t size() const { return m_count; }
+
+    // Компактная запись для постоянного кеша: на событие 4 байта секунды (little-endian)
+    // и 1 байт молитвы. deserialize возвращает nullopt для поврежденных данных
+    std::string serialize() const;
+    static std::optional<PrayerTimeline> deserialize(const std::string& data);
+
+private:
+    PrayerTimeline() = default;
+    void pad();
+    void append(const PrayerTimesCalculator::Times& times, int dayOffset);
+    // Индекс последнего события с секундой <= now (-1, если таких нет)
+    ptrdiff_t lastAtOrBefore(int32_t now) const;
+
+    int32_t m_seconds[MAX_EVENTS];
+    Prayer m_prayers[MAX_EVENTS];
+    size_t m_count = 0;
+};
+
+#endif // PRAYERTIMELINE_H
@@ -0,0 +1,160 @@
+#include "PrayerTimesCache.h"
+#include <cmath>
+#include <mutex>
+
+PrayerTimesCache::PrayerTimesCache(double cellDegrees, size_t maxBytes)
+    : m_cellDegrees(cellDegrees > 0.0 ? cellDegrees : 0.01),
+      m_shardCapacity(maxBytes / SHARD_COUNT) {
+}
+
+size_t PrayerTimesCache::KeyHash::operator()(const Key& key) const {
+    uint64_t h = static_cast<uint32_t>(key.latitudeCell);
+    h = h * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>(key.longitudeCell);
+    h = h * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>(key.days);
+    h = h * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>(key.timeZone);
+    h = h * 0x9E3779B97F4A7C15ull ^ (static_cast<uint32_t>(key.method) << 16 | static_cast<uint16_t>(key.madhhab));
+    return static_cast<size_t>(h ^ (h >> 29));
+}
+
+PrayerTimesCache::Key PrayerTimesCache::makeKey(double latitude, double longitude, int days, int method,
+                                                int madhhab, int timeZoneId, double fixedHours) const {
+    Key key;
+    key.latitudeCell = static_cast<int32_t>(std::lround(latitude / m_cellDegrees));
+    key.longitudeCell = static_cast<int32_t>(std::lround(longitude / m_cellDegrees));
+    key.days = days;
+    // Зоны IANA - неотрицательные индексы, фиксированное смещение - отрицательное число минут-1
+    key.timeZone = timeZoneId >= 0 ? timeZoneId
+                                   : -1 - static_cast<int32_t>(std::lround(fixedHours * 60.0) + 24 * 60);
+    key.method = static_cast<int16_t>(method);
+    key.madhhab = static_cast<int16_t>(madhhab);
+    return key;
+}
+
+std::shared_ptr<const PrayerTimesCache::Entry> PrayerTimesCache::find(const Key& key, int64_t utcNow) {
+    if (!enabled()) return nullptr;
+
+    Shard& shard = shardFor(key);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    const Slot& slot = shard.slots[it->second];
+    if (slot.entry->expiresAt <= utcNow) {
+        // Истекшая запись будет перезаписана вставкой или вытеснена
+        m_expirations.fetch_add(1, std::memory_order_relaxed);
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    slot.referenced.store(true, std::memory_order_relaxed);
+    slot.hits.fetch_add(1, std::memory_order_relaxed);
+    m_hits.fetch_add(1, std::memory_order_relaxed);
+    return slot.entry;
+}
+
+void PrayerTimesCache::insert(const Key& key, std::shared_ptr<const Entry> entry, bool persisted) {
+    if (!enabled() || !entry) return;
+
+    const size_t bytes = sizeof(Slot) + sizeof(Entry) + entry->body.capacity() + 64;  // 64 - узел индекса
+    if (bytes > m_shardCapacity) return;
+
+    Shard& shard = shardFor(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        // Гонка двух промахов или обновление истекшей записи
+        Slot& slot = shard.slots[it->second];
+        shard.bytes = shard.bytes - slot.bytes + bytes;
+        slot.entry = std::move(entry);
+        slot.bytes = bytes;
+        slot.referenced.store(true, std::memory_order_relaxed);
+        slot.dirty.store(!persisted, std::memory_order_relaxed);
+        return;
+    }
+
+    while (shard.bytes + bytes > m_shardCapacity && !shard.index.empty()) {
+        evictOne(shard);
+    }
+
+    size_t index;
+    if (!shard.freeSlots.empty()) {
+        index = shard.freeSlots.back();
+        shard.freeSlots.pop_back();
+    } else {
+        index = shard.slots.size();
+        shard.slots.emplace_back();
+    }
+
+    Slot& slot = shard.slots[index];
+    slot.key = key;
+    slot.entry = std::move(entry);
+    slot.bytes = bytes;
+    // Новая запись получает "второй шанс" только после первого попадания
+    slot.referenced.store(false, std::memory_order_relaxed);
+    slot.hits.store(0, std::memory_order_relaxed);
+    slot.dirty.store(!persisted, std::memory_order_relaxed);
+    shard.index.emplace(key, index);
+    shard.bytes += bytes;
+    m_insertions.fetch_add(1, std::memory_order_relaxed);
+}
+
+// CLOCK: стрелка обходит слоты, снимая бит обращения; вытесняется первый слот без него
+void PrayerTimesCache::evictOne(Shard& shard) {
+    const size_t count = shard.slots.size();
+    for (size_t step = 0; step < 2 * count + 1; ++step) {
+        const size_t index = shard.hand;
+        shard.hand = (shard.hand + 1) % count;
+
+        Slot& slot = shard.slots[index];
+        if (!slot.entry) continue;  // Свободный слот
+        if (slot.referenced.exchange(false, std::memory_order_relaxed)) continue;
+
+        release(shard, index);
+        m_evictions.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+}
+
+void PrayerTimesCache::release(Shard& shard, size_t index) {
+    Slot& slot = shard.slots[index];
+    shard.index.erase(slot.key);
+    shard.bytes -= slot.bytes;
+    slot.entry.reset();
+    slot.bytes = 0;
+    shard.freeSlots.push_back(index);
+}
+
+std::vector<PrayerTimesCache::Change> PrayerTimesCache::collectChanges() {
+    std::vector<Change> changes;
+    for (Shard& shard : m_shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        for (Slot& slot : shard.slots) {
+            if (!slot.entry) continue;
+            const uint32_t hits = slot.hits.exchange(0, std::memory_order_relaxed);
+            const bool dirty = slot.dirty.exchange(false, std::memory_order_relaxed);
+            if (hits > 0 || dirty) changes.push_back({slot.key, slot.entry, hits});
+        }
+    }
+    return changes;
+}
+
+PrayerTimesCache::Stats PrayerTimesCache::stats() const {
+    Stats stats{};
+    stats.hits = m_hits.load(std::memory_order_relaxed);
+    stats.misses = m_misses.load(std::memory_order_relaxed);
+    stats.insertions = m_insertions.load(std::memory_order_relaxed);
+    stats.evictions = m_evictions.load(std::memory_order_relaxed);
+    stats.expirations = m_expirations.load(std::memory_order_relaxed);
+    stats.capacityBytes = m_shardCapacity * SHARD_COUNT;
+    stats.cellDegrees = m_cellDegrees;
+    for (const Shard& shard : m_shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        stats.entries += shard.index.size();
+        stats.bytes += shard.bytes;
+    }
+    return stats;
+}
@@ -0,0 +1,133 @@
+#ifndef PRAYERTIMESCACHE_H
+#define PRAYERTIMESCACHE_H
+
+#include "PrayerTimeline.h"
+#include <string>
+#include <memory>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+#include <atomic>
+#include <cstdint>
+
+// Кеш результатов /api/prayer-times.
+// Ключ - ячейка сетки (широта/долгота, квантованные с шагом cellDegrees), местная дата,
+// метод, мазхаб и часовой пояс: большинство запросов приходит из нескольких тысяч городов,
+// и все запросы из одной ячейки (0.01° ~ 1 км, разница во времени - секунды) получают один
+// результат. Значение - неизменяемая запись с готовым JSON-фрагментом времен и шкалой
+// событий; ответ собирается копированием указателя и строки, без повторной сериализации.
+//
+// Кеш разбит на шарды (shared_mutex на шард, чтение - под разделяемой блокировкой),
+// вытеснение - CLOCK в пределах лимита памяти шарда, записи живут до местной полуночи.
+// Для постоянного кеша (PrayerTimesCacheStore) каждая запись считает попадания и помнит,
+// сохранена ли она; collectChanges забирает новые записи и накопленные попадания.
+class PrayerTimesCache {
+public:
+    struct Key {
+        int32_t latitudeCell;
+        int32_t longitudeCell;
+        int32_t days;           // Местная дата (дни от 1970-01-01)
+        int32_t timeZone;       // Индекс зоны или закодированное фиксированное смещение
+        int16_t method;
+        int16_t madhhab;
+
+        bool operator==(const Key& other) const {
+            return latitudeCell == other.latitudeCell && longitudeCell == other.longitudeCell &&
+                   days == other.days && timeZone == other.timeZone &&
+                   method == other.method && madhhab == other.madhhab;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    // Версия расчета и формата записи (body, шкала). Увеличивается при любом изменении,
+    // которое меняет результат или фрагмент JSON: постоянный кеш с другой версией не загружается
+    static constexpr int FORMAT_VERSION = 1;
+
+    struct Entry {
+        std::string body;         // JSON-поля времен без фигурных скобок: "\"fajr\": ..., "
+        PrayerTimeline timeline;  // Для текущей/следующей молитвы на момент запроса
+        int64_t expiresAt;        // UTC, секунды: местная полночь после вставки
+    };
+
+    // Запись для сохранения: попадания с прошлого collectChanges
+    struct Change {
+        Key key;
+        std::shared_ptr<const Entry> entry;
+        uint32_t hits;
+    };
+
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t insertions;
+        uint64_t evictions;
+        uint64_t expirations;
+        size_t entries;
+        size_t bytes;
+        size_t capacityBytes;
+        double cellDegrees;
+    };
+
+    // cellDegrees - шаг сетки в градусах; maxBytes - лимит памяти, 0 - кеш отключен
+    PrayerTimesCache(double cellDegrees, size_t maxBytes);
+
+    PrayerTimesCache(const PrayerTimesCache&) = delete;
+    PrayerTimesCache& operator=(const PrayerTimesCache&) = delete;
+
+    bool enabled() const { return m_shardCapacity > 0; }
+    double cellDegrees() const { return m_cellDegrees; }
+
+    Key makeKey(double latitude, double longitude, int days, int method, int madhhab,
+                int timeZoneId, double fixedHours) const;
+
+    // Запись или nullptr (нет, истекла или кеш отключен)
+    std::shared_ptr<const Entry> find(const Key& key, int64_t utcNow);
+    // persisted - запись уже есть в постоянном кеше (загрузка при старте)
+    void insert(const Key& key, std::shared_ptr<const Entry> entry, bool persisted = false);
+
+    // Несохраненные записи и записи с новыми попаданиями; счетчики при этом сбрасываются
+    std::vector<Change> collectChanges();
+
+    Stats stats() const;
+
+private:
+    struct Slot {
+        Key key{};
+        std::shared_ptr<const Entry> entry;
+        size_t bytes = 0;
+        mutable std::atomic<bool> referenced{false};
+        mutable std::atomic<uint32_t> hits{0};
+        std::atomic<bool> dirty{false};
+    };
+
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<Key, size_t, KeyHash> index;
+        std::deque<Slot> slots;
+        std::vector<size_t> freeSlots;
+        size_t hand = 0;
+        size_t bytes = 0;
+    };
+
+    static constexpr size_t SHARD_COUNT = 16;
+
+    Shard& shardFor(const Key& key) { return m_shards[KeyHash()(key) % SHARD_COUNT]; }
+    void evictOne(Shard& shard);
+    void release(Shard& shard, size_t slot);
+
+    double m_cellDegrees;
+    size_t m_shardCapacity;
+    Shard m_shards[SHARD_COUNT];
+
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+    std::atomic<uint64_t> m_insertions{0};
+    std::atomic<uint64_t> m_evictions{0};
+    std::atomic<uint64_t> m_expirations{0};
+};
+
+#endif // PRAYERTIMESCACHE_H
@@ -0,0 +1,129 @@
+#include "PrayerTimesCacheStore.h"
+#include "TimeZoneService.h"
+#include "Logger.h"
+#include <chrono>
+
+namespace {
+
+int64_t utcSecondsNow() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+PrayerTimesCacheStore::PrayerTimesCacheStore(PrayerTimesCache& cache, const std::string& dbPath,
+                                             int flushIntervalSeconds)
+    : m_cache(cache), m_database(dbPath), m_flushIntervalSeconds(flushIntervalSeconds > 0 ? flushIntervalSeconds : 60),
+      m_version("calc" + std::to_string(PrayerTimesCache::FORMAT_VERSION) + "/tz" + TimeZoneService::dataVersion()) {
+    m_running = true;
+    m_worker = std::thread(&PrayerTimesCacheStore::flushLoop, this);
+}
+
+PrayerTimesCacheStore::~PrayerTimesCacheStore() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_cv.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+    flush();
+}
+
+size_t PrayerTimesCacheStore::warmUp(size_t limit) {
+    const auto started = std::chrono::steady_clock::now();
+    // Записи другой версии расчета или tzdata могут отличаться от текущего результата
+    const int stale = m_database.deleteOtherPrayerCacheVersions(m_version);
+    if (stale > 0) {
+        LOG_INFO("Cache") << "🧹 Удалено записей кеша другой версии: " << stale << " (текущая " << m_version << ")";
+    }
+    const auto records = m_database.loadHotPrayerCache(m_version, m_cache.cellDegrees(), utcSecondsNow(),
+                                                       static_cast<int>(limit));
+
+    size_t loaded = 0;
+    for (const auto& record : records) {
+        // Зона, которой больше нет в tzdata, или поврежденная шкала - запись пропускается
+        int timeZone = record.timeZone;
+        if (!record.zone.empty()) {
+            timeZone = TimeZoneService::findZone(record.zone);
+            if (timeZone < 0) continue;
+        }
+        auto timeline = PrayerTimeline::deserialize(record.timeline);
+        if (!timeline) continue;
+
+        PrayerTimesCache::Key key;
+        key.latitudeCell = record.latitudeCell;
+        key.longitudeCell = record.longitudeCell;
+        key.days = record.days;
+        key.timeZone = timeZone;
+        key.method = static_cast<int16_t>(record.method);
+        key.madhhab = static_cast<int16_t>(record.madhhab);
+
+        m_cache.insert(key, std::make_shared<const PrayerTimesCache::Entry>(
+                                PrayerTimesCache::Entry{record.body, *timeline, record.expiresAt}),
+                       true);
+        ++loaded;
+    }
+
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    LOG_INFO("Cache") << "🔥 Прогрев кеша: загружено " << loaded << " из " << records.size()
+                      << " записей за " << ms << " мс";
+    return loaded;
+}
+
+void PrayerTimesCacheStore::flush() {
+    std::lock_guard<std::mutex> flushLock(m_flushMutex);
+
+    const auto changes = m_cache.collectChanges();
+    std::vector<DatabaseService::PrayerCacheRecord> records;
+    records.reserve(changes.size());
+    for (const auto& change : changes) {
+        DatabaseService::PrayerCacheRecord record;
+        record.latitudeCell = change.key.latitudeCell;
+        record.longitudeCell = change.key.longitudeCell;
+        record.days = change.key.days;
+        // Неотрицательный timeZone - индекс зоны IANA, отрицательный - фиксированное смещение
+        if (change.key.timeZone >= 0) {
+            TimeZoneService::TimeZone zone;
+            zone.zone = change.key.timeZone;
+            record.zone = TimeZoneService::name(zone);
+            record.timeZone = 0;
+        } else {
+            record.timeZone = change.key.timeZone;
+        }
+        record.method = change.key.method;
+        record.madhhab = change.key.madhhab;
+        record.cellDegrees = m_cache.cellDegrees();
+        record.body = change.entry->body;
+        record.timeline = change.entry->timeline.serialize();
+        record.expiresAt = change.entry->expiresAt;
+        record.hits = change.hits;
+        record.version = m_version;
+        records.push_back(std::move(record));
+    }
+
+    if (!m_database.savePrayerCache(records)) {
+        LOG_WARN("Cache") << "⚠️ Не удалось сохранить " << records.size() << " записей кеша";
+    }
+    const int expired = m_database.deleteExpiredPrayerCache(utcSecondsNow());
+    if (!records.empty() || expired > 0) {
+        LOG_INFO("Cache") << "💾 Сохранено записей: " << records.size() << ", удалено истекших: " << expired;
+    }
+}
+
+void PrayerTimesCacheStore::flushLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running) {
+        m_cv.wait_for(lock, std::chrono::seconds(m_flushIntervalSeconds), [this] { return !m_running; });
+        if (!m_running) break;
+        lock.unlock();
+        try {
+            flush();
+        } catch (const std::exception& e) {
+            LOG_ERROR("Cache") << "❌ Исключение при сохранении кеша: " << e.what();
+        }
+        lock.lock();
+    }
+}
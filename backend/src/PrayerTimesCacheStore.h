@@ -0,0 +1,48 @@
+#ifndef PRAYERTIMESCACHESTORE_H
+#define PRAYERTIMESCACHESTORE_H
+
+#include "PrayerTimesCache.h"
+#include "DatabaseService.h"
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+// Постоянный кеш времени молитв: таблица prayer_cache в базе SQLite рядом с users/tokens.
+// Фоновый поток раз в flushIntervalSeconds сохраняет новые записи PrayerTimesCache и
+// прибавляет накопленные попадания (по ним выбираются "горячие" записи), удаляя истекшие.
+// При старте warmUp() до server.listen() загружает самые популярные записи обратно в
+// память, поэтому после перезапуска популярные города сразу попадают в кеш.
+// Зоны сохраняются по имени IANA: индексы зон зависят от версии tzdata.
+// Каждая запись помечена версией расчета (PrayerTimesCache::FORMAT_VERSION) и tzdata:
+// после обновления, меняющего времена или смещения, старые записи не загружаются, а
+// удаляются при прогреве - иначе предзаполненные на месяц вперед дни жили бы неделями.
+class PrayerTimesCacheStore {
+public:
+    PrayerTimesCacheStore(PrayerTimesCache& cache, const std::string& dbPath, int flushIntervalSeconds);
+    ~PrayerTimesCacheStore();  // Останавливает поток и сохраняет последние изменения
+
+    PrayerTimesCacheStore(const PrayerTimesCacheStore&) = delete;
+    PrayerTimesCacheStore& operator=(const PrayerTimesCacheStore&) = delete;
+
+    // Загрузить до limit самых популярных неистекших записей; возвращает число загруженных
+    size_t warmUp(size_t limit);
+
+    // Сохранить изменения кеша сейчас
+    void flush();
+
+private:
+    void flushLoop();
+
+    PrayerTimesCache& m_cache;
+    DatabaseService m_database;
+    int m_flushIntervalSeconds;
+    std::string m_version;       // "calc<FORMAT_VERSION>/tz<версия tzdata>"
+    std::mutex m_flushMutex;     // flush() из потока и из деструктора не пересекаются
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_running = false;
+    std::thread m_worker;
+};
+
+#endif // PRAYERTIMESCACHESTORE_H
@@ -1,15 +1,20 @@
 #include "PrayerTimesCalculator.h"
+#include "SolarEphemeris.h"
+#include "CalculationMethods.h"
+#include "PrayerTimeline.h"
 #include <iomanip>
 #include <sstream>
 #include <algorithm>
 
 PrayerTimesCalculator::PrayerTimesCalculator() {
-    // Устанавливаем текущую дату
+    // Устанавливаем текущую дату и часовой пояс сервера
     std::time_t t = std::time(nullptr);
-    std::tm* now = std::localtime(&t);
-    m_year = now->tm_year + 1900;
-    m_month = now->tm_mon + 1;
-    m_day = now->tm_mday;
+    std::tm now{};
+    localtime_r(&t, &now);
+    m_year = now.tm_year + 1900;
+    m_month = now.tm_mon + 1;
+    m_day = now.tm_mday;
+    m_timezone = systemTimezoneOffset();
 }
 
 void PrayerTimesCalculator::setLocation(double lat, double lon, const std::string& cityName) {
@@ -34,81 +39,173 @@ void PrayerTimesCalculator::setDate(int year, int month, int day) {
     m_day = day;
 }
 
+void PrayerTimesCalculator::setTimezone(double hours) {
+    m_timezone = hours;
+}
+
 std::map<std::string, std::string> PrayerTimesCalculator::calculatePrayerTimes() {
-    Times times = computePrayerTimes(m_year, m_month, m_day);
-    
-    m_prayerTimes.clear();
-    m_prayerTimes["fajr"] = formatTime(times.fajr);
-    m_prayerTimes["sunrise"] = formatTime(times.sunrise);
-    m_prayerTimes["dhuhr"] = formatTime(times.dhuhr);
-    m_prayerTimes["asr"] = formatTime(times.asr);
-    m_prayerTimes["maghrib"] = formatTime(times.maghrib);
-    m_prayerTimes["isha"] = formatTime(times.isha);
-    
-    // Форматируем дату
-    std::ostringstream dateStream;
-    dateStream << std::setfill('0') << std::setw(2) << m_day << "."
-               << std::setw(2) << m_month << "."
-               << m_year;
-    m_prayerTimes["date"] = dateStream.str();
-    
-    return m_prayerTimes;
+    Request request;
+    request.latitude = m_latitude;
+    request.longitude = m_longitude;
+    request.method = m_calculationMethod;
+    request.madhhab = m_madhhab;
+    request.timezone = m_timezone;
+    request.year = m_year;
+    request.month = m_month;
+    request.day = m_day;
+
+    const Context context = prepare(request);
+    const double julianDay = julianDate(m_year, m_month, m_day);
+    m_times = computeDay(context, julianDay);
+    m_previousTimes = computeDay(context, julianDay - 1.0);
+    m_nextTimes = computeDay(context, julianDay + 1.0);
+    m_hasTimes = true;
+
+    std::map<std::string, std::string> prayerTimes;
+    prayerTimes["fajr"] = formatTime(m_times.fajr);
+    prayerTimes["sunrise"] = formatTime(m_times.sunrise);
+    prayerTimes["dhuhr"] = formatTime(m_times.dhuhr);
+    prayerTimes["asr"] = formatTime(m_times.asr);
+    prayerTimes["maghrib"] = formatTime(m_times.maghrib);
+    prayerTimes["isha"] = formatTime(m_times.isha);
+    prayerTimes["date"] = formatDate(m_year, m_month, m_day);
+
+    return prayerTimes;
+}
+
+std::string PrayerTimesCalculator::getCurrentPrayer() const {
+    if (!m_hasTimes) {
+        return "Isha";
+    }
+    const int32_t now = static_cast<int32_t>(std::floor(currentLocalHours(m_timezone) * 3600.0));
+    return prayerName(PrayerTimeline(m_previousTimes, m_times, m_nextTimes).locate(now).current.prayer);
+}
+
+std::string PrayerTimesCalculator::getNextPrayer() const {
+    if (!m_hasTimes) {
+        return "Fajr";
+    }
+    const int32_t now = static_cast<int32_t>(std::floor(currentLocalHours(m_timezone) * 3600.0));
+    return prayerName(PrayerTimeline(m_previousTimes, m_times, m_nextTimes).locate(now).next.prayer);
+}
+
+PrayerTimesCalculator::Result PrayerTimesCalculator::compute(const Request& request, double nowHours) {
+    Result result;
+    const PrayerTimeline timeline = PrayerTimeline::build(request, result.times);
+    const PrayerTimeline::Position position =
+        timeline.locate(static_cast<int32_t>(std::floor(nowHours * 3600.0)));
+    result.currentPrayer = position.current.prayer;
+    result.nextPrayer = position.next.prayer;
+    result.secondsUntilNext = position.secondsUntilNext;
+    return result;
+}
+
+PrayerTimesCalculator::Times PrayerTimesCalculator::computePrayerTimes(const Request& request) {
+    return computeDay(prepare(request), julianDate(request.year, request.month, request.day));
+}
+
+PrayerTimesCalculator::Context PrayerTimesCalculator::prepare(const Request& request) {
+    using namespace CalculationMethods;
+    const int method = normalizeMethod(request.method);
+    const int madhhab = normalizeMadhhab(request.madhhab);
+    const MethodTraits& traits = METHODS[method];
+
+    Context context;
+    context.latitude = request.latitude;
+    context.sinLatitude = dsin(request.latitude);
+    context.cosLatitude = dcos(request.latitude);
+    // Корректировка юлианской даты на долготу для местного солнечного времени
+    context.longitudeDays = request.longitude / (15.0 * 24.0);
+    // Переход от местного солнечного времени к местному стандартному:
+    // добавляем часовой пояс и вычитаем долготу (15 градусов = 1 час)
+    context.adjustment = request.timezone - request.longitude / 15.0;
+    
+    // Параметры метода (ядро computeDayFor берет их из traits своей специализации,
+    // поля контекста нужны пакетному расчету SolarBatch)
+    context.sinFajrAngle = dsin(traits.fajrAngle);
+    context.sinSunriseAngle = dsin(0.833);
+    context.sinIshaAngle = dsin(traits.ishaAngle);
+    context.ishaInterval = traits.ishaMinutes / 60.0;
+    context.asrFactor = MADHHABS[madhhab].asrFactor;
+    context.offsets = {traits.offsets[0] / 60.0, traits.offsets[1] / 60.0, traits.offsets[2] / 60.0,
+                       traits.offsets[3] / 60.0, traits.offsets[4] / 60.0, traits.offsets[5] / 60.0};
+    
+    context.kernel = selectKernel(static_cast<size_t>(method * MADHHAB_COUNT + madhhab),
+                                  std::make_index_sequence<METHOD_COUNT * MADHHAB_COUNT>{});
+    return context;
 }
 
-PrayerTimesCalculator::Times PrayerTimesCalculator::computePrayerTimes(int year, int month, int day) {
+template <size_t... Index>
+PrayerTimesCalculator::DayKernel PrayerTimesCalculator::selectKernel(size_t index, std::index_sequence<Index...>) {
+    using CalculationMethods::MADHHAB_COUNT;
+    static constexpr DayKernel kernels[] = {
+        &computeDayFor<static_cast<int>(Index / MADHHAB_COUNT), static_cast<int>(Index % MADHHAB_COUNT)>...
+    };
+    return kernels[index];
+}
+
+PrayerTimesCalculator::Times PrayerTimesCalculator::computeDay(const Context& context, double julianDay) {
+    return context.kernel(context, julianDay);
+}
+
+template <int Method, int Madhhab>
+PrayerTimesCalculator::Times PrayerTimesCalculator::computeDayFor(const Context& context, double julianDay) {
+    constexpr CalculationMethods::MethodTraits traits = CalculationMethods::METHODS[Method];
+    constexpr double asrFactor = CalculationMethods::MADHHABS[Madhhab].asrFactor;
+    // Синусы углов метода: std::sin не constexpr, поэтому - один раз на специализацию
+    static const double sinFajrAngle = dsin(traits.fajrAngle);
+    static const double sinSunriseAngle = dsin(0.833);
+
     Times times;
     
-    // Получаем часовой пояс правильно
-    std::time_t t = std::time(nullptr);
-    std::tm* local = std::localtime(&t);
-    std::tm* utc = std::gmtime(&t);
+    double jdate = julianDay - context.longitudeDays;
     
-    // Вычисляем смещение в часах (более точный метод)
-    int timezone = local->tm_hour - utc->tm_hour;
-    if (local->tm_mday != utc->tm_mday) {
-        if (local->tm_mday < utc->tm_mday) {
-            timezone -= 24;
-        } else {
-            timezone += 24;
-        }
+    // Склонение солнца и уравнение времени: из таблицы, если день в ней есть
+    // (julianDay на 0h UT, момент наблюдения смещен от 12:00 UT на -долгота/360 суток)
+    double decl, noon;
+    const double dayNumber = julianDay - 2440587.5;
+    const int days = static_cast<int>(floor(dayNumber));
+    if (dayNumber != days || !SolarEphemeris::lookup(days, -context.longitudeDays, decl, noon)) {
+        solarPosition(jdate + 0.5, decl, noon);
     }
-    
-    // Юлианская дата
-    double jdate = julianDate(year, month, day);
-    // Корректируем на долготу для местного солнечного времени
-    jdate = jdate - m_longitude / (15.0 * 24.0);
-    
-    // Склонение солнца и уравнение времени
-    double decl = sunDeclination(jdate + 0.5);
-    double noon = computeMidDay(jdate + 0.5);
-    
-    // Получаем углы для текущего метода расчёта
-    double fajrAngle, ishaAngle;
-    getMethodAngles(m_calculationMethod, fajrAngle, ishaAngle);
+    double sinDecl = dsin(decl);
+    double cosDecl = dcos(decl);
     
     // Вычисление времен (все времена в местном солнечном времени)
-    times.fajr = sunAngleTime(fajrAngle, noon, decl, true);
-    times.sunrise = sunAngleTime(0.833, noon, decl, true);
+    times.fajr = noon - hourAngle(sinFajrAngle, sinDecl, cosDecl, context);
+    times.sunrise = noon - hourAngle(sinSunriseAngle, sinDecl, cosDecl, context);
     // Dhuhr - это полдень, долгота уже учтена в noon через jdate
     times.dhuhr = noon;
     
-    // Asr зависит от мазхаба
-    double asrFactor = (m_madhhab == 1) ? 2.0 : 1.0;  // Hanafi = 2, Shafi'i = 1
-    times.asr = asrTime(asrFactor, noon, decl);
-    times.maghrib = sunAngleTime(0.833, noon, decl, false);
-    times.isha = sunAngleTime(ishaAngle, noon, decl, false);
-    
-    // Добавляем часовой пояс ко всем временам (переводим в местное стандартное время)
-    times.fajr += timezone;
-    times.sunrise += timezone;
-    times.dhuhr += timezone;
-    times.asr += timezone;
-    times.maghrib += timezone;
-    times.isha += timezone;
+    double asrAngle = -darctan(1.0 / (asrFactor + dtan(std::abs(context.latitude - decl))));
+    times.asr = noon + hourAngle(dsin(asrAngle), sinDecl, cosDecl, context);
+    times.maghrib = noon + hourAngle(sinSunriseAngle, sinDecl, cosDecl, context);
+    
+    times.fajr += context.adjustment;
+    times.sunrise += context.adjustment;
+    times.dhuhr += context.adjustment;
+    times.asr += context.adjustment;
+    times.maghrib += context.adjustment;
+    
+    // Иша: фиксированный интервал после Магриба (Makkah, Qatar) или по углу
+    if constexpr (traits.ishaMinutes > 0.0) {
+        times.isha = times.maghrib + traits.ishaMinutes / 60.0;
+    } else {
+        static const double sinIshaAngle = dsin(traits.ishaAngle);
+        times.isha = noon + hourAngle(sinIshaAngle, sinDecl, cosDecl, context) + context.adjustment;
+    }
     
-    // Для метода Makkah (3) - Иша рассчитывается как Магриб + 90 минут
-    if (m_calculationMethod == 3) {
-        times.isha = times.maghrib + 1.5;  // 90 минут = 1.5 часа
+    // Поправки метода (минуты), только если они есть у метода
+    constexpr bool hasOffsets = traits.offsets[0] != 0.0 || traits.offsets[1] != 0.0 ||
+                                traits.offsets[2] != 0.0 || traits.offsets[3] != 0.0 ||
+                                traits.offsets[4] != 0.0 || traits.offsets[5] != 0.0;
+    if constexpr (hasOffsets) {
+        times.fajr += traits.offsets[0] / 60.0;
+        times.sunrise += traits.offsets[1] / 60.0;
+        times.dhuhr += traits.offsets[2] / 60.0;
+        times.asr += traits.offsets[3] / 60.0;
+        times.maghrib += traits.offsets[4] / 60.0;
+        times.isha += traits.offsets[5] / 60.0;
     }
     
     // Нормализация (0-24 часа)
@@ -122,6 +219,38 @@ PrayerTimesCalculator::Times PrayerTimesCalculator::computePrayerTimes(int year,
     return times;
 }
 
+// Дни от 1970-01-01 по григорианскому календарю (алгоритм Howard Hinnant)
+int PrayerTimesCalculator::daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    const int era = (year >= 0 ? year : year - 399) / 400;
+    const int yoe = year - era * 400;
+    const int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+void PrayerTimesCalculator::civilFromDays(int days, int& year, int& month, int& day) {
+    days += 719468;
+    const int era = (days >= 0 ? days : days - 146096) / 146097;
+    const int doe = days - era * 146097;
+    const int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = yoe + era * 400 + (month <= 2);
+}
+
+double PrayerTimesCalculator::julianDayFromDays(int days) {
+    // 1970-01-01 00:00 UT = JD 2440587.5
+    return days + 2440587.5;
+}
+
+void PrayerTimesCalculator::solarPosition(double jd, double& declination, double& noon) {
+    declination = sunDeclination(jd);
+    noon = computeMidDay(jd);
+}
+
 double PrayerTimesCalculator::julianDate(int year, int month, int day) {
     if (month <= 2) {
         year -= 1;
@@ -166,54 +295,17 @@ double PrayerTimesCalculator::computeMidDay(double jd) {
     return fixhour(12 - T);
 }
 
-double PrayerTimesCalculator::sunAngleTime(double angle, double noon, double decl, bool ccw) {
-    double V = darccos((-dsin(angle) - dsin(decl) * dsin(m_latitude)) / 
-                       (dcos(decl) * dcos(m_latitude))) / 15.0;
-    
-    return noon + (ccw ? -V : V);
-}
-
-double PrayerTimesCalculator::asrTime(double factor, double noon, double decl) {
-    double angle = -darctan(1.0 / (factor + dtan(std::abs(m_latitude - decl))));
-    return sunAngleTime(angle, noon, decl, false);
+double PrayerTimesCalculator::hourAngle(double sinAngle, double sinDecl, double cosDecl,
+                                        const Context& context) {
+    return darccos((-sinAngle - sinDecl * context.sinLatitude) /
+                   (cosDecl * context.cosLatitude)) / 15.0;
 }
 
-void PrayerTimesCalculator::getMethodAngles(int method, double& fajrAngle, double& ishaAngle) {
-    switch (method) {
-        case 0:  // MWL - Muslim World League
-            fajrAngle = 18.0;
-            ishaAngle = 17.0;
-            break;
-        case 1:  // ISNA - Islamic Society of North America
-            fajrAngle = 15.0;
-            ishaAngle = 15.0;
-            break;
-        case 2:  // Egypt - Egyptian General Authority of Survey
-            fajrAngle = 19.5;
-            ishaAngle = 17.5;
-            break;
-        case 3:  // Makkah - Umm al-Qura University
-            fajrAngle = 18.5;
-            ishaAngle = 90.0;  // фиксированное время 90 минут после магриб
-            break;
-        case 4:  // Karachi - University of Islamic Sciences
-            fajrAngle = 18.0;
-            ishaAngle = 18.0;
-            break;
-        case 5:  // Tehran - Institute of Geophysics
-            fajrAngle = 17.7;
-            ishaAngle = 14.0;
-            break;
-        default:
-            fajrAngle = 18.0;
-            ishaAngle = 18.0;
-            break;
-    }
-}
-
-std::string PrayerTimesCalculator::formatTime(double hours) const {
-    int h = static_cast<int>(hours);
-    int m = static_cast<int>((hours - h) * 60);
+std::string PrayerTimesCalculator::formatTime(double hours) {
+    // Округляем до ближайшей минуты (так же, как Aladhan API)
+    int totalMinutes = static_cast<int>(std::lround(hours * 60.0)) % (24 * 60);
+    int h = totalMinutes / 60;
+    int m = totalMinutes % 60;
     
     std::ostringstream stream;
     stream << std::setfill('0') << std::setw(2) << h << ":"
@@ -221,65 +313,36 @@ std::string PrayerTimesCalculator::formatTime(double hours) const {
     return stream.str();
 }
 
-std::string PrayerTimesCalculator::getCurrentPrayer() const {
-    if (m_prayerTimes.empty()) {
-        return "Isha";
-    }
-    
-    // Получаем текущее время
-    std::time_t t = std::time(nullptr);
-    std::tm* now = std::localtime(&t);
-    std::ostringstream currentTime;
-    currentTime << std::setfill('0') << std::setw(2) << now->tm_hour << ":"
-                << std::setw(2) << now->tm_min;
-    std::string currentTimeStr = currentTime.str();
-    
-    std::vector<std::pair<std::string, std::string>> prayers = {
-        {"isha", "Isha"},
-        {"maghrib", "Maghrib"},
-        {"asr", "Asr"},
-        {"dhuhr", "Dhuhr"},
-        {"sunrise", "Sunrise"},
-        {"fajr", "Fajr"}
-    };
-    
-    for (auto it = prayers.rbegin(); it != prayers.rend(); ++it) {
-        if (currentTimeStr >= m_prayerTimes.at(it->first)) {
-            return it->second;
-        }
+std::string PrayerTimesCalculator::formatDate(int year, int month, int day) {
+    std::ostringstream stream;
+    stream << std::setfill('0') << std::setw(2) << day << "."
+           << std::setw(2) << month << "."
+           << year;
+    return stream.str();
+}
+
+const char* PrayerTimesCalculator::prayerName(Prayer prayer) {
+    switch (prayer) {
+        case Prayer::Fajr: return "Fajr";
+        case Prayer::Sunrise: return "Sunrise";
+        case Prayer::Dhuhr: return "Dhuhr";
+        case Prayer::Asr: return "Asr";
+        case Prayer::Maghrib: return "Maghrib";
+        case Prayer::Isha: return "Isha";
     }
-    
     return "Isha";
 }
 
-std::string PrayerTimesCalculator::getNextPrayer() const {
-    if (m_prayerTimes.empty()) {
-        return "Fajr";
-    }
-    
-    // Получаем текущее время
+double PrayerTimesCalculator::systemTimezoneOffset() {
     std::time_t t = std::time(nullptr);
-    std::tm* now = std::localtime(&t);
-    std::ostringstream currentTime;
-    currentTime << std::setfill('0') << std::setw(2) << now->tm_hour << ":"
-                << std::setw(2) << now->tm_min;
-    std::string currentTimeStr = currentTime.str();
-    
-    std::vector<std::pair<std::string, std::string>> prayers = {
-        {"fajr", "Fajr"},
-        {"sunrise", "Sunrise"},
-        {"dhuhr", "Dhuhr"},
-        {"asr", "Asr"},
-        {"maghrib", "Maghrib"},
-        {"isha", "Isha"}
-    };
-    
-    for (const auto& prayer : prayers) {
-        if (currentTimeStr < m_prayerTimes.at(prayer.first)) {
-            return prayer.second;
-        }
-    }
-    
-    return "Fajr";
+    std::tm local{};
+    localtime_r(&t, &local);
+    return local.tm_gmtoff / 3600.0;
 }
 
+double PrayerTimesCalculator::currentLocalHours(double timezone) {
+    std::time_t t = std::time(nullptr);
+    double seconds = static_cast<double>(t % 86400) + timezone * 3600.0;
+    seconds -= 86400.0 * std::floor(seconds / 86400.0);
+    return seconds / 3600.0;
+}
@@ -5,80 +5,170 @@
 #include <map>
 #include <cmath>
 #include <ctime>
+#include <utility>
 
+// Расчет времени молитв.
+// Основной API - статические чистые функции (computePrayerTimes, compute): они не имеют
+// состояния и могут вызываться из любого числа потоков одновременно без блокировок.
+// Методы-сеттеры/геттеры экземпляра - тонкая обертка над ними для старого кода.
 class PrayerTimesCalculator {
 public:
+    // Времена молитв в часах местного времени (0-24)
+    struct Times {
+        double fajr;
+        double sunrise;
+        double dhuhr;
+        double asr;
+        double maghrib;
+        double isha;
+    };
+
+    // Входные данные расчета
+    struct Request {
+        double latitude;
+        double longitude;
+        int method = 3;         // Makkah по умолчанию
+        int madhhab = 0;        // 0 = Shafi'i, 1 = Hanafi
+        double timezone = 0.0;  // Смещение от UTC в часах
+        int year;
+        int month;
+        int day;
+    };
+
+    enum class Prayer { Fajr, Sunrise, Dhuhr, Asr, Maghrib, Isha };
+
+    // Результат расчета: времена + текущая и следующая молитва
+    struct Result {
+        Times times;
+        Prayer currentPrayer;
+        Prayer nextPrayer;
+        int secondsUntilNext;
+    };
+
+    struct Context;
+    // Ядро расчета одного дня, специализированное под пару (метод, мазхаб)
+    using DayKernel = Times (*)(const Context& context, double julianDay);
+
+    // Часть расчета, не зависящая от даты (углы метода, тригонометрия широты, поправки)
+    struct Context {
+        double latitude;
+        double sinLatitude;
+        double cosLatitude;
+        double longitudeDays;    // Поправка юлианской даты на долготу
+        double adjustment;       // Часовой пояс минус долгота/15, в часах
+        double sinFajrAngle;
+        double sinSunriseAngle;
+        double sinIshaAngle;
+        double ishaInterval;     // > 0: Иша = Магриб + интервал (часы)
+        double asrFactor;
+        Times offsets;           // Поправки метода к итоговым временам (часы)
+        DayKernel kernel;        // Выбирается в prepare() по методу и мазхабу
+    };
+
+    // Чистый расчет времен молитв для даты из запроса
+    static Times computePrayerTimes(const Request& request);
+
+    // Расчет по шагам для диапазонов дат: prepare() один раз, computeDay() на каждый день
+    static Context prepare(const Request& request);
+    static Times computeDay(const Context& context, double julianDay);
+
+    // Годы, принимаемые API: в этих пределах daysFromCivil/civilFromDays не переполняют int,
+    // а даты - ключи кешей - однозначны
+    static constexpr int MIN_YEAR = 1;
+    static constexpr int MAX_YEAR = 9999;
+
+    // Календарные преобразования: дни от 1970-01-01 <-> дата, юлианская дата на 0h UT
+    static int daysFromCivil(int year, int month, int day);
+    static void civilFromDays(int days, int& year, int& month, int& day);
+    static double julianDayFromDays(int days);
+
+    // Склонение солнца (градусы) и истинный полдень (часы) для юлианской даты jd.
+    // Прямой расчет; computeDay берет эти значения из SolarEphemeris, если таблица загружена
+    static void solarPosition(double jd, double& declination, double& noon);
+
+    // Расчет времен и текущей/следующей молитвы; nowHours - текущее местное время в часах.
+    // Текущая/следующая определяются по шкале PrayerTimeline из вчера, сегодня и завтра
+    static Result compute(const Request& request, double nowHours);
+
+    static const char* prayerName(Prayer prayer);
+
+    // Форматирование: "HH:MM" и "DD.MM.YYYY"
+    static std::string formatTime(double hours);
+    static std::string formatDate(int year, int month, int day);
+
+    // Смещение часового пояса сервера от UTC в часах (reentrant, через localtime_r)
+    static double systemTimezoneOffset();
+
     PrayerTimesCalculator();
-    
+
     void setLocation(double lat, double lon, const std::string& cityName = "");
     void setCalculationMethod(int method);
     void setMadhhab(int madhhab); // 0 = Shafi'i, 1 = Hanafi
     void setDate(int year, int month, int day);
-    
+    void setTimezone(double hours);
+
     // Получить время молитв для текущей даты
     std::map<std::string, std::string> calculatePrayerTimes();
-    
+
     // Получить текущую и следующую молитву
     std::string getCurrentPrayer() const;
     std::string getNextPrayer() const;
-    
+
     // Геттеры
     double latitude() const { return m_latitude; }
     double longitude() const { return m_longitude; }
     std::string city() const { return m_city; }
     int calculationMethod() const { return m_calculationMethod; }
     int madhhab() const { return m_madhhab; }
+    double timezone() const { return m_timezone; }
 
 private:
-    struct Times {
-        double fajr;
-        double sunrise;
-        double dhuhr;
-        double asr;
-        double maghrib;
-        double isha;
-    };
-    
-    Times computePrayerTimes(int year, int month, int day);
-    
     // Математические функции
-    double julianDate(int year, int month, int day);
-    double equationOfTime(double jd);
-    double sunDeclination(double jd);
-    double computeMidDay(double jd);
-    double sunAngleTime(double angle, double noon, double decl, bool ccw);
-    double asrTime(double factor, double noon, double decl);
-    
+    static double julianDate(int year, int month, int day);
+    static double equationOfTime(double jd);
+    static double sunDeclination(double jd);
+    static double computeMidDay(double jd);
+    static double hourAngle(double sinAngle, double sinDecl, double cosDecl, const Context& context);
+
     // Вспомогательные функции
-    double dsin(double d) const { return sin(d * PI / 180.0); }
-    double dcos(double d) const { return cos(d * PI / 180.0); }
-    double dtan(double d) const { return tan(d * PI / 180.0); }
-    double darcsin(double x) const { return asin(x) * 180.0 / PI; }
-    double darccos(double x) const { return acos(x) * 180.0 / PI; }
-    double darctan(double x) const { return atan(x) * 180.0 / PI; }
-    double darctan2(double y, double x) const { return atan2(y, x) * 180.0 / PI; }
-    double fixangle(double a) const { return a - 360.0 * floor(a / 360.0); }
-    double fixhour(double a) const { return a - 24.0 * floor(a / 24.0); }
-    
-    void getMethodAngles(int method, double& fajrAngle, double& ishaAngle);
-    std::string formatTime(double hours) const;
-    
+    static double dsin(double d) { return sin(d * PI / 180.0); }
+    static double dcos(double d) { return cos(d * PI / 180.0); }
+    static double dtan(double d) { return tan(d * PI / 180.0); }
+    static double darcsin(double x) { return asin(x) * 180.0 / PI; }
+    static double darccos(double x) { return acos(x) * 180.0 / PI; }
+    static double darctan(double x) { return atan(x) * 180.0 / PI; }
+    static double darctan2(double y, double x) { return atan2(y, x) * 180.0 / PI; }
+    static double fixangle(double a) { return a - 360.0 * floor(a / 360.0); }
+    static double fixhour(double a) { return a - 24.0 * floor(a / 24.0); }
+
+    // Расчет дня с параметрами метода и мазхаба, известными во время компиляции
+    template <int Method, int Madhhab>
+    static Times computeDayFor(const Context& context, double julianDay);
+
+    // Таблица ядер: индекс = метод * MADHHAB_COUNT + мазхаб
+    template <size_t... Index>
+    static DayKernel selectKernel(size_t index, std::index_sequence<Index...>);
+    static double currentLocalHours(double timezone);
+
     static constexpr double PI = 3.14159265358979323846;
-    
+
     double m_latitude = 55.7558;  // Москва по умолчанию
     double m_longitude = 37.6173;
     std::string m_city = "Москва";
     int m_calculationMethod = 3;  // Makkah по умолчанию
     int m_madhhab = 0;  // Shafi'i по умолчанию
-    
+    double m_timezone = 0.0;
+
     // Текущая дата
     int m_year;
     int m_month;
     int m_day;
-    
-    // Кэш последних рассчитанных времен
-    std::map<std::string, std::string> m_prayerTimes;
+
+    // Результат последнего расчета и соседние дни для шкалы событий
+    Times m_times{};
+    Times m_previousTimes{};
+    Times m_nextTimes{};
+    bool m_hasTimes = false;
 };
 
 #endif  // PRAYERTIMESCALCULATOR_H
-
@@ -0,0 +1,289 @@
+#define CPPHTTPLIB_OPENSSL_SUPPORT
+#define CPPHTTPLIB_USE_CERTS_FROM_MACOSX_KEYCHAIN
+#include "PrayerTimesService.h"
+#include "CalculationMethods.h"
+#include "UpstreamExecutor.h"
+#include "JsonReader.h"
+#include "Logger.h"
+#include <httplib.h>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+
+SingleFlight<std::string, std::string> PrayerTimesService::s_aladhanFlights;
+
+namespace {
+
+// Элемент ответа Aladhan, BeginObject которого только что прочитан:
+// {"timings":{"Fajr":"05:01 (MSK)",...},"date":{"gregorian":{"date":"01-03-2025",...},
+//  "hijri":{"date":"01-09-1446",...}},"meta":{"timezone":"Europe/Moscow",...}}.
+// Остальные члены пропускаются без копирования; false - ошибка синтаксиса
+bool readAladhanDay(JsonReader& reader, PrayerTimesService::AladhanDay& day) {
+    static constexpr std::string_view keys[] = {"Fajr", "Sunrise", "Dhuhr", "Asr", "Maghrib", "Isha"};
+
+    return reader.forEachMember([&](std::string_view key) {
+        if (key == "timings") {
+            if (!reader.nextObject()) return true;
+            reader.forEachMember([&](std::string_view name) {
+                for (size_t i = 0; i < 6; ++i) {
+                    if (name != keys[i]) continue;
+                    day.timings[i] = reader.nextString().substr(0, 5);  // Без суффикса " (MSK)"
+                    return true;
+                }
+                return false;
+            });
+            return true;
+        }
+        if (key == "date") {
+            if (!reader.nextObject()) return true;
+            reader.forEachMember([&](std::string_view calendar) {
+                std::string* target = calendar == "gregorian" ? &day.date
+                                    : calendar == "hijri"     ? &day.hijriDate : nullptr;
+                if (!target) return false;
+                if (!reader.nextObject()) return true;
+                reader.forEachMember([&](std::string_view field) {
+                    if (field != "date") return false;
+                    *target = reader.nextString();
+                    return true;
+                });
+                return true;
+            });
+            return true;
+        }
+        if (key == "meta") {
+            if (!reader.nextObject()) return true;
+            reader.forEachMember([&](std::string_view field) {
+                if (field != "timezone") return false;
+                day.timezone = reader.nextString();  // PHP экранирует '/': "Europe\/Moscow"
+                return true;
+            });
+            return true;
+        }
+        return false;
+    });
+}
+
+} // namespace
+
+PrayerTimesService::PrayerTimesService(double sampleRate)
+    : m_sampleRate(sampleRate), m_rng(std::random_device{}()) {
+    if (m_sampleRate < 0.0) m_sampleRate = 0.0;
+    if (m_sampleRate > 1.0) m_sampleRate = 1.0;
+
+    if (m_sampleRate > 0.0) {
+        m_running = true;
+        m_worker = std::thread(&PrayerTimesService::verificationLoop, this);
+        LOG_INFO("Verify") << "🔎 Сверка с Aladhan включена, доля запросов: " << m_sampleRate;
+    } else {
+        LOG_INFO("Verify") << "🔎 Сверка с Aladhan отключена (ALADHAN_VERIFY_RATE=0)";
+    }
+}
+
+PrayerTimesService::~PrayerTimesService() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_cv.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+void PrayerTimesService::maybeVerify(const VerificationSample& sample) {
+    if (!m_running) return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    if (dist(m_rng) >= m_sampleRate) return;
+
+    // Очередь ограничена: если сверка не успевает, лишние образцы просто отбрасываются
+    if (m_queue.size() >= MAX_QUEUE_SIZE) return;
+
+    m_queue.push_back(sample);
+    m_cv.notify_one();
+}
+
+void PrayerTimesService::verificationLoop() {
+    while (true) {
+        VerificationSample sample;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return !m_running || !m_queue.empty(); });
+            if (!m_running) return;
+            sample = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        try {
+            verify(sample);
+        } catch (const std::exception& e) {
+            LOG_ERROR("Verify") << "❌ Исключение при сверке: " << e.what();
+        }
+    }
+}
+
+void PrayerTimesService::verify(const VerificationSample& sample) {
+    const MonthTimings* month = monthTimings(sample.latitude, sample.longitude, sample.method,
+                                             sample.madhhab, sample.year, sample.month);
+    if (!month) {
+        LOG_WARN("Verify") << "⚠️ Aladhan недоступен, образец пропущен";
+        return;
+    }
+    if (sample.day < 1 || sample.day > static_cast<int>(month->size())) {
+        LOG_WARN("Verify") << "⚠️ В календаре Aladhan нет дня " << sample.day << ", образец пропущен";
+        return;
+    }
+    const AladhanDay& remoteDay = (*month)[sample.day - 1];
+
+    std::ostringstream expectedDate;
+    expectedDate << std::setfill('0') << std::setw(2) << sample.day << "-" << std::setw(2) << sample.month
+                 << "-" << sample.year;
+    if (!remoteDay.date.empty() && remoteDay.date != expectedDate.str()) {
+        LOG_WARN("Verify") << "⚠️ Aladhan вернул " << remoteDay.date << " вместо " << expectedDate.str()
+                           << ", образец пропущен";
+        return;
+    }
+
+    // "HH:MM" -> минуты от начала суток, -1 при ошибке
+    auto toMinutes = [](const std::string& time) -> int {
+        if (time.size() < 5 || time[2] != ':') return -1;
+        return std::atoi(time.substr(0, 2).c_str()) * 60 + std::atoi(time.substr(3, 2).c_str());
+    };
+
+    const char* prayers[] = {"fajr", "sunrise", "dhuhr", "asr", "maghrib", "isha"};
+
+    int maxDiff = 0;
+    std::ostringstream details;
+    for (size_t i = 0; i < 6; ++i) {
+        auto local = sample.localTimes.find(prayers[i]);
+        if (local == sample.localTimes.end()) continue;
+
+        const std::string& remote = remoteDay.timings[i];
+        int localMinutes = toMinutes(local->second);
+        int remoteMinutes = toMinutes(remote);
+        if (localMinutes < 0 || remoteMinutes < 0) continue;
+
+        int diff = std::abs(localMinutes - remoteMinutes);
+        diff = std::min(diff, 24 * 60 - diff);
+        maxDiff = std::max(maxDiff, diff);
+        details << " " << prayers[i] << "=" << local->second << "/" << remote;
+    }
+
+    LOG_AT(maxDiff <= 2 ? Logger::Level::Info : Logger::Level::Warn, "Verify")
+        << (maxDiff <= 2 ? "✅ " : "⚠️ ") << sample.year << "-" << sample.month
+        << "-" << sample.day << " (" << sample.latitude << ", " << sample.longitude
+        << ") method=" << sample.method << " madhhab=" << sample.madhhab
+        << " макс. расхождение " << maxDiff << " мин (локально/Aladhan):" << details.str()
+        << (remoteDay.timezone.empty() ? "" : " зона Aladhan " + remoteDay.timezone);
+
+    // В последние дни месяца следующий месяц загружается заранее, пока поток свободен.
+    // Только после сравнения: загрузка может вытеснить из m_months текущий месяц, и month
+    // с remoteDay станут недействительными
+    if (sample.day + PREFETCH_DAYS > static_cast<int>(month->size())) {
+        const int nextYear = sample.month == 12 ? sample.year + 1 : sample.year;
+        const int nextMonth = sample.month == 12 ? 1 : sample.month + 1;
+        monthTimings(sample.latitude, sample.longitude, sample.method, sample.madhhab, nextYear, nextMonth);
+    }
+}
+
+const PrayerTimesService::MonthTimings* PrayerTimesService::monthTimings(double lat, double lon, int method,
+                                                                       int madhhab, int year, int month) {
+    // Ячейка 0.01° (~1 км): разница времен внутри нее - секунды, а допуск сверки - 2 минуты
+    lat = std::round(lat * 100.0) / 100.0;
+    lon = std::round(lon * 100.0) / 100.0;
+
+    std::ostringstream key;
+    key << std::fixed << std::setprecision(2) << lat << "," << lon << "," << method << ","
+        << madhhab << "," << year << "-" << month;
+    auto it = m_months.find(key.str());
+    if (it != m_months.end()) return &it->second;
+
+    MonthTimings timings = parseAladhanCalendar(httpGetAladhanCalendar(lat, lon, method, madhhab, year, month));
+    if (timings.empty()) return nullptr;  // Ошибки не кешируются: следующий образец попробует снова
+
+    LOG_INFO("Verify") << "📅 Загружен календарь Aladhan " << year << "-" << month << " для ("
+                       << lat << ", " << lon << "), дней: " << timings.size();
+
+    if (m_monthOrder.size() >= MAX_CACHED_MONTHS) {
+        m_months.erase(m_monthOrder.front());
+        m_monthOrder.pop_front();
+    }
+    m_monthOrder.push_back(key.str());
+    return &m_months.emplace(key.str(), std::move(timings)).first->second;
+}
+
+std::string PrayerTimesService::getMethodCode(int method) {
+    return std::to_string(CalculationMethods::METHODS[CalculationMethods::normalizeMethod(method)].aladhanCode);
+}
+
+std::string PrayerTimesService::fetchAladhan(const std::string& path) {
+    LOG_DEBUG("Aladhan") << "🌐 Запрос к: https://api.aladhan.com" << path;
+
+    auto response = UpstreamExecutor::get("api.aladhan.com", path, {{"Accept", "application/json"}},
+                                          std::chrono::steady_clock::now() + std::chrono::milliseconds(ALADHAN_WAIT_MS));
+    if (response.status == 200) {
+        return response.body;
+    }
+    if (response.circuitOpen) {
+        LOG_WARN("Aladhan") << "🔴 Цепь разомкнута, запрос не отправлялся";
+        return "";
+    }
+
+    if (response.status != 0) {
+        LOG_ERROR("Aladhan") << "❌ Ошибка HTTP статус: " << response.status;
+    } else {
+        LOG_ERROR("Aladhan") << "❌ Не удалось получить ответ: " << response.error;
+    }
+    return "";
+}
+
+std::string PrayerTimesService::httpGetAladhanCalendar(double lat, double lon, int method, int madhhab,
+                                                       int year, int month) {
+    try {
+        std::ostringstream url;
+        url << "/v1/calendar/" << year << "/" << month << "?";
+        url << "latitude=" << lat << "&";
+        url << "longitude=" << lon << "&";
+        url << "method=" << getMethodCode(method) << "&";
+        url << "school=" << (madhhab == 1 ? "1" : "0");  // 1 = Hanafi, 0 = Shafi'i
+
+        std::string fullUrl = url.str();
+        auto body = s_aladhanFlights.run(fullUrl, std::chrono::milliseconds(ALADHAN_WAIT_MS),
+                                         [&fullUrl] { return fetchAladhan(fullUrl); });
+        if (body) return *body;
+        LOG_WARN("Aladhan") << "⏱️ Ответ не получен за " << ALADHAN_WAIT_MS << " мс";
+    } catch (const std::exception& e) {
+        LOG_ERROR("Aladhan") << "❌ Исключение при запросе: " << e.what();
+    }
+
+    return "";
+}
+
+// Ответ /v1/calendar: {"code":200,"data":[{"timings":{...},"date":{...},"meta":{...}}, ...]},
+// дни идут по порядку с 1-го
+PrayerTimesService::MonthTimings PrayerTimesService::parseAladhanCalendar(const std::string& json) {
+    MonthTimings result;
+    JsonReader reader(json);
+    if (reader.next() != JsonReader::Token::BeginObject) return {};
+
+    const bool ok = reader.forEachMember([&](std::string_view key) {
+        if (key != "data") return false;
+        const JsonReader::Token token = reader.next();
+        if (token != JsonReader::Token::BeginArray) {
+            // При ошибке Aladhan "data" - строка с описанием
+            if (token == JsonReader::Token::BeginObject) reader.skipContainer();
+            return true;
+        }
+        return reader.forEachElement([&](JsonReader::Token token) {
+            if (token != JsonReader::Token::BeginObject) return false;
+            AladhanDay day;
+            if (readAladhanDay(reader, day)) result.push_back(std::move(day));
+            return true;
+        });
+    });
+    if (!ok || reader.failed()) return {};
+    return result;
+}
@@ -1,23 +1,97 @@
 #ifndef PRAYERTIMESSERVICE_H
 #define PRAYERTIMESSERVICE_H
 
+#include "SingleFlight.h"
 #include <string>
-#include "PrayerTimesCalculator.h"
+#include <map>
+#include <unordered_map>
+#include <array>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <random>
 
+// Сервис времени молитв.
+// Ответы API считаются локально через PrayerTimesCalculator, Aladhan API используется
+// только как источник сверки: часть локальных результатов отправляется в фоновый поток,
+// который запрашивает Aladhan и логирует расхождения. На пути запроса сеть не используется.
+// Aladhan запрашивается целым месяцем (/v1/calendar) на ячейку 0.01°, метод и мазхаб:
+// остальные образцы этого месяца сверяются без новых запросов, а в последние дни месяца
+// фоновый поток заранее загружает следующий.
 class PrayerTimesService {
-private:
-    PrayerTimesCalculator& calculator;
-    
-    static std::string getMethodCode(int method);
-    static std::string httpGetAladhan(double lat, double lon, int method, int madhhab, int year, int month, int day);
-    static std::string extractJsonValue(const std::string& json, const std::string& key);
-    
 public:
-    PrayerTimesService(PrayerTimesCalculator& calc);
-    
-    std::string getPrayerTimes(double lat, double lon, const std::string& city, 
-                               int method, int madhhab, int year, int month, int day);
+    // Один локально рассчитанный результат, отправленный на сверку
+    struct VerificationSample {
+        double latitude;
+        double longitude;
+        int method;
+        int madhhab;
+        int year;
+        int month;
+        int day;
+        std::map<std::string, std::string> localTimes;  // "fajr" -> "HH:MM", ...
+    };
+
+    // sampleRate - доля запросов (0..1), отправляемых на сверку с Aladhan; 0 - сверка отключена
+    explicit PrayerTimesService(double sampleRate = 0.0);
+    ~PrayerTimesService();
+
+    PrayerTimesService(const PrayerTimesService&) = delete;
+    PrayerTimesService& operator=(const PrayerTimesService&) = delete;
+
+    // Решает, попадает ли запрос в выборку, и если да - ставит его в очередь (не блокирует)
+    void maybeVerify(const VerificationSample& sample);
+
+    double sampleRate() const { return m_sampleRate; }
+
+    // Клиент Aladhan API (используется фоновой сверкой)
+    static std::string getMethodCode(int method);
+
+    // День Aladhan: объекты timings, date и meta одного элемента ответа
+    struct AladhanDay {
+        std::array<std::string, 6> timings;  // fajr, sunrise, dhuhr, asr, maghrib, isha = "HH:MM"
+        std::string date;                    // date.gregorian.date, "DD-MM-YYYY"
+        std::string hijriDate;               // date.hijri.date, "DD-MM-YYYY"
+        std::string timezone;                // meta.timezone
+    };
+
+    // Времена Aladhan за месяц: [день - 1]
+    using MonthTimings = std::vector<AladhanDay>;
+    static std::string httpGetAladhanCalendar(double lat, double lon, int method, int madhhab,
+                                              int year, int month);
+    // Ответы разбираются за один проход JsonReader; пустой результат - ответ некорректен
+    static MonthTimings parseAladhanCalendar(const std::string& json);
+
+private:
+    // Запрос к Aladhan по готовому пути с параметрами; пустая строка при ошибке
+    static std::string fetchAladhan(const std::string& path);
+
+    void verificationLoop();
+    void verify(const VerificationSample& sample);
+    // Месяц из кеша или одним запросом к Aladhan; nullptr, если Aladhan недоступен
+    const MonthTimings* monthTimings(double lat, double lon, int method, int madhhab, int year, int month);
+
+    static constexpr size_t MAX_QUEUE_SIZE = 64;
+    static constexpr int ALADHAN_WAIT_MS = 35000;  // Ожидание такого же запроса другого потока
+    static constexpr size_t MAX_CACHED_MONTHS = 256;
+    static constexpr int PREFETCH_DAYS = 3;        // За сколько дней до конца месяца грузить следующий
+
+    static SingleFlight<std::string, std::string> s_aladhanFlights;  // Ключ - путь запроса
+
+    double m_sampleRate;
+    std::deque<VerificationSample> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread m_worker;
+    std::atomic<bool> m_running{false};
+    std::mt19937 m_rng;
+
+    // Месяцы Aladhan; используются только фоновым потоком сверки, поэтому без блокировок
+    std::unordered_map<std::string, MonthTimings> m_months;
+    std::deque<std::string> m_monthOrder;          // Порядок загрузки, для вытеснения старых
 };
 
 #endif // PRAYERTIMESSERVICE_H
-
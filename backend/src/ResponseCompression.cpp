@@ -0,0 +1,354 @@
+#define CPPHTTPLIB_OPENSSL_SUPPORT
+#define CPPHTTPLIB_USE_CERTS_FROM_MACOSX_KEYCHAIN
+#include "ResponseCompression.h"
+#include <httplib.h>
+#include <zlib.h>
+#ifdef JUMMAH_HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+#ifdef JUMMAH_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+ResponseCompression::Options s_options;
+
+bool isCompressible(const std::string& contentType) {
+    return contentType.rfind("text/", 0) == 0 || contentType.find("json") != std::string::npos ||
+           contentType.find("javascript") != std::string::npos || contentType.find("xml") != std::string::npos;
+}
+
+// Контекст deflate потока: создается при первом ответе и живет до конца потока
+struct GzipContext {
+    z_stream stream{};
+    bool ready = false;
+
+    ~GzipContext() {
+        if (ready) deflateEnd(&stream);
+    }
+
+    z_stream* acquire() {
+        if (!ready) {
+            // 15 + 16: окно 32 КБ и заголовок gzip
+            if (deflateInit2(&stream, s_options.gzipLevel, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                return nullptr;
+            }
+            ready = true;
+        } else if (deflateReset(&stream) != Z_OK) {
+            return nullptr;
+        }
+        return &stream;
+    }
+};
+
+#ifdef JUMMAH_HAVE_ZSTD
+struct ZstdContext {
+    ZSTD_CCtx* context = nullptr;
+
+    ~ZstdContext() {
+        ZSTD_freeCCtx(context);
+    }
+
+    ZSTD_CCtx* acquire() {
+        if (!context) context = ZSTD_createCCtx();
+        return context;
+    }
+};
+#endif
+
+// Прогнать data через deflate с режимом flush, дописывая выход в out
+bool deflateInto(z_stream& stream, const char* data, size_t size, int flush, std::string& out) {
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = static_cast<uInt>(size);
+    char buffer[16384];
+    int result;
+    do {
+        stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+        result = deflate(&stream, flush);
+        if (result == Z_STREAM_ERROR) return false;
+        out.append(buffer, sizeof(buffer) - stream.avail_out);
+    } while (stream.avail_out == 0 || (flush == Z_FINISH && result != Z_STREAM_END));
+    return true;
+}
+
+#ifdef JUMMAH_HAVE_BROTLI
+bool brotliInto(BrotliEncoderState* state, const std::string& data, BrotliEncoderOperation operation, std::string& out) {
+    size_t availableIn = data.size();
+    const uint8_t* nextIn = reinterpret_cast<const uint8_t*>(data.data());
+    do {
+        size_t availableOut = 0;
+        if (!BrotliEncoderCompressStream(state, operation, &availableIn, &nextIn, &availableOut, nullptr, nullptr)) {
+            return false;
+        }
+        size_t size = 0;
+        const uint8_t* output = BrotliEncoderTakeOutput(state, &size);
+        out.append(reinterpret_cast<const char*>(output), size);
+    } while (availableIn > 0 || BrotliEncoderHasMoreOutput(state) ||
+             (operation == BROTLI_OPERATION_FINISH && !BrotliEncoderIsFinished(state)));
+    return true;
+}
+#endif
+
+#ifdef JUMMAH_HAVE_ZSTD
+bool zstdInto(ZSTD_CCtx* context, const std::string& data, ZSTD_EndDirective mode, std::string& out) {
+    ZSTD_inBuffer input{data.data(), data.size(), 0};
+    char buffer[16384];
+    size_t remaining;
+    do {
+        ZSTD_outBuffer output{buffer, sizeof(buffer), 0};
+        remaining = ZSTD_compressStream2(context, &output, &input, mode);
+        if (ZSTD_isError(remaining)) return false;
+        out.append(buffer, output.pos);
+    } while (remaining != 0 || input.pos < input.size);
+    return true;
+}
+#endif
+
+} // namespace
+
+struct ResponseCompression::Stream::State {
+    Encoding encoding;
+    z_stream gzip{};
+    bool gzipReady = false;
+#ifdef JUMMAH_HAVE_BROTLI
+    BrotliEncoderState* brotli = nullptr;
+#endif
+#ifdef JUMMAH_HAVE_ZSTD
+    ZSTD_CCtx* zstd = nullptr;
+#endif
+};
+
+void ResponseCompression::configure(const Options& options) {
+    s_options = options;
+}
+
+std::string ResponseCompression::available() {
+    std::string names;
+#ifdef JUMMAH_HAVE_BROTLI
+    names += "br, ";
+#endif
+#ifdef JUMMAH_HAVE_ZSTD
+    names += "zstd, ";
+#endif
+    names += "gzip";
+    return names;
+}
+
+double ResponseCompression::acceptQuality(const std::string& header, const char* coding) {
+    double wildcard = 0.0;
+    size_t start = 0;
+    while (start < header.size()) {
+        size_t end = header.find(',', start);
+        if (end == std::string::npos) end = header.size();
+        std::string item = header.substr(start, end - start);
+        start = end + 1;
+
+        double quality = 1.0;
+        const size_t semicolon = item.find(';');
+        if (semicolon != std::string::npos) {
+            const size_t q = item.find("q=", semicolon);
+            if (q != std::string::npos) {
+                try { quality = std::stod(item.substr(q + 2)); } catch (const std::exception& e) { quality = 0.0; }
+            }
+            item.resize(semicolon);
+        }
+        const size_t first = item.find_first_not_of(" \t");
+        const size_t last = item.find_last_not_of(" \t");
+        if (first == std::string::npos) continue;
+        item = item.substr(first, last - first + 1);
+
+        if (item == coding) return quality;
+        if (item == "*") wildcard = quality;
+    }
+    return wildcard;
+}
+
+ResponseCompression::Encoding ResponseCompression::choose(const httplib::Request& req, size_t size) {
+    if (!s_options.enabled || size < s_options.minSize) return Encoding::Identity;
+    const std::string accept = req.get_header_value("Accept-Encoding");
+    if (accept.empty()) return Encoding::Identity;
+
+    // Порядок - предпочтение сервера при равных q
+    Encoding best = Encoding::Identity;
+    double bestQuality = 0.0;
+    for (Encoding encoding : {Encoding::Brotli, Encoding::Zstd, Encoding::Gzip}) {
+#ifndef JUMMAH_HAVE_BROTLI
+        if (encoding == Encoding::Brotli) continue;
+#endif
+#ifndef JUMMAH_HAVE_ZSTD
+        if (encoding == Encoding::Zstd) continue;
+#endif
+        const double quality = acceptQuality(accept, name(encoding));
+        if (quality > bestQuality) {
+            best = encoding;
+            bestQuality = quality;
+        }
+    }
+    return best;
+}
+
+const char* ResponseCompression::name(Encoding encoding) {
+    switch (encoding) {
+        case Encoding::Gzip: return "gzip";
+        case Encoding::Brotli: return "br";
+        case Encoding::Zstd: return "zstd";
+        case Encoding::Identity: break;
+    }
+    return "identity";
+}
+
+bool ResponseCompression::compress(Encoding encoding, const std::string& in, std::string& out) {
+    out.clear();
+    switch (encoding) {
+        case Encoding::Gzip: {
+            thread_local GzipContext context;
+            z_stream* stream = context.acquire();
+            if (!stream) return false;
+            out.reserve(deflateBound(stream, in.size()));
+            return deflateInto(*stream, in.data(), in.size(), Z_FINISH, out);
+        }
+        case Encoding::Brotli: {
+#ifdef JUMMAH_HAVE_BROTLI
+            size_t size = BrotliEncoderMaxCompressedSize(in.size());
+            if (size == 0) return false;
+            out.resize(size);
+            if (!BrotliEncoderCompress(s_options.brotliQuality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, in.size(),
+                                       reinterpret_cast<const uint8_t*>(in.data()), &size,
+                                       reinterpret_cast<uint8_t*>(&out[0]))) {
+                return false;
+            }
+            out.resize(size);
+            return true;
+#else
+            return false;
+#endif
+        }
+        case Encoding::Zstd: {
+#ifdef JUMMAH_HAVE_ZSTD
+            thread_local ZstdContext context;
+            ZSTD_CCtx* cctx = context.acquire();
+            if (!cctx) return false;
+            out.resize(ZSTD_compressBound(in.size()));
+            const size_t size = ZSTD_compressCCtx(cctx, &out[0], out.size(), in.data(), in.size(), s_options.zstdLevel);
+            if (ZSTD_isError(size)) return false;
+            out.resize(size);
+            return true;
+#else
+            return false;
+#endif
+        }
+        case Encoding::Identity:
+            break;
+    }
+    return false;
+}
+
+void ResponseCompression::apply(const httplib::Request& req, httplib::Response& res) {
+    if (!s_options.enabled || res.body.empty() || res.status == 204 || res.status == 304 ||
+        res.has_header("Content-Encoding") || !isCompressible(res.get_header_value("Content-Type"))) {
+        return;
+    }
+    if (res.body.size() < s_options.minSize) return;
+
+    // Ответ зависит от Accept-Encoding, даже если этот клиент получит его без сжатия
+    res.set_header("Vary", "Accept-Encoding");
+    const Encoding encoding = choose(req, res.body.size());
+    if (encoding == Encoding::Identity) return;
+
+    std::string compressed;
+    if (!compress(encoding, res.body, compressed) || compressed.size() >= res.body.size()) return;
+    res.body = std::move(compressed);
+    res.set_header("Content-Encoding", name(encoding));
+
+    // Content-Length уже посчитан по несжатому телу (post-routing идет после него)
+    auto length = res.headers.find("Content-Length");
+    if (length != res.headers.end()) length->second = std::to_string(res.body.size());
+    // Байты тела другие: строгий ETag становится слабым (смысл ответа тот же)
+    auto etag = res.headers.find("ETag");
+    if (etag != res.headers.end() && etag->second.rfind("W/", 0) != 0) etag->second = "W/" + etag->second;
+}
+
+ResponseCompression::Stream::Stream(Encoding encoding) : m_state(new State) {
+    m_state->encoding = encoding;
+    switch (encoding) {
+        case Encoding::Gzip:
+            m_state->gzipReady = deflateInit2(&m_state->gzip, s_options.gzipLevel, Z_DEFLATED, 15 + 16, 8,
+                                              Z_DEFAULT_STRATEGY) == Z_OK;
+            break;
+        case Encoding::Brotli:
+#ifdef JUMMAH_HAVE_BROTLI
+            m_state->brotli = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+            if (m_state->brotli) {
+                BrotliEncoderSetParameter(m_state->brotli, BROTLI_PARAM_QUALITY, static_cast<uint32_t>(s_options.brotliQuality));
+                BrotliEncoderSetParameter(m_state->brotli, BROTLI_PARAM_MODE, BROTLI_MODE_TEXT);
+            }
+#endif
+            break;
+        case Encoding::Zstd:
+#ifdef JUMMAH_HAVE_ZSTD
+            m_state->zstd = ZSTD_createCCtx();
+            if (m_state->zstd) ZSTD_CCtx_setParameter(m_state->zstd, ZSTD_c_compressionLevel, s_options.zstdLevel);
+#endif
+            break;
+        case Encoding::Identity:
+            break;
+    }
+}
+
+ResponseCompression::Stream::~Stream() {
+    if (m_state->gzipReady) deflateEnd(&m_state->gzip);
+#ifdef JUMMAH_HAVE_BROTLI
+    if (m_state->brotli) BrotliEncoderDestroyInstance(m_state->brotli);
+#endif
+#ifdef JUMMAH_HAVE_ZSTD
+    ZSTD_freeCCtx(m_state->zstd);
+#endif
+}
+
+bool ResponseCompression::Stream::write(const std::string& data, std::string& out) {
+    switch (m_state->encoding) {
+        case Encoding::Gzip:
+            // Z_SYNC_FLUSH: часть уходит клиенту сразу, не дожидаясь заполнения окна
+            return m_state->gzipReady && deflateInto(m_state->gzip, data.data(), data.size(), Z_SYNC_FLUSH, out);
+        case Encoding::Brotli:
+#ifdef JUMMAH_HAVE_BROTLI
+            return m_state->brotli && brotliInto(m_state->brotli, data, BROTLI_OPERATION_FLUSH, out);
+#else
+            return false;
+#endif
+        case Encoding::Zstd:
+#ifdef JUMMAH_HAVE_ZSTD
+            return m_state->zstd && zstdInto(m_state->zstd, data, ZSTD_e_flush, out);
+#else
+            return false;
+#endif
+        case Encoding::Identity:
+            out += data;
+            return true;
+    }
+    return false;
+}
+
+bool ResponseCompression::Stream::finish(std::string& out) {
+    switch (m_state->encoding) {
+        case Encoding::Gzip:
+            return m_state->gzipReady && deflateInto(m_state->gzip, nullptr, 0, Z_FINISH, out);
+        case Encoding::Brotli:
+#ifdef JUMMAH_HAVE_BROTLI
+            return m_state->brotli && brotliInto(m_state->brotli, std::string(), BROTLI_OPERATION_FINISH, out);
+#else
+            return false;
+#endif
+        case Encoding::Zstd:
+#ifdef JUMMAH_HAVE_ZSTD
+            return m_state->zstd && zstdInto(m_state->zstd, std::string(), ZSTD_e_end, out);
+#else
+            return false;
+#endif
+        case Encoding::Identity:
+            return true;
+    }
+    return false;
+}
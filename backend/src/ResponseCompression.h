@@ -0,0 +1,70 @@
+#ifndef RESPONSECOMPRESSION_H
+#define RESPONSECOMPRESSION_H
+
+#include <string>
+#include <memory>
+#include <cstddef>
+
+namespace httplib {
+struct Request;
+struct Response;
+}
+
+// Сжатие ответов API по Accept-Encoding: brotli, zstd или gzip (что есть в сборке).
+// apply() вызывается после обработчика (post-routing) и сжимает готовое тело JSON/текста
+// не меньше порога; ответы через content provider (статические файлы, диапазон дат)
+// не трогает - статика сжата заранее, а диапазон сжимается по частям через Stream.
+//
+// Контексты gzip и zstd для сжатия целого тела создаются один раз на поток и
+// сбрасываются между ответами (deflateReset, ZSTD_compressCCtx), а не выделяются заново;
+// у brotli сброса нет, его состояние создается на ответ. Уровни - быстрые: ответ
+// сжимается на каждом запросе, в отличие от статики.
+class ResponseCompression {
+public:
+    enum class Encoding { Identity, Gzip, Brotli, Zstd };
+
+    struct Options {
+        bool enabled = true;
+        size_t minSize = 1024;     // Меньше - заголовки и задержка не окупаются
+        int gzipLevel = 6;
+        int brotliQuality = 5;
+        int zstdLevel = 3;
+    };
+
+    static void configure(const Options& options);
+    // Кодировки, доступные в сборке: "br, zstd, gzip"
+    static std::string available();
+
+    // Значение q кодировки в Accept-Encoding ("gzip;q=0.5, br"); 0 - не принимается
+    static double acceptQuality(const std::string& header, const char* coding);
+    // Кодировка для ответа размером size (или оценкой размера): наибольшее q, при равных -
+    // br, zstd, gzip; Identity - сжатие выключено, ответ меньше порога или клиент не принимает
+    static Encoding choose(const httplib::Request& req, size_t size);
+    static const char* name(Encoding encoding);
+
+    // Сжать тело готового ответа (post-routing)
+    static void apply(const httplib::Request& req, httplib::Response& res);
+
+    // Потоковое сжатие ответа, который отдается частями: каждая часть сразу уходит клиенту
+    class Stream {
+    public:
+        explicit Stream(Encoding encoding);
+        ~Stream();
+        Stream(const Stream&) = delete;
+        Stream& operator=(const Stream&) = delete;
+
+        // Сжатые байты дописываются в out; false - ошибка кодировщика
+        bool write(const std::string& data, std::string& out);
+        // Завершить поток (последний блок и контрольная сумма)
+        bool finish(std::string& out);
+
+    private:
+        struct State;
+        std::unique_ptr<State> m_state;
+    };
+
+    // Сжать целиком; false - кодировщик недоступен или ошибка
+    static bool compress(Encoding encoding, const std::string& in, std::string& out);
+};
+
+#endif // RESPONSECOMPRESSION_H
@@ -0,0 +1,87 @@
+#ifndef SINGLEFLIGHT_H
+#define SINGLEFLIGHT_H
+
+#include <unordered_map>
+#include <future>
+#include <mutex>
+#include <chrono>
+#include <optional>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+// Объединение одинаковых одновременных запросов (single-flight).
+// Первый вызов с ключом выполняет fn, остальные вызовы с тем же ключом, пришедшие до его
+// завершения, не повторяют работу, а ждут общий shared_future. Исключение из fn получают
+// все ожидающие. Каждый ожидающий ждет не дольше своего таймаута; сам вызов при этом
+// продолжается и отдает результат остальным. Результаты не кешируются - ключ удаляется,
+// как только вызов завершен.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class SingleFlight {
+public:
+    struct Stats {
+        uint64_t calls;       // Выполнено вызовов fn
+        uint64_t coalesced;   // Запросов, дождавшихся чужого вызова
+        uint64_t timeouts;    // Ожидающих, не дождавшихся результата
+    };
+
+    SingleFlight() = default;
+    SingleFlight(const SingleFlight&) = delete;
+    SingleFlight& operator=(const SingleFlight&) = delete;
+
+    // Результат fn() для key; nullopt - результат чужого вызова не готов за timeout.
+    // Выполняющий вызов ограничен только собственными таймаутами fn
+    template <typename Fn>
+    std::optional<Value> run(const Key& key, std::chrono::milliseconds timeout, Fn&& fn) {
+        std::promise<Value> promise;
+        std::shared_future<Value> future;
+        bool leader = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_inFlight.find(key);
+            if (it != m_inFlight.end()) {
+                future = it->second;
+            } else {
+                future = promise.get_future().share();
+                m_inFlight.emplace(key, future);
+                leader = true;
+            }
+        }
+
+        if (leader) {
+            m_calls.fetch_add(1, std::memory_order_relaxed);
+            try {
+                promise.set_value(fn());
+            } catch (...) {
+                promise.set_exception(std::current_exception());
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_inFlight.erase(key);
+            }
+            return future.get();
+        }
+
+        if (future.wait_for(timeout) != std::future_status::ready) {
+            m_timeouts.fetch_add(1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        m_coalesced.fetch_add(1, std::memory_order_relaxed);
+        return future.get();
+    }
+
+    Stats stats() const {
+        return {m_calls.load(std::memory_order_relaxed),
+                m_coalesced.load(std::memory_order_relaxed),
+                m_timeouts.load(std::memory_order_relaxed)};
+    }
+
+private:
+    std::mutex m_mutex;
+    std::unordered_map<Key, std::shared_future<Value>, Hash> m_inFlight;
+    std::atomic<uint64_t> m_calls{0};
+    std::atomic<uint64_t> m_coalesced{0};
+    std::atomic<uint64_t> m_timeouts{0};
+};
+
+#endif // SINGLEFLIGHT_H
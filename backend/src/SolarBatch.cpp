@@ -0,0 +1,107 @@
+#include "SolarBatch.h"
+#include "SolarBatchKernel.h"
+#include "PrayerTimesCalculator.h"
+#include <cmath>
+#include <cstdlib>
+
+#if defined(JUMMAH_SIMD_X86)
+// Реализованы в SolarBatchSse42.cpp и SolarBatchAvx2.cpp (собираются с -msse4.2 / -mavx2 -mfma)
+size_t solarBatchComputeSse42(const SolarBatch::Input& input, const SolarBatch::Parameters& parameters,
+                              const SolarBatch::Output& output);
+size_t solarBatchComputeAvx2(const SolarBatch::Input& input, const SolarBatch::Parameters& parameters,
+                             const SolarBatch::Output& output);
+#endif
+
+namespace {
+
+struct ScalarOps {
+    using V = double;
+    using M = bool;
+    static constexpr size_t WIDTH = 1;
+
+    static V load(const double* p) { return *p; }
+    static void store(double* p, V v) { *p = v; }
+    static V set1(double x) { return x; }
+    static V sqrt(V a) { return std::sqrt(a); }
+    static V floor(V a) { return std::floor(a); }
+    static V abs(V a) { return std::fabs(a); }
+    static M lt(V a, V b) { return a < b; }
+    static M gt(V a, V b) { return a > b; }
+    static M both(M a, M b) { return a && b; }
+    static V select(M m, V a, V b) { return m ? a : b; }
+};
+
+SolarBatch::Isa detectIsa() {
+#if defined(JUMMAH_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SolarBatch::Isa::Avx2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return SolarBatch::Isa::Sse42;
+    }
+#endif
+    return SolarBatch::Isa::Scalar;
+}
+
+}  // namespace
+
+SolarBatch::Parameters SolarBatch::parametersFor(int method, int madhhab) {
+    // Углы метода берутся из той же подготовки, что и у скалярного калькулятора
+    PrayerTimesCalculator::Request request;
+    request.latitude = 0.0;
+    request.longitude = 0.0;
+    request.method = method;
+    request.madhhab = madhhab;
+    PrayerTimesCalculator::Context context = PrayerTimesCalculator::prepare(request);
+
+    Parameters parameters;
+    parameters.sinFajrAngle = context.sinFajrAngle;
+    parameters.sinSunriseAngle = context.sinSunriseAngle;
+    parameters.sinIshaAngle = context.sinIshaAngle;
+    parameters.ishaInterval = context.ishaInterval;
+    parameters.asrFactor = context.asrFactor;
+    parameters.offsets[0] = context.offsets.fajr;
+    parameters.offsets[1] = context.offsets.sunrise;
+    parameters.offsets[2] = context.offsets.dhuhr;
+    parameters.offsets[3] = context.offsets.asr;
+    parameters.offsets[4] = context.offsets.maghrib;
+    parameters.offsets[5] = context.offsets.isha;
+    return parameters;
+}
+
+SolarBatch::Isa SolarBatch::activeIsa() {
+    static const Isa isa = detectIsa();
+    return isa;
+}
+
+const char* SolarBatch::isaName(Isa isa) {
+    switch (isa) {
+        case Isa::Avx2: return "avx2";
+        case Isa::Sse42: return "sse4.2";
+        case Isa::Scalar: return "scalar";
+    }
+    return "scalar";
+}
+
+void SolarBatch::compute(const Input& input, const Parameters& parameters, const Output& output) {
+    computeWith(activeIsa(), input, parameters, output);
+}
+
+void SolarBatch::computeWith(Isa isa, const Input& input, const Parameters& parameters, const Output& output) {
+    size_t done = 0;
+
+#if defined(JUMMAH_SIMD_X86)
+    // Нельзя запускать набор инструкций, которого нет у процессора
+    if (isa == Isa::Avx2 && activeIsa() == Isa::Avx2) {
+        done = solarBatchComputeAvx2(input, parameters, output);
+    } else if (isa != Isa::Scalar && activeIsa() != Isa::Scalar) {
+        done = solarBatchComputeSse42(input, parameters, output);
+    }
+#else
+    (void)isa;
+#endif
+
+    // Хвост пакета (меньше ширины вектора) - скалярно
+    SolarKernel<ScalarOps>::run(input, parameters, output, done);
+}
@@ -0,0 +1,56 @@
+#ifndef SOLARBATCH_H
+#define SOLARBATCH_H
+
+#include <cstddef>
+
+// Пакетный расчет времен молитв для множества (день, место) сразу.
+// Данные хранятся как структура массивов: отдельные массивы юлианских дат, широт, долгот и
+// часовых поясов. Тригонометрия считается полиномами, векторно по 4 полосы (AVX2) или
+// 2 полосы (SSE4.2) double; набор инструкций выбирается во время выполнения по CPUID,
+// на остальных процессорах используется скалярный вариант тех же полиномов.
+class SolarBatch {
+public:
+    // Входные массивы длины count
+    struct Input {
+        const double* julianDays;  // Юлианская дата на 0h UT (см. PrayerTimesCalculator::julianDayFromDays)
+        const double* latitudes;
+        const double* longitudes;
+        const double* timezones;   // Смещение от UTC в часах
+        size_t count;
+    };
+
+    // Выходные массивы длины count, времена в часах местного времени (0-24)
+    struct Output {
+        double* fajr;
+        double* sunrise;
+        double* dhuhr;
+        double* asr;
+        double* maghrib;
+        double* isha;
+    };
+
+    // Параметры метода расчета, общие для всего пакета
+    struct Parameters {
+        double sinFajrAngle;
+        double sinSunriseAngle;
+        double sinIshaAngle;
+        double ishaInterval;  // > 0: Иша = Магриб + интервал (часы)
+        double asrFactor;
+        double offsets[6];    // Поправки метода (часы): fajr, sunrise, dhuhr, asr, maghrib, isha
+    };
+
+    enum class Isa { Scalar, Sse42, Avx2 };
+
+    static Parameters parametersFor(int method, int madhhab);
+
+    // Расчет лучшим доступным набором инструкций
+    static void compute(const Input& input, const Parameters& parameters, const Output& output);
+
+    // Расчет заданным набором инструкций (для сверки и замеров); недоступный - скаляр
+    static void computeWith(Isa isa, const Input& input, const Parameters& parameters, const Output& output);
+
+    static Isa activeIsa();
+    static const char* isaName(Isa isa);
+};
+
+#endif // SOLARBATCH_H
@@ -0,0 +1,29 @@
+// Собирается с -mavx2 -mfma (см. CMakeLists.txt); вызывается только после проверки CPUID
+#include "SolarBatchKernel.h"
+#include <immintrin.h>
+
+namespace {
+
+struct Avx2Ops {
+    using V = __m256d;
+    using M = __m256d;
+    static constexpr size_t WIDTH = 4;
+
+    static V load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, V v) { _mm256_storeu_pd(p, v); }
+    static V set1(double x) { return _mm256_set1_pd(x); }
+    static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+    static V floor(V a) { return _mm256_floor_pd(a); }
+    static V abs(V a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+    static M lt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static M gt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    static M both(M a, M b) { return _mm256_and_pd(a, b); }
+    static V select(M m, V a, V b) { return _mm256_blendv_pd(b, a, m); }
+};
+
+}  // namespace
+
+size_t solarBatchComputeAvx2(const SolarBatch::Input& input, const SolarBatch::Parameters& parameters,
+                             const SolarBatch::Output& output) {
+    return SolarKernel<Avx2Ops>::run(input, parameters, output, 0);
+}
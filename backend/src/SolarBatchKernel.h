@@ -0,0 +1,177 @@
+#ifndef SOLARBATCHKERNEL_H
+#define SOLARBATCHKERNEL_H
+
+// Общее ядро пакетного расчета для SolarBatch.
+// Подключается в нескольких единицах трансляции, собранных с разными флагами (-msse4.2,
+// -mavx2), поэтому все определения лежат в анонимном пространстве имен: каждая единица
+// получает свою копию, и компоновщик не может подставить AVX2-код в скалярный путь.
+//
+// Ops задает тип вектора V и операции над ним (load/store/set1/sqrt/floor/abs/сравнения/
+// select); арифметика (+ - * /) использует векторные расширения GCC/Clang.
+// Полиномы sin/cos и atan - из библиотеки Cephes (точность ~1e-16 на приведенном интервале).
+
+#include "SolarBatch.h"
+
+namespace {
+
+template <class Ops>
+struct SolarKernel {
+    using V = typename Ops::V;
+    using M = typename Ops::M;
+
+    static constexpr double PI = 3.14159265358979323846;
+    static constexpr double DEG = PI / 180.0;
+    static constexpr double RAD = 180.0 / PI;
+
+    static V c(double x) { return Ops::set1(x); }
+
+    // sin и cos одновременно: приведение к [-pi/4, pi/4] по квадрантам (Cody-Waite)
+    static void sincos(V x, V& s, V& co) {
+        const V k = Ops::floor(x * c(2.0 / PI) + c(0.5));
+        V r = x - k * c(1.57079625129699707031);
+        r = r - k * c(7.54978941586159635336e-8);
+        r = r - k * c(5.39030285815811905290e-15);
+        const V z = r * r;
+
+        V sp = c(1.58962301576546568060e-10);
+        sp = sp * z + c(-2.50507477628578072866e-8);
+        sp = sp * z + c(2.75573136213857245213e-6);
+        sp = sp * z + c(-1.98412698295895385996e-4);
+        sp = sp * z + c(8.33333333332211858878e-3);
+        sp = sp * z + c(-1.66666666666666307295e-1);
+        const V sinr = r + r * z * sp;
+
+        V cp = c(-1.13585365213876817300e-11);
+        cp = cp * z + c(2.08757008419747316778e-9);
+        cp = cp * z + c(-2.75573141792967388112e-7);
+        cp = cp * z + c(2.48015872888517045348e-5);
+        cp = cp * z + c(-1.38888888888730564116e-3);
+        cp = cp * z + c(4.16666666666665929218e-2);
+        const V cosr = c(1.0) - c(0.5) * z + z * z * cp;
+
+        // Квадрант 0..3
+        const V q = k - c(4.0) * Ops::floor(k * c(0.25));
+        const M odd = Ops::gt(q - c(2.0) * Ops::floor(q * c(0.5)), c(0.5));
+        const V s0 = Ops::select(odd, cosr, sinr);
+        const V c0 = Ops::select(odd, sinr, cosr);
+        const M sinNegative = Ops::gt(q, c(1.5));
+        const M cosNegative = Ops::both(Ops::gt(q, c(0.5)), Ops::lt(q, c(2.5)));
+        s = Ops::select(sinNegative, c(0.0) - s0, s0);
+        co = Ops::select(cosNegative, c(0.0) - c0, c0);
+    }
+
+    static V atan(V x) {
+        const V ax = Ops::abs(x);
+        const M big = Ops::gt(ax, c(2.41421356237309504880));  // tan(3*pi/8)
+        const M mid = Ops::gt(ax, c(0.66));
+        const V xr = Ops::select(big, c(-1.0) / ax,
+                                 Ops::select(mid, (ax - c(1.0)) / (ax + c(1.0)), ax));
+        const V y0 = Ops::select(big, c(PI / 2.0), Ops::select(mid, c(PI / 4.0), c(0.0)));
+        const V z = xr * xr;
+
+        V p = c(-8.750608600031904122785e-1);
+        p = p * z + c(-1.615753718733365076637e1);
+        p = p * z + c(-7.500855792314704667340e1);
+        p = p * z + c(-1.228866684490136173410e2);
+        p = p * z + c(-6.485021904942025371773e1);
+
+        V qq = z + c(2.485846490142306297962e1);
+        qq = qq * z + c(1.650270098316988542046e2);
+        qq = qq * z + c(4.328810604912902668951e2);
+        qq = qq * z + c(4.853903996359136964868e2);
+        qq = qq * z + c(1.945506571482613964425e2);
+
+        const V result = y0 + xr + xr * z * p / qq;
+        return Ops::select(Ops::lt(x, c(0.0)), c(0.0) - result, result);
+    }
+
+    static V atan2(V y, V x) {
+        const V a = atan(y / x);
+        const V shift = Ops::select(Ops::lt(y, c(0.0)), c(-PI), c(PI));
+        return Ops::select(Ops::lt(x, c(0.0)), a + shift, a);
+    }
+
+    // acos через atan2; для |x| > 1 (полярный день/ночь) дает NaN, как и std::acos
+    static V acos(V x) {
+        return atan2(Ops::sqrt(c(1.0) - x * x), x);
+    }
+
+    static V fixhour(V a) {
+        return a - c(24.0) * Ops::floor(a * c(1.0 / 24.0));
+    }
+
+    static void computeBlock(const SolarBatch::Input& in, const SolarBatch::Parameters& p,
+                             const SolarBatch::Output& out, size_t i) {
+        const V jd = Ops::load(in.julianDays + i);
+        const V lat = Ops::load(in.latitudes + i);
+        const V lon = Ops::load(in.longitudes + i);
+        const V tz = Ops::load(in.timezones + i);
+
+        // Положение солнца в местный полдень (как PrayerTimesCalculator::computeDay)
+        const V jdate = jd - lon * c(1.0 / 360.0) + c(0.5);
+        const V T = (jdate - c(2451545.0)) * c(1.0 / 36525.0);
+        const V e = c(23.43929) - c(0.0130125) * T;
+        const V L0 = c(280.466) + c(36000.770) * T;
+        const V L = L0 - c(360.0) * Ops::floor(L0 * c(1.0 / 360.0));
+        const V G = c(357.528) + c(35999.050) * T;
+
+        V sinG, cosG;
+        sincos(G * c(DEG), sinG, cosG);
+        // 0.020 * sin(2G) = 0.040 * sin(G) * cos(G)
+        const V lambda = L + c(1.915) * sinG + c(0.040) * sinG * cosG;
+
+        V sinLambda, cosLambda, sinE, cosE;
+        sincos(lambda * c(DEG), sinLambda, cosLambda);
+        sincos(e * c(DEG), sinE, cosE);
+
+        const V sinDecl = sinE * sinLambda;
+        const V cosDecl = Ops::sqrt(c(1.0) - sinDecl * sinDecl);
+        const V decl = atan2(sinDecl, cosDecl) * c(RAD);
+
+        const V ra = atan2(cosE * sinLambda, cosLambda) * c(RAD / 15.0);
+        const V eqt = L0 * c(1.0 / 15.0) - fixhour(ra);
+        const V noon = fixhour(c(12.0) - eqt);
+
+        V sinLat, cosLat;
+        sincos(lat * c(DEG), sinLat, cosLat);
+        const V k = sinDecl * sinLat;
+        const V denom = cosDecl * cosLat;
+        auto hourAngle = [&](V sinAngle) {
+            return acos((c(0.0) - sinAngle - k) / denom) * c(RAD / 15.0);
+        };
+
+        // Asr: угол = -atan(x), x = 1 / (factor + tan|lat - decl|); sin(-atan(x)) = -x / sqrt(1 + x^2)
+        V sinD, cosD;
+        sincos(Ops::abs(lat - decl) * c(DEG), sinD, cosD);
+        const V x = c(1.0) / (c(p.asrFactor) + sinD / cosD);
+        const V sinAsr = c(0.0) - x / Ops::sqrt(c(1.0) + x * x);
+
+        const V adjustment = tz - lon * c(1.0 / 15.0);
+        const V maghrib = noon + hourAngle(c(p.sinSunriseAngle)) + adjustment;
+        V isha = noon + hourAngle(c(p.sinIshaAngle)) + adjustment;
+        if (p.ishaInterval > 0.0) {
+            isha = maghrib + c(p.ishaInterval);
+        }
+
+        Ops::store(out.fajr + i, fixhour(noon - hourAngle(c(p.sinFajrAngle)) + adjustment + c(p.offsets[0])));
+        Ops::store(out.sunrise + i, fixhour(noon - hourAngle(c(p.sinSunriseAngle)) + adjustment + c(p.offsets[1])));
+        Ops::store(out.dhuhr + i, fixhour(noon + adjustment + c(p.offsets[2])));
+        Ops::store(out.asr + i, fixhour(noon + hourAngle(sinAsr) + adjustment + c(p.offsets[3])));
+        Ops::store(out.maghrib + i, fixhour(maghrib + c(p.offsets[4])));
+        Ops::store(out.isha + i, fixhour(isha + c(p.offsets[5])));
+    }
+
+    // Обрабатывает полные блоки начиная с begin; возвращает индекс первого необработанного элемента
+    static size_t run(const SolarBatch::Input& in, const SolarBatch::Parameters& p,
+                      const SolarBatch::Output& out, size_t begin) {
+        size_t i = begin;
+        for (; i + Ops::WIDTH <= in.count; i += Ops::WIDTH) {
+            computeBlock(in, p, out, i);
+        }
+        return i;
+    }
+};
+
+}  // namespace
+
+#endif // SOLARBATCHKERNEL_H
@@ -0,0 +1,29 @@
+// Собирается с -msse4.2 (см. CMakeLists.txt); вызывается только после проверки CPUID
+#include "SolarBatchKernel.h"
+#include <immintrin.h>
+
+namespace {
+
+struct Sse42Ops {
+    using V = __m128d;
+    using M = __m128d;
+    static constexpr size_t WIDTH = 2;
+
+    static V load(const double* p) { return _mm_loadu_pd(p); }
+    static void store(double* p, V v) { _mm_storeu_pd(p, v); }
+    static V set1(double x) { return _mm_set1_pd(x); }
+    static V sqrt(V a) { return _mm_sqrt_pd(a); }
+    static V floor(V a) { return _mm_floor_pd(a); }
+    static V abs(V a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+    static M lt(V a, V b) { return _mm_cmplt_pd(a, b); }
+    static M gt(V a, V b) { return _mm_cmpgt_pd(a, b); }
+    static M both(M a, M b) { return _mm_and_pd(a, b); }
+    static V select(M m, V a, V b) { return _mm_blendv_pd(b, a, m); }
+};
+
+}  // namespace
+
+size_t solarBatchComputeSse42(const SolarBatch::Input& input, const SolarBatch::Parameters& parameters,
+                              const SolarBatch::Output& output) {
+    return SolarKernel<Sse42Ops>::run(input, parameters, output, 0);
+}
@@ -0,0 +1,145 @@
+#include "SolarEphemeris.h"
+#include "PrayerTimesCalculator.h"
+#include "Logger.h"
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+const char MAGIC[8] = {'J', 'P', 'S', 'O', 'L', 'E', 'P', 'H'};
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+}
+
+const SolarEphemeris::Record* SolarEphemeris::s_records = nullptr;
+int32_t SolarEphemeris::s_firstDay = 0;
+uint32_t SolarEphemeris::s_count = 0;
+void* SolarEphemeris::s_mapping = nullptr;
+size_t SolarEphemeris::s_mappingSize = 0;
+
+bool SolarEphemeris::load(const std::string& path) {
+    unload();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG_WARN("Ephemeris") << "⚠️ Таблица не найдена: " << path << " (будет прямой расчет)";
+        return false;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        LOG_ERROR("Ephemeris") << "❌ Некорректный файл таблицы: " << path;
+        ::close(fd);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("Ephemeris") << "❌ Ошибка mmap: " << path;
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, mapping, sizeof(Header));
+    bool valid = std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 header.version == VERSION &&
+                 header.byteOrder == BYTE_ORDER_MARK &&
+                 header.recordSize == sizeof(Record) &&
+                 size == sizeof(Header) + static_cast<size_t>(header.count) * sizeof(Record);
+    if (!valid) {
+        LOG_ERROR("Ephemeris") << "❌ Неподдерживаемый формат или версия таблицы: " << path;
+        munmap(mapping, size);
+        return false;
+    }
+
+    s_mapping = mapping;
+    s_mappingSize = size;
+    s_firstDay = header.firstDay;
+    s_count = header.count;
+    s_records = reinterpret_cast<const Record*>(static_cast<const char*>(mapping) + sizeof(Header));
+
+    int y, m, d;
+    PrayerTimesCalculator::civilFromDays(s_firstDay, y, m, d);
+    LOG_INFO("Ephemeris") << "✅ Таблица загружена: " << path << " (" << s_count << " дней с "
+                          << y << "-" << m << "-" << d << ", " << size / 1024 << " КБ)";
+    return true;
+}
+
+void SolarEphemeris::unload() {
+    if (s_mapping != nullptr) {
+        munmap(s_mapping, s_mappingSize);
+    }
+    s_records = nullptr;
+    s_mapping = nullptr;
+    s_mappingSize = 0;
+    s_firstDay = 0;
+    s_count = 0;
+}
+
+bool SolarEphemeris::build(const std::string& path, int fromYear, int toYear) {
+    const int firstDay = PrayerTimesCalculator::daysFromCivil(fromYear, 1, 1);
+    const int lastDay = PrayerTimesCalculator::daysFromCivil(toYear, 1, 1);
+    if (lastDay <= firstDay) {
+        return false;
+    }
+
+    std::vector<Record> records;
+    records.reserve(static_cast<size_t>(lastDay - firstDay));
+
+    for (int day = firstDay; day < lastDay; ++day) {
+        // Квадратичный полином по трем точкам: offset = -0.5, 0, +0.5 суток от 12:00 UT
+        const double noonUt = PrayerTimesCalculator::julianDayFromDays(day) + 0.5;
+        double decl[3], noon[3];
+        for (int k = 0; k < 3; ++k) {
+            PrayerTimesCalculator::solarPosition(noonUt + (k - 1) * 0.5, decl[k], noon[k]);
+        }
+
+        auto fit = [](const double v[3], float out[3]) {
+            // v(f) = c0 + c1*f + c2*f^2 при f = -0.5, 0, 0.5
+            out[0] = static_cast<float>(v[1]);
+            out[1] = static_cast<float>(v[2] - v[0]);
+            out[2] = static_cast<float>(2.0 * (v[2] + v[0] - 2.0 * v[1]));
+        };
+
+        Record record;
+        fit(decl, record.declination);
+        fit(noon, record.noon);
+        records.push_back(record);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.recordSize = sizeof(Record);
+    header.firstDay = firstDay;
+    header.count = static_cast<uint32_t>(records.size());
+
+    std::filesystem::path target = path;
+    if (target.has_parent_path()) {
+        std::filesystem::create_directories(target.parent_path());
+    }
+
+    // Пишем во временный файл и переименовываем: работающие процессы не увидят половину таблицы
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(records.data()),
+                  static_cast<std::streamsize>(records.size() * sizeof(Record)));
+        if (!out) {
+            return false;
+        }
+    }
+    std::filesystem::rename(tmpPath, path);
+    return true;
+}
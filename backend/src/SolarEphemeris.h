@@ -0,0 +1,64 @@
+#ifndef SOLAREPHEMERIS_H
+#define SOLAREPHEMERIS_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Предрасчитанная таблица положения солнца: склонение и время истинного полдня на каждый
+// день диапазона (по умолчанию 1900-2200). Файл создается утилитой build_ephemeris и
+// отображается сервером в память (mmap) только для чтения - страницы общие для всех
+// процессов. Расчет дня сводится к индексу в массиве вместо тригонометрии.
+//
+// Значения зависят от долготы через смещение момента наблюдения от полудня UT
+// (offset = -долгота/360 суток, |offset| <= 0.5), поэтому для каждого дня хранится
+// квадратичный полином по offset: v(f) = c0 + c1*f + c2*f^2.
+class SolarEphemeris {
+public:
+    static constexpr uint32_t VERSION = 1;
+
+    struct Header {
+        char magic[8];          // "JPSOLEPH"
+        uint32_t version;
+        uint32_t byteOrder;     // 0x01020304 в порядке байт машины, создавшей файл
+        uint32_t recordSize;
+        int32_t firstDay;       // Первый день таблицы (дни от 1970-01-01)
+        uint32_t count;         // Количество дней
+        uint32_t reserved;
+    };
+
+    struct Record {
+        float declination[3];   // Склонение солнца, градусы
+        float noon[3];          // Истинный полдень (12 - уравнение времени), часы
+    };
+
+    // Отобразить файл таблицы в память; false, если файла нет или он некорректен
+    static bool load(const std::string& path);
+    static void unload();
+    static bool isLoaded() { return s_records != nullptr; }
+
+    // Положение солнца для дня days (от 1970-01-01) со смещением offset суток от 12:00 UT.
+    // false - день вне таблицы или таблица не загружена (нужен прямой расчет)
+    static bool lookup(int days, double offset, double& declination, double& noon) {
+        const int64_t index = static_cast<int64_t>(days) - s_firstDay;
+        if (s_records == nullptr || index < 0 || index >= static_cast<int64_t>(s_count)) {
+            return false;
+        }
+        const Record& r = s_records[index];
+        declination = r.declination[0] + offset * (r.declination[1] + offset * r.declination[2]);
+        noon = r.noon[0] + offset * (r.noon[1] + offset * r.noon[2]);
+        return true;
+    }
+
+    // Построить файл таблицы для [fromYear, toYear) (используется build_ephemeris)
+    static bool build(const std::string& path, int fromYear, int toYear);
+
+private:
+    static const Record* s_records;
+    static int32_t s_firstDay;
+    static uint32_t s_count;
+    static void* s_mapping;
+    static size_t s_mappingSize;
+};
+
+#endif // SOLAREPHEMERIS_H
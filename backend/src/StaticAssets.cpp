@@ -0,0 +1,510 @@
+#define CPPHTTPLIB_OPENSSL_SUPPORT
+#define CPPHTTPLIB_USE_CERTS_FROM_MACOSX_KEYCHAIN
+#include "StaticAssets.h"
+#include "FileService.h"
+#include "Logger.h"
+#include "JsonService.h"
+#include "ResponseCompression.h"
+#include <httplib.h>
+#include <filesystem>
+#include <system_error>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <cstring>
+#include <cctype>
+#include <zlib.h>
+#include <openssl/evp.h>
+#ifdef JUMMAH_HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t MAX_FILE_SIZE = 16 * 1024 * 1024;  // Крупнее - не загружаются
+const size_t MIN_COMPRESS_SIZE = 256;           // Меньше - сжатие не окупает заголовки
+const int POLL_INTERVAL_MS = 2000;              // Слежение без inotify
+const int DEBOUNCE_MS = 200;                    // Редактор пишет файл в несколько приемов
+const size_t FINGERPRINT_LENGTH = 12;           // Символов хеша в пути файла
+
+// Файлы веб-корня по путям запроса: обычным и с отпечатком
+struct Snapshot {
+    std::unordered_map<std::string, std::shared_ptr<const StaticAssets::Asset>> assets;
+    size_t files = 0;
+    size_t bytes = 0;
+};
+
+// Текущий снимок: читается и заменяется через std::atomic_load/atomic_store
+std::shared_ptr<const Snapshot> s_current;
+std::string s_root;
+std::mutex s_reloadMutex;  // reload() из потока слежения и из main() не пересекаются
+
+std::mutex s_watchMutex;
+std::condition_variable s_watchWake;
+std::thread s_watchThread;
+std::atomic<bool> s_watchRunning{false};
+
+bool isCompressible(const std::string& mimeType) {
+    return mimeType.rfind("text/", 0) == 0 || mimeType.find("javascript") != std::string::npos ||
+           mimeType.find("json") != std::string::npos || mimeType.find("xml") != std::string::npos;
+}
+
+// Сжатый вариант стоит хранить, если он хотя бы на десятую часть меньше
+bool worthKeeping(const std::string& compressed, const std::string& body) {
+    return !compressed.empty() && compressed.size() < body.size() - body.size() / 10;
+}
+
+std::string gzipCompress(const std::string& body) {
+    z_stream stream{};
+    // 15 + 16: окно 32 КБ и заголовок gzip
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) return "";
+    std::string out(deflateBound(&stream, body.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+    stream.avail_in = static_cast<uInt>(body.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = static_cast<uInt>(out.size());
+    const int result = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return result == Z_STREAM_END ? out : "";
+}
+
+std::string brotliCompress(const std::string& body) {
+#ifdef JUMMAH_HAVE_BROTLI
+    size_t size = BrotliEncoderMaxCompressedSize(body.size());
+    if (size == 0) return "";
+    std::string out(size, '\0');
+    if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, body.size(),
+                               reinterpret_cast<const uint8_t*>(body.data()), &size,
+                               reinterpret_cast<uint8_t*>(&out[0]))) {
+        return "";
+    }
+    out.resize(size);
+    return out;
+#else
+    (void)body;
+    return "";
+#endif
+}
+
+// Первые 16 байт SHA-256 в hex
+std::string contentHash(const std::string& body) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    if (!EVP_Digest(body.data(), body.size(), digest, &length, EVP_sha256(), nullptr)) return "";
+    static const char HEX[] = "0123456789abcdef";
+    std::string hash;
+    for (unsigned int i = 0; i < 16 && i < length; ++i) {
+        hash += HEX[digest[i] >> 4];
+        hash += HEX[digest[i] & 0x0F];
+    }
+    return hash;
+}
+
+int64_t modifiedTime(const std::filesystem::directory_entry& entry) {
+    std::error_code error;
+    const auto time = entry.last_write_time(error);
+    return error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+// Каталоги, которые не относятся к раздаваемым файлам
+bool isSkipped(const std::filesystem::path& name) {
+    const std::string text = name.string();
+    return text.empty() || text[0] == '.' || text == "node_modules";
+}
+
+bool isPage(const std::string& mimeType) {
+    return mimeType.rfind("text/html", 0) == 0;
+}
+
+// Путь с хешем содержимого перед расширением: "/js/app.js" -> "/js/app.3f2a1b9c0d4e.js".
+// Каталог остается прежним, поэтому относительные ссылки внутри файла не меняются
+std::string fingerprintedPath(const std::string& path, const std::string& hash) {
+    const size_t slash = path.rfind('/');
+    const size_t dot = path.rfind('.');
+    const std::string tag = "." + hash.substr(0, FINGERPRINT_LENGTH);
+    if (dot == std::string::npos || dot < slash || dot == slash + 1) return path + tag;
+    return path.substr(0, dot) + tag + path.substr(dot);
+}
+
+// Ссылки src="/..." и href="/..." на файлы с отпечатком заменяются путями с хешем
+// (запрос и фрагмент ссылки сохраняются); внешние и относительные ссылки не меняются
+std::string rewriteLinks(const std::string& html, const std::unordered_map<std::string, std::string>& urls) {
+    std::string out;
+    out.reserve(html.size() + 256);
+    size_t position = 0;
+    while (position < html.size()) {
+        size_t attribute = std::string::npos;
+        size_t valueStart = 0;
+        for (const char* name : {"src=", "href="}) {
+            const size_t found = html.find(name, position);
+            if (found < attribute) {
+                attribute = found;
+                valueStart = found + std::strlen(name);
+            }
+        }
+        if (attribute == std::string::npos || valueStart >= html.size()) break;
+
+        const char quote = html[valueStart];
+        const bool boundary = attribute == 0 || std::isspace(static_cast<unsigned char>(html[attribute - 1]));
+        const size_t valueEnd = (quote == '"' || quote == '\'') ? html.find(quote, valueStart + 1) : std::string::npos;
+        if (!boundary || valueEnd == std::string::npos) {
+            out.append(html, position, valueStart - position);
+            position = valueStart;
+            continue;
+        }
+
+        const std::string value = html.substr(valueStart + 1, valueEnd - valueStart - 1);
+        const size_t suffix = value.find_first_of("?#");
+        auto found = value.rfind("//", 0) == 0 ? urls.end() : urls.find(value.substr(0, suffix));
+        out.append(html, position, valueStart + 1 - position);
+        if (found != urls.end()) {
+            out += found->second;
+            if (suffix != std::string::npos) out.append(value, suffix, std::string::npos);
+        } else {
+            out += value;
+        }
+        position = valueEnd;
+    }
+    out.append(html, position, std::string::npos);
+    return out;
+}
+
+// ETag, отпечаток и сжатые варианты по готовому телу
+void prepare(StaticAssets::Asset& asset) {
+    const std::string hash = contentHash(asset.body);
+    asset.etag = "\"" + hash + "\"";
+    // Страницы не получают отпечатка: их адреса знает пользователь, они всегда проверяются
+    if (!isPage(asset.mimeType)) asset.url = fingerprintedPath(asset.path, hash);
+
+    if (asset.body.size() >= MIN_COMPRESS_SIZE && isCompressible(asset.mimeType)) {
+        std::string gzip = gzipCompress(asset.body);
+        if (worthKeeping(gzip, asset.body)) asset.gzip = std::move(gzip);
+        std::string brotli = brotliCompress(asset.body);
+        if (worthKeeping(brotli, asset.body)) asset.brotli = std::move(brotli);
+    }
+}
+
+std::shared_ptr<StaticAssets::Asset> readAsset(const std::string& path, const std::string& filePath,
+                                               uint64_t size, int64_t modified) {
+    auto asset = std::make_shared<StaticAssets::Asset>();
+    asset->path = path;
+    asset->mimeType = FileService::getMimeType(path);
+    asset->body = FileService::readFile(filePath);
+    asset->size = size;
+    asset->modified = modified;
+    return asset;
+}
+
+// Новый снимок веб-корня; файлы с прежними размером и временем изменения берутся из
+// previous без повторного чтения и сжатия. Страницы ссылаются на отпечатки остальных
+// файлов, поэтому при любом изменении собираются заново
+std::shared_ptr<const Snapshot> scan(const std::string& root, const Snapshot* previous, bool& changed) {
+    namespace fs = std::filesystem;
+    auto snapshot = std::make_shared<Snapshot>();
+    changed = previous == nullptr;
+
+    std::error_code error;
+    fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, error);
+    if (error) return nullptr;
+
+    struct Page {
+        std::string path;
+        std::string filePath;
+        uint64_t size;
+        int64_t modified;
+    };
+    std::vector<std::shared_ptr<const StaticAssets::Asset>> assets;
+    std::vector<Page> pages;
+    size_t unchanged = 0;
+
+    for (; it != fs::recursive_directory_iterator(); it.increment(error)) {
+        if (error) break;
+        const fs::directory_entry& entry = *it;
+        if (isSkipped(entry.path().filename())) {
+            if (entry.is_directory(error)) it.disable_recursion_pending();
+            continue;
+        }
+        if (!entry.is_regular_file(error)) continue;
+
+        const uint64_t size = entry.file_size(error);
+        if (error || size > MAX_FILE_SIZE) continue;
+        const int64_t modified = modifiedTime(entry);
+        const std::string path = "/" + fs::relative(entry.path(), root, error).generic_string();
+        if (error) continue;
+
+        std::shared_ptr<const StaticAssets::Asset> asset;
+        if (previous) {
+            auto found = previous->assets.find(path);
+            if (found != previous->assets.end() && found->second->path == path &&
+                found->second->size == size && found->second->modified == modified) {
+                asset = found->second;
+                ++unchanged;
+            }
+        }
+        if (isPage(FileService::getMimeType(path))) {
+            if (!asset) changed = true;
+            pages.push_back({path, entry.path().string(), size, modified});
+            continue;
+        }
+        if (!asset) {
+            auto built = readAsset(path, entry.path().string(), size, modified);
+            prepare(*built);
+            asset = std::move(built);
+            changed = true;
+        }
+        assets.push_back(std::move(asset));
+    }
+    if (previous && unchanged != previous->files) changed = true;
+
+    std::unordered_map<std::string, std::string> urls;
+    for (const auto& asset : assets) urls.emplace(asset->path, asset->url);
+    for (const auto& page : pages) {
+        std::shared_ptr<const StaticAssets::Asset> asset;
+        if (!changed) asset = previous->assets.at(page.path);
+        if (!asset) {
+            auto built = readAsset(page.path, page.filePath, page.size, page.modified);
+            built->body = rewriteLinks(built->body, urls);
+            prepare(*built);
+            asset = std::move(built);
+        }
+        assets.push_back(std::move(asset));
+    }
+
+    // Файл доступен и по обычному пути, и по пути с отпечатком
+    for (auto& asset : assets) {
+        snapshot->bytes += asset->body.size() + asset->gzip.size() + asset->brotli.size();
+        if (!asset->url.empty()) snapshot->assets.emplace(asset->url, asset);
+        snapshot->assets.emplace(asset->path, std::move(asset));
+    }
+    snapshot->files = assets.size();
+    return snapshot;
+}
+
+} // namespace
+
+bool StaticAssets::load(const std::string& webRoot) {
+    std::lock_guard<std::mutex> lock(s_reloadMutex);
+    const auto started = std::chrono::steady_clock::now();
+
+    bool changed = false;
+    auto snapshot = scan(webRoot, nullptr, changed);
+    if (!snapshot) {
+        LOG_ERROR("Static") << "❌ Не удалось прочитать веб-корень: " << webRoot;
+        return false;
+    }
+    s_root = webRoot;
+
+    size_t plain = 0, gzip = 0, brotli = 0;
+    for (const auto& entry : snapshot->assets) {
+        if (entry.first != entry.second->path) continue;
+        plain += entry.second->body.size();
+        gzip += entry.second->gzip.empty() ? entry.second->body.size() : entry.second->gzip.size();
+        brotli += entry.second->brotli.empty() ? entry.second->body.size() : entry.second->brotli.size();
+    }
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+    LOG_INFO("Static").field("files", snapshot->files).field("kb", plain / 1024)
+        .field("gzip_kb", gzip / 1024).field("br_kb", brotli / 1024).field("ms", ms.count())
+        << "📦 Статические файлы загружены в память: " << webRoot;
+
+    std::atomic_store(&s_current, snapshot);
+    return true;
+}
+
+bool StaticAssets::reload() {
+    std::lock_guard<std::mutex> lock(s_reloadMutex);
+    auto current = std::atomic_load(&s_current);
+    if (s_root.empty()) return false;
+
+    bool changed = false;
+    auto snapshot = scan(s_root, current.get(), changed);
+    if (!snapshot || !changed) return false;
+
+    std::atomic_store(&s_current, snapshot);
+    LOG_INFO("Static").field("files", snapshot->files) << "🔄 Веб-корень изменился, файлы перечитаны";
+    return true;
+}
+
+bool StaticAssets::serve(const httplib::Request& req, httplib::Response& res) {
+    auto snapshot = std::atomic_load(&s_current);
+    if (!snapshot) return false;
+
+    auto found = snapshot->assets.find(req.path == "/" ? "/index.html" : req.path);
+    if (found == snapshot->assets.end()) return false;
+    std::shared_ptr<const Asset> asset = found->second;
+
+    // Вариант по Accept-Encoding: brotli, затем gzip, иначе без сжатия
+    const std::string* body = &asset->body;
+    const char* encoding = nullptr;
+    if (!asset->gzip.empty() || !asset->brotli.empty()) {
+        res.set_header("Vary", "Accept-Encoding");
+        const std::string accept = req.get_header_value("Accept-Encoding");
+        if (!asset->brotli.empty() && ResponseCompression::acceptQuality(accept, "br") > 0.0) {
+            body = &asset->brotli;
+            encoding = "br";
+        } else if (!asset->gzip.empty() && ResponseCompression::acceptQuality(accept, "gzip") > 0.0) {
+            body = &asset->gzip;
+            encoding = "gzip";
+        }
+    }
+
+    // У каждого варианта свой ETag: кеш не должен отдать сжатое тело клиенту без поддержки
+    const std::string etag = encoding
+        ? asset->etag.substr(0, asset->etag.size() - 1) + "-" + encoding + "\""
+        : asset->etag;
+    res.set_header("ETag", etag);
+    // Путь с отпечатком меняется вместе с содержимым: такой ответ можно кешировать навсегда.
+    // Обычный путь (и страницы) всегда проверяется по ETag
+    const bool fingerprinted = !asset->url.empty() && req.path == asset->url;
+    res.set_header("Cache-Control", fingerprinted ? "public, max-age=31536000, immutable" : "no-cache");
+
+    if (req.has_header("If-None-Match") && matchesEtag(req.get_header_value("If-None-Match"), etag)) {
+        res.status = 304;
+        return true;
+    }
+
+    if (encoding) res.set_header("Content-Encoding", encoding);
+    res.status = 200;
+    res.set_content_provider(body->size(), asset->mimeType,
+        [asset, body](size_t offset, size_t length, httplib::DataSink& sink) {
+            return sink.write(body->data() + offset, length);
+        });
+    return true;
+}
+
+bool StaticAssets::matchesEtag(const std::string& header, const std::string& etag) {
+    const std::string opaque = etag.rfind("W/", 0) == 0 ? etag.substr(2) : etag;
+    size_t start = 0;
+    while (start < header.size()) {
+        size_t end = header.find(',', start);
+        if (end == std::string::npos) end = header.size();
+        std::string item = header.substr(start, end - start);
+        start = end + 1;
+
+        const size_t first = item.find_first_not_of(" \t");
+        const size_t last = item.find_last_not_of(" \t");
+        if (first == std::string::npos) continue;
+        item = item.substr(first, last - first + 1);
+        if (item.rfind("W/", 0) == 0) item.erase(0, 2);
+        if (item == "*" || item == opaque) return true;
+    }
+    return false;
+}
+
+void StaticAssets::watchLoop() {
+#ifdef __linux__
+    const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        LOG_WARN("Static") << "⚠️ inotify недоступен, изменения проверяются опросом";
+    }
+    // Каталоги добавляются заново после каждого перечитывания: могли появиться новые
+    auto watchDirectories = [fd]() {
+        namespace fs = std::filesystem;
+        std::error_code error;
+        const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+        inotify_add_watch(fd, s_root.c_str(), mask);
+        fs::recursive_directory_iterator it(s_root, fs::directory_options::skip_permission_denied, error);
+        for (; !error && it != fs::recursive_directory_iterator(); it.increment(error)) {
+            if (!it->is_directory(error)) continue;
+            if (isSkipped(it->path().filename())) {
+                it.disable_recursion_pending();
+                continue;
+            }
+            inotify_add_watch(fd, it->path().c_str(), mask);
+        }
+    };
+
+    if (fd >= 0) {
+        watchDirectories();
+        bool pending = false;
+        auto lastEvent = std::chrono::steady_clock::now();
+        char buffer[4096];
+        while (s_watchRunning.load()) {
+            pollfd descriptor{fd, POLLIN, 0};
+            const int ready = poll(&descriptor, 1, pending ? DEBOUNCE_MS : 500);
+            if (ready > 0) {
+                while (read(fd, buffer, sizeof(buffer)) > 0) {}
+                pending = true;
+                lastEvent = std::chrono::steady_clock::now();
+                continue;
+            }
+            if (pending && std::chrono::steady_clock::now() - lastEvent >= std::chrono::milliseconds(DEBOUNCE_MS)) {
+                pending = false;
+                if (reload()) watchDirectories();
+            }
+        }
+        close(fd);
+        return;
+    }
+#endif
+
+    std::unique_lock<std::mutex> lock(s_watchMutex);
+    while (s_watchRunning.load()) {
+        s_watchWake.wait_for(lock, std::chrono::milliseconds(POLL_INTERVAL_MS));
+        if (!s_watchRunning.load()) break;
+        lock.unlock();
+        reload();
+        lock.lock();
+    }
+}
+
+void StaticAssets::startWatching() {
+    std::lock_guard<std::mutex> lock(s_watchMutex);
+    if (s_watchRunning.load() || s_root.empty()) return;
+    s_watchRunning = true;
+    s_watchThread = std::thread(&StaticAssets::watchLoop);
+    LOG_INFO("Static") << "👀 Слежение за веб-корнем включено: " << s_root;
+}
+
+void StaticAssets::stopWatching() {
+    {
+        std::lock_guard<std::mutex> lock(s_watchMutex);
+        s_watchRunning = false;
+    }
+    s_watchWake.notify_all();
+    if (s_watchThread.joinable()) s_watchThread.join();
+}
+
+std::string StaticAssets::manifestJson() {
+    auto snapshot = std::atomic_load(&s_current);
+    std::map<std::string, std::string> urls;  // Упорядочено: ответ не зависит от обхода хеш-таблицы
+    if (snapshot) {
+        for (const auto& entry : snapshot->assets) {
+            if (entry.first == entry.second->path && !entry.second->url.empty()) {
+                urls.emplace(entry.second->path, entry.second->url);
+            }
+        }
+    }
+
+    std::ostringstream json;
+    json << "{";
+    bool first = true;
+    for (const auto& entry : urls) {
+        if (!first) json << ", ";
+        first = false;
+        json << "\"" << JsonService::escapeJsonString(entry.first) << "\": \""
+             << JsonService::escapeJsonString(entry.second) << "\"";
+    }
+    json << "}";
+    return json.str();
+}
+
+size_t StaticAssets::count() {
+    auto snapshot = std::atomic_load(&s_current);
+    return snapshot ? snapshot->files : 0;
+}
+
+size_t StaticAssets::bytes() {
+    auto snapshot = std::atomic_load(&s_current);
+    return snapshot ? snapshot->bytes : 0;
+}
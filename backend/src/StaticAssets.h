@@ -0,0 +1,72 @@
+#ifndef STATICASSETS_H
+#define STATICASSETS_H
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace httplib {
+struct Request;
+struct Response;
+}
+
+// Статические файлы фронтенда из памяти.
+// load() читает веб-корень целиком при запуске (node_modules и скрытые файлы пропускаются)
+// и для каждого файла заранее готовит все, что нужно ответу: тип содержимого, сжатые
+// варианты gzip и brotli (для текстовых типов, если сжатие заметно уменьшает файл) и
+// строгий ETag по хешу содержимого (у сжатых вариантов - с суффиксом кодировки).
+// serve() выбирает вариант по Accept-Encoding, отвечает 304 на совпавший If-None-Match
+// и отдает тело через content provider прямо из загруженной строки, без копирования в
+// ответ; запросы не обращаются к диску.
+//
+// Набор файлов - неизменяемый снимок, заменяемый атомарно (как CityIndex): ответ держит
+// свой файл, пока отправляется. startWatching() в разработке перечитывает веб-корень при
+// изменениях (inotify в Linux, иначе опрос раз в пару секунд); неизмененные файлы
+// (тот же размер и время изменения) берутся из прежнего снимка без повторного сжатия.
+//
+// Каждый файл, кроме HTML-страниц, доступен еще и по пути с отпечатком содержимого
+// ("/styles.3f2a1b9c0d4e.css"); такой ответ кешируется на год с immutable, обычный путь
+// по-прежнему проверяется по ETag. В страницах ссылки src/href на корневые пути заменяются
+// путями с отпечатком при загрузке, так что новая версия файла получает новый URL.
+class StaticAssets {
+public:
+    struct Asset {
+        std::string path;          // Путь запроса, "/styles.css"
+        std::string mimeType;
+        std::string body;
+        std::string gzip;          // Пусто - вариант не нужен (не текст или не уменьшается)
+        std::string brotli;
+        std::string etag;          // В кавычках: "\"<хеш>\""
+        std::string url;           // Путь с отпечатком хеша ("/styles.3f2a1b9c0d4e.css"); у страниц пусто
+        uint64_t size = 0;         // Размер и время изменения файла для повторного чтения
+        int64_t modified = 0;
+    };
+
+    // Прочитать веб-корень (путь с завершающим '/'); false - каталог не читается
+    static bool load(const std::string& webRoot);
+    // Перечитать измененные файлы текущего веб-корня; true - набор файлов изменился
+    static bool reload();
+
+    // Ответить файлом по пути запроса ("/" - index.html); false - такого файла нет
+    static bool serve(const httplib::Request& req, httplib::Response& res);
+
+    // Следить за веб-корнем (режим разработки); stopWatching - до выхода из main()
+    static void startWatching();
+    static void stopWatching();
+
+    // If-None-Match - список ETag или "*"; сравнение слабое (W/ не учитывается с обеих сторон).
+    // Используется и для ответов API
+    static bool matchesEtag(const std::string& ifNoneMatch, const std::string& etag);
+
+    // JSON-объект "логический путь" -> "путь с отпечатком" для /api/assets/manifest
+    static std::string manifestJson();
+
+    static size_t count();
+    static size_t bytes();
+
+private:
+    static void watchLoop();
+};
+
+#endif // STATICASSETS_H
@@ -0,0 +1,597 @@
+#include "TimeZoneService.h"
+#include "PrayerTimesCalculator.h"
+#include "Logger.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cctype>
+
+std::vector<TimeZoneService::Zone> TimeZoneService::s_zones;
+std::unordered_map<std::string, int> TimeZoneService::s_zoneIndex;
+std::vector<TimeZoneService::Anchor> TimeZoneService::s_anchors;
+std::vector<uint32_t> TimeZoneService::s_cellStart;
+std::vector<uint32_t> TimeZoneService::s_cellAnchors;
+std::atomic<uint64_t> TimeZoneService::s_cache[TimeZoneService::CACHE_SIZE];
+std::string TimeZoneService::s_dataVersion = "none";
+
+namespace {
+
+const int64_t SECONDS_PER_DAY = 86400;
+
+// Дни от 1970-01-01 для момента UTC (с округлением вниз для отрицательных)
+int64_t floorDays(int64_t seconds) {
+    return seconds >= 0 ? seconds / SECONDS_PER_DAY : -((-seconds + SECONDS_PER_DAY - 1) / SECONDS_PER_DAY);
+}
+
+int64_t readBigEndian(const unsigned char* p, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        value = (value << 8) | p[i];
+    }
+    // Знаковое расширение
+    if (bytes < 8 && (value & (uint64_t(1) << (bytes * 8 - 1)))) {
+        value |= ~uint64_t(0) << (bytes * 8);
+    }
+    return static_cast<int64_t>(value);
+}
+
+// Координаты ISO 6709 из zone.tab: +DDMM+DDDMM или +DDMMSS+DDDMMSS
+bool parseIso6709(const std::string& text, double& latitude, double& longitude) {
+    size_t split = text.find_first_of("+-", 1);
+    if (split == std::string::npos) return false;
+
+    auto parsePart = [](const std::string& part, int degreeDigits, double& out) -> bool {
+        if (part.size() < 1 + static_cast<size_t>(degreeDigits) + 2) return false;
+        int sign = part[0] == '-' ? -1 : 1;
+        std::string digits = part.substr(1);
+        double degrees = std::stoi(digits.substr(0, degreeDigits));
+        double minutes = std::stoi(digits.substr(degreeDigits, 2));
+        double seconds = digits.size() >= static_cast<size_t>(degreeDigits) + 4
+                             ? std::stoi(digits.substr(degreeDigits + 2, 2)) : 0;
+        out = sign * (degrees + minutes / 60.0 + seconds / 3600.0);
+        return true;
+    };
+
+    try {
+        return parsePart(text.substr(0, split), 2, latitude) && parsePart(text.substr(split), 3, longitude);
+    } catch (const std::exception& e) {
+        return false;
+    }
+}
+
+// Дополнительные опорные точки: крупные города в регионах, где опорных точек tzdata мало
+// и ближайшая из них часто принадлежит соседнему поясу (Россия, Центральная и Южная Азия,
+// Ближний Восток). Зоны, которых нет в установленной базе, пропускаются.
+struct ExtraAnchor {
+    double latitude;
+    double longitude;
+    const char* zone;
+};
+
+const ExtraAnchor EXTRA_ANCHORS[] = {
+    // Россия, UTC+3
+    {59.94, 30.31, "Europe/Moscow"}, {56.33, 44.00, "Europe/Moscow"}, {55.79, 49.12, "Europe/Moscow"},
+    {55.74, 52.40, "Europe/Moscow"}, {56.63, 47.89, "Europe/Moscow"}, {56.14, 47.25, "Europe/Moscow"},
+    {54.18, 45.17, "Europe/Moscow"}, {53.20, 45.00, "Europe/Moscow"}, {54.63, 39.70, "Europe/Moscow"},
+    {54.20, 37.62, "Europe/Moscow"}, {56.13, 40.40, "Europe/Moscow"}, {57.63, 39.87, "Europe/Moscow"},
+    {59.22, 39.90, "Europe/Moscow"}, {64.54, 40.54, "Europe/Moscow"}, {68.97, 33.07, "Europe/Moscow"},
+    {61.79, 34.35, "Europe/Moscow"}, {57.82, 28.33, "Europe/Moscow"}, {58.52, 31.27, "Europe/Moscow"},
+    {56.86, 35.90, "Europe/Moscow"}, {54.78, 32.05, "Europe/Moscow"}, {53.25, 34.37, "Europe/Moscow"},
+    {51.73, 36.19, "Europe/Moscow"}, {50.60, 36.60, "Europe/Moscow"}, {51.67, 39.18, "Europe/Moscow"},
+    {52.60, 39.60, "Europe/Moscow"}, {52.72, 41.45, "Europe/Moscow"}, {47.22, 39.70, "Europe/Moscow"},
+    {45.04, 38.98, "Europe/Moscow"}, {45.04, 41.97, "Europe/Moscow"}, {44.04, 43.06, "Europe/Moscow"},
+    {43.32, 45.69, "Europe/Moscow"}, {42.98, 47.50, "Europe/Moscow"}, {42.06, 48.29, "Europe/Moscow"},
+    {43.25, 46.59, "Europe/Moscow"}, {43.85, 46.71, "Europe/Moscow"}, {43.49, 43.60, "Europe/Moscow"},
+    {43.02, 44.68, "Europe/Moscow"}, {43.17, 44.81, "Europe/Moscow"}, {44.22, 42.05, "Europe/Moscow"},
+    {44.60, 40.10, "Europe/Moscow"}, {46.31, 44.26, "Europe/Moscow"}, {61.67, 50.84, "Europe/Moscow"},
+    // Россия, UTC+4 и UTC+5
+    {53.20, 50.15, "Europe/Samara"}, {53.51, 49.42, "Europe/Samara"}, {56.85, 53.20, "Europe/Samara"},
+    {54.73, 55.97, "Asia/Yekaterinburg"}, {53.63, 55.95, "Asia/Yekaterinburg"}, {51.77, 55.10, "Asia/Yekaterinburg"},
+    {55.15, 61.40, "Asia/Yekaterinburg"}, {53.41, 58.98, "Asia/Yekaterinburg"}, {58.00, 56.25, "Asia/Yekaterinburg"},
+    {57.15, 65.53, "Asia/Yekaterinburg"}, {55.45, 65.34, "Asia/Yekaterinburg"}, {58.20, 68.25, "Asia/Yekaterinburg"},
+    {61.25, 73.40, "Asia/Yekaterinburg"}, {61.00, 69.00, "Asia/Yekaterinburg"}, {66.53, 66.60, "Asia/Yekaterinburg"},
+    {60.94, 76.55, "Asia/Yekaterinburg"}, {66.08, 76.63, "Asia/Yekaterinburg"},
+    // Украина, Беларусь
+    {49.84, 24.03, "Europe/Kyiv"}, {49.99, 36.23, "Europe/Kyiv"}, {48.46, 35.05, "Europe/Kyiv"},
+    {49.23, 28.47, "Europe/Kyiv"}, {50.62, 26.25, "Europe/Kyiv"}, {48.62, 22.30, "Europe/Kyiv"},
+    {52.10, 23.70, "Europe/Minsk"}, {53.68, 23.83, "Europe/Minsk"}, {52.43, 31.00, "Europe/Minsk"},
+    {55.19, 30.20, "Europe/Minsk"},
+    // Казахстан, Киргизия
+    {51.17, 71.45, "Asia/Almaty"}, {49.80, 73.10, "Asia/Almaty"}, {52.29, 76.95, "Asia/Almaty"},
+    {49.95, 82.60, "Asia/Almaty"}, {42.30, 69.60, "Asia/Almaty"}, {50.41, 80.25, "Asia/Almaty"},
+    {40.53, 72.80, "Asia/Bishkek"}, {40.93, 73.00, "Asia/Bishkek"},
+    // Пакистан, Индия
+    {33.69, 73.05, "Asia/Karachi"}, {31.55, 74.34, "Asia/Karachi"}, {34.01, 71.58, "Asia/Karachi"},
+    {30.18, 66.99, "Asia/Karachi"}, {30.20, 71.47, "Asia/Karachi"}, {31.42, 73.08, "Asia/Karachi"},
+    {19.07, 72.88, "Asia/Kolkata"}, {28.61, 77.21, "Asia/Kolkata"}, {12.97, 77.59, "Asia/Kolkata"},
+    {13.08, 80.27, "Asia/Kolkata"}, {17.38, 78.49, "Asia/Kolkata"}, {23.02, 72.57, "Asia/Kolkata"},
+    {34.08, 74.80, "Asia/Kolkata"}, {26.85, 80.95, "Asia/Kolkata"}, {26.91, 75.79, "Asia/Kolkata"},
+    // Китай
+    {39.90, 116.40, "Asia/Shanghai"}, {30.66, 104.06, "Asia/Shanghai"}, {36.06, 103.83, "Asia/Shanghai"},
+    {34.26, 108.94, "Asia/Shanghai"}, {25.04, 102.70, "Asia/Shanghai"}, {29.65, 91.10, "Asia/Shanghai"},
+    {36.62, 101.78, "Asia/Shanghai"}, {38.47, 106.27, "Asia/Shanghai"}, {45.75, 126.65, "Asia/Shanghai"},
+    {23.13, 113.26, "Asia/Shanghai"},
+    // Ближний Восток, Турция, Египет
+    {21.42, 39.83, "Asia/Riyadh"}, {24.47, 39.61, "Asia/Riyadh"}, {21.49, 39.19, "Asia/Riyadh"},
+    {26.43, 50.10, "Asia/Riyadh"}, {28.38, 36.57, "Asia/Riyadh"}, {18.22, 42.50, "Asia/Riyadh"},
+    {36.20, 37.15, "Asia/Damascus"}, {37.91, 40.24, "Europe/Istanbul"}, {38.50, 43.40, "Europe/Istanbul"},
+    {39.90, 41.27, "Europe/Istanbul"}, {41.00, 39.72, "Europe/Istanbul"}, {36.90, 30.70, "Europe/Istanbul"},
+    {39.93, 32.86, "Europe/Istanbul"}, {38.42, 27.14, "Europe/Istanbul"}, {37.07, 37.38, "Europe/Istanbul"},
+    {24.09, 32.90, "Africa/Cairo"}, {31.20, 29.92, "Africa/Cairo"},
+    // Индонезия, Нигерия
+    {-7.25, 112.75, "Asia/Jakarta"}, {3.59, 98.67, "Asia/Jakarta"}, {5.55, 95.32, "Asia/Jakarta"},
+    {-8.65, 115.22, "Asia/Makassar"}, {-1.27, 116.83, "Asia/Makassar"},
+    {12.00, 8.52, "Africa/Lagos"}, {9.06, 7.49, "Africa/Lagos"},
+};
+
+double distanceKm(double lat1, double lon1, double lat2, double lon2) {
+    const double rad = 3.14159265358979323846 / 180.0;
+    double dLat = (lat2 - lat1) * rad;
+    double dLon = (lon2 - lon1) * rad;
+    double a = std::sin(dLat / 2) * std::sin(dLat / 2) +
+               std::cos(lat1 * rad) * std::cos(lat2 * rad) * std::sin(dLon / 2) * std::sin(dLon / 2);
+    return 6371.0 * 2.0 * std::atan2(std::sqrt(a), std::sqrt(1.0 - a));
+}
+
+}  // namespace
+
+bool TimeZoneService::initialize(const std::string& zoneinfoDir) {
+    s_zones.clear();
+    s_zoneIndex.clear();
+    s_anchors.clear();
+    s_dataVersion = "none";
+
+    loadZoneTab(zoneinfoDir + "/zone1970.tab", zoneinfoDir);
+    loadZoneTab(zoneinfoDir + "/zone.tab", zoneinfoDir);
+    if (!s_anchors.empty()) {
+        for (const ExtraAnchor& extra : EXTRA_ANCHORS) {
+            int zone = addZone(extra.zone, zoneinfoDir);
+            if (zone >= 0) s_anchors.push_back({extra.latitude, extra.longitude, zone});
+        }
+    }
+
+    if (s_anchors.empty()) {
+        LOG_WARN("TimeZone") << "⚠️ База часовых поясов не найдена в " << zoneinfoDir
+                             << " (будет использован часовой пояс сервера)";
+        s_zones.clear();
+        s_zoneIndex.clear();
+        return false;
+    }
+
+    // Зоны для открытого моря (Etc/GMT-14 .. Etc/GMT+12, знак в именах инвертирован) и UTC
+    addZone("UTC", zoneinfoDir);
+    addZone("Etc/GMT", zoneinfoDir);
+    for (int hours = 1; hours <= 14; ++hours) {
+        addZone("Etc/GMT-" + std::to_string(hours), zoneinfoDir);
+        if (hours <= 12) addZone("Etc/GMT+" + std::to_string(hours), zoneinfoDir);
+    }
+
+    buildGrid();
+    for (auto& entry : s_cache) {
+        entry.store(0, std::memory_order_relaxed);
+    }
+    s_dataVersion = readDataVersion(zoneinfoDir);
+
+    LOG_INFO("TimeZone") << "✅ Загружено зон: " << s_zones.size() << ", опорных точек: "
+                         << s_anchors.size() << " (" << zoneinfoDir << ", tzdata " << s_dataVersion << ")";
+    return true;
+}
+
+std::string TimeZoneService::readDataVersion(const std::string& zoneinfoDir) {
+    // tzdata.zi начинается со строки "# version 2025b"; в некоторых сборках есть файл +VERSION
+    std::ifstream zi(zoneinfoDir + "/tzdata.zi");
+    std::string line;
+    if (zi && std::getline(zi, line) && line.rfind("# version ", 0) == 0) {
+        return line.substr(10);
+    }
+    std::ifstream plus(zoneinfoDir + "/+VERSION");
+    if (plus && std::getline(plus, line) && !line.empty()) {
+        return line;
+    }
+    return "unknown";
+}
+
+void TimeZoneService::loadZoneTab(const std::string& path, const std::string& zoneinfoDir) {
+    std::ifstream file(path);
+    if (!file) return;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        // Колонки через табуляцию: коды стран, координаты, зона, комментарий
+        std::istringstream columns(line);
+        std::string countries, coordinates, name;
+        if (!std::getline(columns, countries, '\t') || !std::getline(columns, coordinates, '\t') ||
+            !std::getline(columns, name, '\t')) {
+            continue;
+        }
+
+        bool known = s_zoneIndex.count(name) > 0;
+        int zone = addZone(name, zoneinfoDir);
+        double latitude, longitude;
+        if (zone < 0 || known || !parseIso6709(coordinates, latitude, longitude)) continue;
+        s_anchors.push_back({latitude, longitude, zone});
+    }
+}
+
+int TimeZoneService::addZone(const std::string& name, const std::string& zoneinfoDir) {
+    auto it = s_zoneIndex.find(name);
+    if (it != s_zoneIndex.end()) return it->second;
+
+    Zone zone;
+    zone.name = name;
+    if (!loadZone(zoneinfoDir + "/" + name, zone)) {
+        return -1;
+    }
+
+    int index = static_cast<int>(s_zones.size());
+    s_zones.push_back(std::move(zone));
+    s_zoneIndex[name] = index;
+    return index;
+}
+
+// Формат TZif (RFC 8536): заголовок, данные v1 (32 бита), для v2+ - заголовок и данные
+// с 64-битными моментами и POSIX TZ в конце файла
+bool TimeZoneService::loadZone(const std::string& path, Zone& zone) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data.data());
+
+    const size_t headerSize = 44;
+    auto parseBlock = [&](size_t offset, int timeSize, size_t& end) -> bool {
+        if (data.size() < offset + headerSize || data.compare(offset, 4, "TZif") != 0) return false;
+        const unsigned char* h = bytes + offset + 20;
+        const int64_t isutcnt = readBigEndian(h, 4);
+        const int64_t isstdcnt = readBigEndian(h + 4, 4);
+        const int64_t leapcnt = readBigEndian(h + 8, 4);
+        const int64_t timecnt = readBigEndian(h + 12, 4);
+        const int64_t typecnt = readBigEndian(h + 16, 4);
+        const int64_t charcnt = readBigEndian(h + 20, 4);
+        if (timecnt < 0 || typecnt <= 0 || typecnt > 256) return false;
+
+        size_t p = offset + headerSize;
+        end = p + timecnt * timeSize + timecnt + typecnt * 6 + charcnt +
+              leapcnt * (timeSize + 4) + isstdcnt + isutcnt;
+        if (data.size() < end) return false;
+
+        std::vector<int32_t> typeOffsets(static_cast<size_t>(typecnt));
+        const size_t typesAt = p + timecnt * timeSize + timecnt;
+        for (int64_t i = 0; i < typecnt; ++i) {
+            typeOffsets[i] = static_cast<int32_t>(readBigEndian(bytes + typesAt + i * 6, 4));
+        }
+
+        zone.transitions.clear();
+        zone.offsets.clear();
+        zone.transitions.reserve(static_cast<size_t>(timecnt));
+        zone.offsets.reserve(static_cast<size_t>(timecnt));
+        for (int64_t i = 0; i < timecnt; ++i) {
+            unsigned type = bytes[p + timecnt * timeSize + i];
+            if (type >= typeOffsets.size()) return false;
+            zone.transitions.push_back(readBigEndian(bytes + p + i * timeSize, timeSize));
+            zone.offsets.push_back(typeOffsets[type]);
+        }
+        // До первого перехода действует тип 0
+        zone.initialOffset = typeOffsets[0];
+        return true;
+    };
+
+    size_t end = 0;
+    if (!parseBlock(0, 4, end)) return false;
+
+    const char version = data.size() > 4 ? data[4] : 0;
+    if (version >= '2') {
+        size_t end64 = 0;
+        if (!parseBlock(end, 8, end64)) return false;
+
+        // POSIX TZ между двумя переводами строки
+        if (end64 < data.size() && data[end64] == '\n') {
+            size_t close = data.find('\n', end64 + 1);
+            if (close != std::string::npos) {
+                parsePosixRule(data.substr(end64 + 1, close - end64 - 1), zone.rule);
+            }
+        }
+    }
+    return true;
+}
+
+// Разбор POSIX TZ: std offset [dst [offset] [,start[/time],end[/time]]]
+bool TimeZoneService::parsePosixRule(const std::string& text, PosixRule& rule) {
+    size_t pos = 0;
+
+    auto parseName = [&]() -> bool {
+        if (pos < text.size() && text[pos] == '<') {
+            size_t close = text.find('>', pos);
+            if (close == std::string::npos) return false;
+            pos = close + 1;
+            return true;
+        }
+        size_t start = pos;
+        while (pos < text.size() && std::isalpha(static_cast<unsigned char>(text[pos]))) ++pos;
+        return pos - start >= 3;
+    };
+
+    // [+-]hh[:mm[:ss]] в секундах
+    auto parseTime = [&](int32_t& out) -> bool {
+        int sign = 1;
+        if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+            sign = text[pos] == '-' ? -1 : 1;
+            ++pos;
+        }
+        int32_t parts[3] = {0, 0, 0};
+        for (int i = 0; i < 3; ++i) {
+            size_t start = pos;
+            while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) {
+                parts[i] = parts[i] * 10 + (text[pos] - '0');
+                ++pos;
+            }
+            if (pos == start) return i > 0;
+            if (pos >= text.size() || text[pos] != ':' || i == 2) break;
+            ++pos;
+        }
+        out = sign * (parts[0] * 3600 + parts[1] * 60 + parts[2]);
+        return true;
+    };
+
+    auto parseNumber = [&](int& out) -> bool {
+        size_t start = pos;
+        out = 0;
+        while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) {
+            out = out * 10 + (text[pos] - '0');
+            ++pos;
+        }
+        return pos > start;
+    };
+
+    auto parseDate = [&](RuleDate& date) -> bool {
+        if (pos < text.size() && text[pos] == 'M') {
+            ++pos;
+            date.kind = 'M';
+            if (!parseNumber(date.month) || pos >= text.size() || text[pos++] != '.') return false;
+            if (!parseNumber(date.week) || pos >= text.size() || text[pos++] != '.') return false;
+            if (!parseNumber(date.weekday)) return false;
+        } else if (pos < text.size() && text[pos] == 'J') {
+            ++pos;
+            date.kind = 'J';
+            if (!parseNumber(date.day)) return false;
+        } else {
+            date.kind = 'D';
+            if (!parseNumber(date.day)) return false;
+        }
+        date.time = 7200;
+        if (pos < text.size() && text[pos] == '/') {
+            ++pos;
+            if (!parseTime(date.time)) return false;
+        }
+        return true;
+    };
+
+    PosixRule parsed;
+    int32_t offset = 0;
+    if (!parseName() || !parseTime(offset)) return false;
+    // В POSIX смещение указывается к западу от UTC
+    parsed.stdOffset = -offset;
+    parsed.dstOffset = parsed.stdOffset;
+
+    if (pos < text.size()) {
+        if (!parseName()) return false;
+        parsed.hasDst = true;
+        parsed.dstOffset = parsed.stdOffset + 3600;
+        if (pos < text.size() && text[pos] != ',') {
+            if (!parseTime(offset)) return false;
+            parsed.dstOffset = -offset;
+        }
+        if (pos >= text.size() || text[pos++] != ',' || !parseDate(parsed.start) ||
+            pos >= text.size() || text[pos++] != ',' || !parseDate(parsed.end)) {
+            return false;
+        }
+    }
+
+    parsed.valid = true;
+    rule = parsed;
+    return true;
+}
+
+// День (от 1970-01-01) правила перехода в году year
+int TimeZoneService::ruleDay(const RuleDate& date, int year) {
+    const int jan1 = PrayerTimesCalculator::daysFromCivil(year, 1, 1);
+    if (date.kind == 'J') {
+        // J1..J365 без учета 29 февраля
+        const bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+        return jan1 + date.day - 1 + (leap && date.day >= 60 ? 1 : 0);
+    }
+    if (date.kind == 'D') {
+        return jan1 + date.day;
+    }
+
+    // Mm.w.d: день недели d (0 = воскресенье) недели w (5 = последняя) месяца m
+    const int first = PrayerTimesCalculator::daysFromCivil(year, date.month, 1);
+    const int next = date.month == 12 ? PrayerTimesCalculator::daysFromCivil(year + 1, 1, 1)
+                                      : PrayerTimesCalculator::daysFromCivil(year, date.month + 1, 1);
+    const int firstWeekday = ((first % 7) + 7 + 4) % 7;  // 1970-01-01 - четверг
+    int day = first + (date.weekday - firstWeekday + 7) % 7 + (date.week - 1) * 7;
+    while (day >= next) day -= 7;
+    return day;
+}
+
+int32_t TimeZoneService::ruleOffsetAt(const PosixRule& rule, int64_t utcSeconds) {
+    if (!rule.hasDst) return rule.stdOffset;
+
+    int year, month, day;
+    PrayerTimesCalculator::civilFromDays(static_cast<int>(floorDays(utcSeconds + rule.stdOffset)), year, month, day);
+
+    // Начало летнего времени задано в стандартном местном времени, конец - в летнем
+    const int64_t start = int64_t(ruleDay(rule.start, year)) * SECONDS_PER_DAY + rule.start.time - rule.stdOffset;
+    const int64_t end = int64_t(ruleDay(rule.end, year)) * SECONDS_PER_DAY + rule.end.time - rule.dstOffset;
+
+    bool dst = start < end ? (utcSeconds >= start && utcSeconds < end)
+                           : (utcSeconds >= start || utcSeconds < end);  // Южное полушарие
+    return dst ? rule.dstOffset : rule.stdOffset;
+}
+
+int32_t TimeZoneService::offsetAt(int zoneIndex, int64_t utcSeconds) {
+    const Zone& zone = s_zones[zoneIndex];
+    if (zone.transitions.empty() || utcSeconds < zone.transitions.front()) {
+        if (zone.transitions.empty() && zone.rule.valid) return ruleOffsetAt(zone.rule, utcSeconds);
+        return zone.initialOffset;
+    }
+    if (utcSeconds >= zone.transitions.back() && zone.rule.valid) {
+        return ruleOffsetAt(zone.rule, utcSeconds);
+    }
+    auto it = std::upper_bound(zone.transitions.begin(), zone.transitions.end(), utcSeconds);
+    return zone.offsets[static_cast<size_t>(it - zone.transitions.begin()) - 1];
+}
+
+// Кеш (зона, день) -> смещение: одно 64-битное слово на запись, без блокировок.
+// Биты: 63 - запись занята, 50..62 - зона, 18..49 - день целиком (int32), 0..17 - смещение
+// (+2^17). Зона и день хранятся полностью, иначе далекие дни делили бы одну запись.
+// Зоны и смещения, не помещающиеся в поля, считаются без кеша
+int32_t TimeZoneService::offsetForDay(int zone, int days) {
+    // Местный полдень: сначала по смещению в полдень UTC, затем уточняем
+    auto compute = [zone, days]() {
+        const int64_t noon = int64_t(days) * SECONDS_PER_DAY + SECONDS_PER_DAY / 2;
+        return offsetAt(zone, noon - offsetAt(zone, noon));
+    };
+    if (zone < 0 || zone >= (1 << 13)) return compute();
+
+    const uint64_t zoneBits = static_cast<uint64_t>(zone);
+    const uint64_t dayBits = static_cast<uint32_t>(days);
+    const uint64_t key = (uint64_t(1) << 63) | (zoneBits << 50) | (dayBits << 18);
+    const size_t slot = static_cast<size_t>(((zoneBits * 0x9E3779B1u) ^ dayBits) * 0x85EBCA6Bu) & (CACHE_SIZE - 1);
+
+    const uint64_t entry = s_cache[slot].load(std::memory_order_relaxed);
+    if ((entry & ~uint64_t(0x3FFFF)) == key) {
+        return static_cast<int32_t>(entry & 0x3FFFF) - (1 << 17);
+    }
+
+    const int32_t offset = compute();
+    if (offset > -(1 << 17) && offset < (1 << 17)) {
+        s_cache[slot].store(key | static_cast<uint64_t>(offset + (1 << 17)), std::memory_order_relaxed);
+    }
+    return offset;
+}
+
+void TimeZoneService::buildGrid() {
+    const size_t cellCount = static_cast<size_t>(GRID_ROWS) * GRID_COLS;
+    auto cellOf = [](double latitude, double longitude) {
+        int row = std::clamp(static_cast<int>((latitude + 90.0) / GRID_DEGREES), 0, GRID_ROWS - 1);
+        int col = std::clamp(static_cast<int>((longitude + 180.0) / GRID_DEGREES), 0, GRID_COLS - 1);
+        return static_cast<size_t>(row) * GRID_COLS + col;
+    };
+
+    // Компактная раскладка: начала ячеек + общий массив индексов опорных точек
+    s_cellStart.assign(cellCount + 1, 0);
+    for (const Anchor& anchor : s_anchors) {
+        ++s_cellStart[cellOf(anchor.latitude, anchor.longitude) + 1];
+    }
+    for (size_t i = 0; i < cellCount; ++i) {
+        s_cellStart[i + 1] += s_cellStart[i];
+    }
+    s_cellAnchors.assign(s_anchors.size(), 0);
+    std::vector<uint32_t> fill(s_cellStart.begin(), s_cellStart.end() - 1);
+    for (size_t i = 0; i < s_anchors.size(); ++i) {
+        s_cellAnchors[fill[cellOf(s_anchors[i].latitude, s_anchors[i].longitude)]++] = static_cast<uint32_t>(i);
+    }
+}
+
+int TimeZoneService::zoneForLocation(double latitude, double longitude) {
+    if (s_anchors.empty()) return -1;
+
+    latitude = std::clamp(latitude, -90.0, 90.0);
+    longitude = longitude - 360.0 * std::floor((longitude + 180.0) / 360.0);
+    const int row = std::clamp(static_cast<int>((latitude + 90.0) / GRID_DEGREES), 0, GRID_ROWS - 1);
+    const int col = std::clamp(static_cast<int>((longitude + 180.0) / GRID_DEGREES), 0, GRID_COLS - 1);
+
+    // Обход колец ячеек вокруг точки; после первой найденной точки проверяем еще одно кольцо
+    // шире (ячейки у полюсов уже по долготе)
+    int best = -1;
+    double bestDistance = 0.0;
+    int lastRing = GRID_COLS / 2;
+    for (int ring = 0; ring <= lastRing; ++ring) {
+        for (int r = row - ring; r <= row + ring; ++r) {
+            if (r < 0 || r >= GRID_ROWS) continue;
+            const bool edgeRow = (r == row - ring || r == row + ring);
+            for (int c = col - ring; c <= col + ring; c += (edgeRow || ring == 0) ? 1 : 2 * ring) {
+                const int wrapped = ((c % GRID_COLS) + GRID_COLS) % GRID_COLS;
+                const size_t cell = static_cast<size_t>(r) * GRID_COLS + wrapped;
+                for (uint32_t i = s_cellStart[cell]; i < s_cellStart[cell + 1]; ++i) {
+                    const Anchor& anchor = s_anchors[s_cellAnchors[i]];
+                    double distance = distanceKm(latitude, longitude, anchor.latitude, anchor.longitude);
+                    if (best < 0 || distance < bestDistance) {
+                        best = anchor.zone;
+                        bestDistance = distance;
+                    }
+                }
+            }
+        }
+        if (best >= 0 && lastRing == GRID_COLS / 2) {
+            lastRing = std::min(lastRing, ring * 2 + 1);
+        }
+    }
+
+    // Открытое море: ближайшая опорная точка слишком далеко - морской пояс по долготе
+    const double maxAnchorDistanceKm = 2000.0;
+    if (best >= 0 && bestDistance > maxAnchorDistanceKm) {
+        int hours = static_cast<int>(std::lround(longitude / 15.0));
+        std::string name = hours == 0 ? "Etc/GMT"
+                                      : "Etc/GMT" + std::string(hours > 0 ? "-" : "+") + std::to_string(std::abs(hours));
+        int nautical = findZone(name);
+        if (nautical >= 0) return nautical;
+    }
+    return best;
+}
+
+int TimeZoneService::findZone(const std::string& name) {
+    auto it = s_zoneIndex.find(name);
+    return it != s_zoneIndex.end() ? it->second : -1;
+}
+
+TimeZoneService::TimeZone TimeZoneService::resolve(const std::string& tzParam, double latitude, double longitude) {
+    TimeZone timeZone;
+
+    if (!tzParam.empty()) {
+        // Число часов от UTC (старый формат параметра tz)
+        try {
+            size_t used = 0;
+            double hours = std::stod(tzParam, &used);
+            if (used == tzParam.size() && hours >= -14.0 && hours <= 14.0) {
+                timeZone.fixedHours = hours;
+                return timeZone;
+            }
+        } catch (const std::exception& e) {}
+
+        timeZone.zone = findZone(tzParam);
+        if (timeZone.zone >= 0) return timeZone;
+        LOG_INFO("TimeZone") << "⚠️ Неизвестный часовой пояс \"" << tzParam << "\", определяется по координатам";
+    }
+
+    timeZone.zone = zoneForLocation(latitude, longitude);
+    if (timeZone.zone < 0) {
+        timeZone.fixedHours = PrayerTimesCalculator::systemTimezoneOffset();
+    }
+    return timeZone;
+}
+
+std::string TimeZoneService::name(const TimeZone& timeZone) {
+    if (timeZone.zone >= 0) return s_zones[timeZone.zone].name;
+
+    // Фиксированное смещение: "UTC+03:00"
+    int minutes = static_cast<int>(std::lround(std::abs(timeZone.fixedHours) * 60.0));
+    std::ostringstream out;
+    out << "UTC" << (timeZone.fixedHours < 0 ? "-" : "+")
+        << (minutes / 60 < 10 ? "0" : "") << minutes / 60 << ":"
+        << (minutes % 60 < 10 ? "0" : "") << minutes % 60;
+    return out.str();
+}
+
+double TimeZoneService::offsetHours(const TimeZone& timeZone, int days) {
+    if (timeZone.zone < 0) return timeZone.fixedHours;
+    return offsetForDay(timeZone.zone, days) / 3600.0;
+}
+
+double TimeZoneService::offsetHoursAt(const TimeZone& timeZone, int64_t utcSeconds) {
+    if (timeZone.zone < 0) return timeZone.fixedHours;
+    return offsetAt(timeZone.zone, utcSeconds) / 3600.0;
+}
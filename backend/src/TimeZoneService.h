@@ -0,0 +1,106 @@
+#ifndef TIMEZONESERVICE_H
+#define TIMEZONESERVICE_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <cstdint>
+
+// Часовые пояса IANA без обращения к libc на пути запроса.
+// При старте загружаются все зоны из zone1970.tab/zone.tab базы tzdata (TZif-файлы:
+// таблица переходов + POSIX-правило для дат после последнего перехода) и строится
+// сеточный индекс опорных точек зон (координаты из zone.tab плюс крупные города там, где
+// их мало). Координаты сопоставляются зоне по ближайшей опорной точке (полигонов границ
+// в tzdata нет); вдали от суши - морской пояс Etc/GMT±N по долготе.
+// Смещения кешируются по (зона, день) в lock-free таблице; после initialize() все
+// данные только читаются, поэтому методы можно вызывать из любых потоков.
+class TimeZoneService {
+public:
+    // Часовой пояс запроса: зона IANA или фиксированное смещение
+    struct TimeZone {
+        int zone = -1;             // Индекс зоны, -1 - фиксированное смещение
+        double fixedHours = 0.0;   // Смещение от UTC в часах, если zone == -1
+    };
+
+    // Загрузить базу часовых поясов (например, /usr/share/zoneinfo); false, если ее нет
+    static bool initialize(const std::string& zoneinfoDir);
+    static bool isAvailable() { return !s_zones.empty(); }
+
+    // Параметр tz ("Europe/Moscow" или число часов); пустой или неизвестный - по координатам.
+    // Без базы часовых поясов - часовой пояс сервера, как раньше
+    static TimeZone resolve(const std::string& tzParam, double latitude, double longitude);
+
+    static int findZone(const std::string& name);                // -1, если зоны нет
+    static int zoneForLocation(double latitude, double longitude); // -1 без базы
+    static std::string name(const TimeZone& timeZone);
+    // Версия базы tzdata ("2025b") из tzdata.zi или +VERSION; "none" без базы, "unknown" -
+    // база есть, но версия не указана
+    static const std::string& dataVersion() { return s_dataVersion; }
+
+    // Смещение от UTC (часы) для местной даты days (дни от 1970-01-01), в местный полдень
+    static double offsetHours(const TimeZone& timeZone, int days);
+    // Смещение от UTC (часы) в момент utcSeconds
+    static double offsetHoursAt(const TimeZone& timeZone, int64_t utcSeconds);
+
+private:
+    // Правило перехода из POSIX TZ: Mm.w.d, Jn или n, время в секундах местного времени
+    struct RuleDate {
+        char kind = 'M';           // 'M', 'J' или 'D' (день года с нуля)
+        int month = 0;
+        int week = 0;
+        int weekday = 0;
+        int day = 0;
+        int32_t time = 7200;
+    };
+
+    // POSIX TZ из окончания TZif, например "CET-1CEST,M3.5.0,M10.5.0/3"
+    struct PosixRule {
+        bool valid = false;
+        bool hasDst = false;
+        int32_t stdOffset = 0;     // Секунды к востоку от UTC
+        int32_t dstOffset = 0;
+        RuleDate start;
+        RuleDate end;
+    };
+
+    struct Zone {
+        std::string name;
+        std::vector<int64_t> transitions;  // Моменты переходов (UTC, секунды)
+        std::vector<int32_t> offsets;      // Смещение после каждого перехода
+        int32_t initialOffset = 0;         // До первого перехода
+        PosixRule rule;
+    };
+
+    struct Anchor {
+        double latitude;
+        double longitude;
+        int zone;
+    };
+
+    static bool loadZone(const std::string& path, Zone& zone);
+    static bool parsePosixRule(const std::string& text, PosixRule& rule);
+    static int32_t ruleOffsetAt(const PosixRule& rule, int64_t utcSeconds);
+    static int ruleDay(const RuleDate& date, int year);
+    static int32_t offsetAt(int zone, int64_t utcSeconds);
+    static int32_t offsetForDay(int zone, int days);
+    static void loadZoneTab(const std::string& path, const std::string& zoneinfoDir);
+    static int addZone(const std::string& name, const std::string& zoneinfoDir);
+    static void buildGrid();
+    static std::string readDataVersion(const std::string& zoneinfoDir);
+
+    static constexpr int GRID_DEGREES = 2;
+    static constexpr int GRID_ROWS = 180 / GRID_DEGREES;
+    static constexpr int GRID_COLS = 360 / GRID_DEGREES;
+    static constexpr size_t CACHE_SIZE = 4096;  // Степень двойки
+
+    static std::vector<Zone> s_zones;
+    static std::unordered_map<std::string, int> s_zoneIndex;
+    static std::vector<Anchor> s_anchors;
+    static std::vector<uint32_t> s_cellStart;    // GRID_ROWS * GRID_COLS + 1
+    static std::vector<uint32_t> s_cellAnchors;
+    static std::atomic<uint64_t> s_cache[CACHE_SIZE];
+    static std::string s_dataVersion;
+};
+
+#endif // TIMEZONESERVICE_H
@@ -0,0 +1,163 @@
+#include "UpstreamExecutor.h"
+#include "Logger.h"
+
+std::mutex UpstreamExecutor::s_mutex;
+std::condition_variable UpstreamExecutor::s_cv;
+std::deque<UpstreamExecutor::Job> UpstreamExecutor::s_queue;
+std::map<std::string, UpstreamExecutor::Host> UpstreamExecutor::s_hosts;
+std::vector<std::thread> UpstreamExecutor::s_workers;
+bool UpstreamExecutor::s_running = false;
+
+UpstreamPool::Response UpstreamExecutor::failure(const std::string& error) {
+    UpstreamPool::Response response;
+    response.error = error;
+    return response;
+}
+
+void UpstreamExecutor::start(size_t threads) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (s_running) return;
+    s_running = true;
+    if (threads == 0) threads = 1;
+    for (size_t i = 0; i < threads; ++i) {
+        s_workers.emplace_back(&UpstreamExecutor::workerLoop);
+    }
+    LOG_INFO("Upstream") << "🧵 Исполнитель запросов: потоков " << threads;
+}
+
+void UpstreamExecutor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_running = false;
+    }
+    s_cv.notify_all();
+    for (auto& worker : s_workers) {
+        if (worker.joinable()) worker.join();
+    }
+    s_workers.clear();
+
+    // Оставшиеся задачи завершаются отказом, чтобы ожидающие не ждали до дедлайна
+    std::deque<Job> pending;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        pending.swap(s_queue);
+        for (auto& entry : s_hosts) entry.second.queued = 0;
+    }
+    for (Job& job : pending) {
+        job.promise.set_value(failure("исполнитель остановлен"));
+    }
+}
+
+void UpstreamExecutor::limitHost(const std::string& host, size_t maxInFlight, size_t maxQueued) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    Host& limits = s_hosts[host];
+    limits.maxInFlight = maxInFlight > 0 ? maxInFlight : 1;
+    limits.maxQueued = maxQueued;
+}
+
+std::future<UpstreamPool::Response> UpstreamExecutor::submit(const std::string& host, Clock::time_point deadline, Task task) {
+    std::promise<UpstreamPool::Response> promise;
+    std::future<UpstreamPool::Response> future = promise.get_future();
+
+    {
+        std::unique_lock<std::mutex> lock(s_mutex);
+        if (s_running) {
+            Host& limits = s_hosts[host];
+            if (limits.queued >= limits.maxQueued) {
+                ++limits.rejected;
+                lock.unlock();
+                LOG_WARN("Upstream") << "⚠️ " << host << ": очередь запросов переполнена";
+                promise.set_value(failure("очередь запросов переполнена"));
+                return future;
+            }
+            ++limits.queued;
+            s_queue.push_back({host, deadline, std::move(task), std::move(promise)});
+            lock.unlock();
+            s_cv.notify_all();
+            return future;
+        }
+    }
+
+    // Пул не запущен - выполняем сразу в вызывающем потоке
+    try {
+        promise.set_value(task(deadline));
+    } catch (const std::exception& e) {
+        promise.set_value(failure(e.what()));
+    }
+    return future;
+}
+
+UpstreamPool::Response UpstreamExecutor::run(const std::string& host, Clock::time_point deadline, Task task) {
+    std::future<UpstreamPool::Response> future = submit(host, deadline, std::move(task));
+    if (future.wait_until(deadline) != std::future_status::ready) {
+        // Задача продолжит выполняться и завершится по своему таймауту, результат никому не нужен
+        return failure("дедлайн запроса истек");
+    }
+    return future.get();
+}
+
+UpstreamPool::Response UpstreamExecutor::get(const std::string& host, const std::string& path,
+                                             const UpstreamPool::Headers& headers, Clock::time_point deadline) {
+    return run(host, deadline, [host, path, headers](Clock::time_point taskDeadline) {
+        return UpstreamPool::get(host, path, headers, taskDeadline);
+    });
+}
+
+UpstreamExecutor::HostStats UpstreamExecutor::stats(const std::string& host) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto it = s_hosts.find(host);
+    if (it == s_hosts.end()) return HostStats{0, 0, 0, 0, 0};
+    const Host& limits = it->second;
+    return HostStats{limits.inFlight, limits.queued, limits.completed, limits.expired, limits.rejected};
+}
+
+void UpstreamExecutor::workerLoop() {
+    std::unique_lock<std::mutex> lock(s_mutex);
+    while (true) {
+        if (!s_running) return;
+
+        // Первая задача, хост которой не исчерпал лимит, или задача с истекшим дедлайном
+        const auto now = Clock::now();
+        auto it = s_queue.begin();
+        for (; it != s_queue.end(); ++it) {
+            if (it->deadline <= now) break;
+            const Host& limits = s_hosts[it->host];
+            if (limits.inFlight < limits.maxInFlight) break;
+        }
+        if (it == s_queue.end()) {
+            // Нечего выполнять: ждем новую задачу или освобождения хоста; периодическое
+            // пробуждение убирает из очереди задачи, чей дедлайн истек
+            s_cv.wait_for(lock, std::chrono::milliseconds(100));
+            continue;
+        }
+
+        Job job = std::move(*it);
+        s_queue.erase(it);
+        Host& limits = s_hosts[job.host];
+        --limits.queued;
+
+        if (job.deadline <= now) {
+            ++limits.expired;
+            lock.unlock();
+            job.promise.set_value(failure("дедлайн истек в очереди"));
+            lock.lock();
+            continue;
+        }
+
+        ++limits.inFlight;
+        lock.unlock();
+
+        UpstreamPool::Response response;
+        try {
+            response = job.task(job.deadline);
+        } catch (const std::exception& e) {
+            response = failure(e.what());
+        }
+        job.promise.set_value(std::move(response));
+
+        lock.lock();
+        --s_hosts[job.host].inFlight;
+        ++s_hosts[job.host].completed;
+        s_cv.notify_all();
+    }
+}
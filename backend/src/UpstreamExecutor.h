@@ -0,0 +1,85 @@
+#ifndef UPSTREAMEXECUTOR_H
+#define UPSTREAMEXECUTOR_H
+
+#include "UpstreamPool.h"
+#include <string>
+#include <deque>
+#include <map>
+#include <vector>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+
+// Исполнитель запросов к внешним API.
+// Запросы выполняются небольшим пулом потоков, а не потоками httplib: обработчик ставит
+// задачу в очередь и ждет future не дольше своего дедлайна, поэтому медленный внешний API
+// не занимает потоки, обслуживающие статику и авторизацию. Для каждого хоста ограничены
+// число одновременных запросов и длина очереди (сверх нее - немедленный отказ).
+// Дедлайн входящего запроса передается задаче и дальше в UpstreamPool::get; задача,
+// дедлайн которой истек в очереди, не выполняется.
+class UpstreamExecutor {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Task = std::function<UpstreamPool::Response(Clock::time_point deadline)>;
+
+    struct HostStats {
+        size_t inFlight;
+        size_t queued;
+        uint64_t completed;
+        uint64_t expired;      // Дедлайн истек в очереди
+        uint64_t rejected;     // Очередь хоста переполнена
+    };
+
+    // Пул из threads потоков; stop() - до выхода из main(). Без start() задачи выполняются
+    // в вызывающем потоке (утилиты и тесты)
+    static void start(size_t threads);
+    static void stop();
+
+    // Одновременных запросов к хосту и задач в его очереди (вызывать до start())
+    static void limitHost(const std::string& host, size_t maxInFlight, size_t maxQueued);
+
+    static std::future<UpstreamPool::Response> submit(const std::string& host, Clock::time_point deadline, Task task);
+
+    // Поставить задачу и ждать результата до дедлайна
+    static UpstreamPool::Response run(const std::string& host, Clock::time_point deadline, Task task);
+
+    // GET через пул соединений с ожиданием до дедлайна
+    static UpstreamPool::Response get(const std::string& host, const std::string& path,
+                                      const UpstreamPool::Headers& headers, Clock::time_point deadline);
+
+    static HostStats stats(const std::string& host);
+
+private:
+    struct Job {
+        std::string host;
+        Clock::time_point deadline;
+        Task task;
+        std::promise<UpstreamPool::Response> promise;
+    };
+
+    struct Host {
+        size_t maxInFlight = 4;
+        size_t maxQueued = 32;
+        size_t inFlight = 0;
+        size_t queued = 0;
+        uint64_t completed = 0;
+        uint64_t expired = 0;
+        uint64_t rejected = 0;
+    };
+
+    static void workerLoop();
+    static UpstreamPool::Response failure(const std::string& error);
+
+    static std::mutex s_mutex;
+    static std::condition_variable s_cv;
+    static std::deque<Job> s_queue;
+    static std::map<std::string, Host> s_hosts;
+    static std::vector<std::thread> s_workers;
+    static bool s_running;
+};
+
+#endif // UPSTREAMEXECUTOR_H
@@ -0,0 +1,475 @@
+#define CPPHTTPLIB_OPENSSL_SUPPORT
+#define CPPHTTPLIB_USE_CERTS_FROM_MACOSX_KEYCHAIN
+#include "UpstreamPool.h"
+#include "Logger.h"
+#include <httplib.h>
+#include <chrono>
+#include <algorithm>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+using Clock = std::chrono::steady_clock;
+
+struct UpstreamPool::Connection {
+    std::unique_ptr<httplib::SSLClient> client;
+    Clock::time_point lastUsed;   // Последний запрос (проверки не продлевают)
+    uint64_t requests = 0;
+};
+
+struct UpstreamPool::Host {
+    std::string name;
+    Options options;
+    std::mutex mutex;
+    std::condition_variable available;
+    std::vector<std::unique_ptr<Connection>> idle;   // В конце - недавно использованные
+    size_t leased = 0;
+    std::string address;
+    Clock::time_point addressExpires;
+    bool healthy = true;
+    Clock::time_point lastDemand;   // Последний вызов get(); проверки не продлевают
+
+    // Автомат защиты: кольцо исходов последних вызовов (1 - ошибка)
+    BreakerState breaker = BreakerState::Closed;
+    std::vector<uint8_t> outcomes;
+    size_t nextOutcome = 0;
+    size_t outcomeCount = 0;
+    size_t outcomeFailures = 0;
+    Clock::time_point openedAt;
+    bool trialInFlight = false;
+    uint64_t trips = 0;
+    uint64_t rejected = 0;
+    uint64_t saturated = 0;
+
+    uint64_t created = 0;
+    uint64_t reused = 0;
+    uint64_t failures = 0;
+};
+
+std::mutex UpstreamPool::s_mutex;
+std::map<std::string, std::unique_ptr<UpstreamPool::Host>> UpstreamPool::s_hosts;
+std::mutex UpstreamPool::s_healthMutex;
+std::condition_variable UpstreamPool::s_healthWake;
+std::thread UpstreamPool::s_healthThread;
+bool UpstreamPool::s_healthRunning = false;
+
+void UpstreamPool::configure(const std::string& name, const Options& options) {
+    Host& host = hostFor(name);
+    std::lock_guard<std::mutex> lock(host.mutex);
+    host.options = options;
+    if (host.options.maxConnections == 0) host.options.maxConnections = 1;
+    if (host.options.breakerWindow == 0) host.options.breakerWindow = 1;
+    host.outcomes.assign(host.options.breakerWindow, 0);
+    host.nextOutcome = host.outcomeCount = host.outcomeFailures = 0;
+}
+
+// Хосты не удаляются, поэтому ссылка остается действительной до конца работы
+UpstreamPool::Host& UpstreamPool::hostFor(const std::string& name) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto& host = s_hosts[name];
+    if (!host) {
+        host = std::make_unique<Host>();
+        host->name = name;
+        host->outcomes.assign(host->options.breakerWindow, 0);
+    }
+    return *host;
+}
+
+std::string UpstreamPool::resolveAddress(const std::string& name) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* result = nullptr;
+    if (getaddrinfo(name.c_str(), "443", &hints, &result) != 0 || !result) return "";
+
+    char buffer[INET6_ADDRSTRLEN] = {0};
+    const void* address = nullptr;
+    if (result->ai_family == AF_INET) {
+        address = &reinterpret_cast<sockaddr_in*>(result->ai_addr)->sin_addr;
+    } else if (result->ai_family == AF_INET6) {
+        address = &reinterpret_cast<sockaddr_in6*>(result->ai_addr)->sin6_addr;
+    }
+    std::string text;
+    if (address && inet_ntop(result->ai_family, address, buffer, sizeof(buffer))) text = buffer;
+    freeaddrinfo(result);
+    return text;
+}
+
+// Адрес из кеша; по истечении TTL (или refresh) - новый резолв вне блокировки хоста.
+// Если резолв не удался, остается старый адрес (пустой - httplib резолвит сам)
+std::string UpstreamPool::cachedAddress(Host& host, bool refresh) {
+    int ttl;
+    {
+        std::lock_guard<std::mutex> lock(host.mutex);
+        if (!refresh && Clock::now() < host.addressExpires) return host.address;
+        ttl = host.options.dnsTtlSeconds;
+    }
+
+    std::string resolved = resolveAddress(host.name);
+
+    std::lock_guard<std::mutex> lock(host.mutex);
+    if (!resolved.empty()) {
+        if (resolved != host.address) {
+            LOG_INFO("Upstream") << "🔌 " << host.name << " -> " << resolved << " (TTL " << ttl << " с)";
+        }
+        host.address = resolved;
+        host.addressExpires = Clock::now() + std::chrono::seconds(ttl);
+    } else {
+        LOG_WARN("Upstream") << "⚠️ Не удалось разрешить " << host.name << ", используется прежний адрес";
+        host.addressExpires = Clock::now() + std::chrono::seconds(std::min(ttl, 30));
+    }
+    return host.address;
+}
+
+std::unique_ptr<UpstreamPool::Connection> UpstreamPool::connect(Host& host) {
+    const std::string address = cachedAddress(host, false);
+    Options options;
+    {
+        std::lock_guard<std::mutex> lock(host.mutex);
+        options = host.options;
+    }
+
+    auto connection = std::make_unique<Connection>();
+    connection->client = std::make_unique<httplib::SSLClient>(host.name, 443);
+    connection->client->set_keep_alive(true);
+    connection->client->set_follow_location(true);
+    connection->client->set_connection_timeout(options.connectTimeoutSeconds);
+    connection->client->set_read_timeout(options.readTimeoutSeconds);
+    if (!address.empty()) {
+        connection->client->set_hostname_addr_map({{host.name, address}});
+    }
+    connection->lastUsed = Clock::now();
+    return connection;
+}
+
+// Свободное соединение, новое (если лимит не достигнут) или ожидание освобождения
+// до deadline; nullptr - пул занят
+std::unique_ptr<UpstreamPool::Connection> UpstreamPool::acquire(Host& host, Clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(host.mutex);
+
+    while (true) {
+        if (!host.idle.empty()) {
+            auto connection = std::move(host.idle.back());
+            host.idle.pop_back();
+            ++host.leased;
+            ++host.reused;
+            return connection;
+        }
+        if (host.leased + host.idle.size() < host.options.maxConnections) {
+            ++host.leased;
+            ++host.created;
+            lock.unlock();
+            try {
+                return connect(host);
+            } catch (const std::exception& e) {
+                LOG_ERROR("Upstream") << "❌ Не удалось создать клиент " << host.name << ": " << e.what();
+                release(host, nullptr, false);
+                return nullptr;
+            }
+        }
+        if (host.available.wait_until(lock, deadline) == std::cv_status::timeout) {
+            return nullptr;
+        }
+    }
+}
+
+void UpstreamPool::release(Host& host, std::unique_ptr<Connection> connection, bool reusable) {
+    std::unique_ptr<Connection> closed;
+    {
+        std::lock_guard<std::mutex> lock(host.mutex);
+        --host.leased;
+        if (reusable && connection) {
+            host.idle.push_back(std::move(connection));
+        } else {
+            closed = std::move(connection);
+        }
+    }
+    host.available.notify_one();
+    // closed закрывает сокет уже без блокировки
+}
+
+// Пропустить ли запрос через автомат (под блокировкой хоста)
+bool UpstreamPool::admit(Host& host) {
+    switch (host.breaker) {
+    case BreakerState::Closed:
+        return true;
+    case BreakerState::Open:
+        if (Clock::now() - host.openedAt < std::chrono::seconds(host.options.breakerOpenSeconds)) return false;
+        host.breaker = BreakerState::HalfOpen;
+        host.trialInFlight = false;
+        LOG_INFO("Upstream") << "🟡 " << host.name << ": пробный запрос (half-open)";
+        [[fallthrough]];
+    case BreakerState::HalfOpen:
+        // Пока идет пробный запрос, остальные получают отказ
+        if (host.trialInFlight) return false;
+        host.trialInFlight = true;
+        return true;
+    }
+    return false;
+}
+
+// Исход вызова для автомата (под блокировкой хоста)
+void UpstreamPool::recordOutcome(Host& host, bool success) {
+    auto open = [&host](const char* reason) {
+        host.breaker = BreakerState::Open;
+        host.openedAt = Clock::now();
+        ++host.trips;
+        LOG_WARN("Upstream") << "🔴 " << host.name << ": цепь разомкнута на "
+                             << host.options.breakerOpenSeconds << " с (" << reason << ")";
+    };
+
+    if (host.breaker == BreakerState::HalfOpen) {
+        host.trialInFlight = false;
+        if (success) {
+            host.breaker = BreakerState::Closed;
+            std::fill(host.outcomes.begin(), host.outcomes.end(), 0);
+            host.nextOutcome = host.outcomeCount = host.outcomeFailures = 0;
+            LOG_INFO("Upstream") << "🟢 " << host.name << ": цепь замкнута";
+        } else {
+            open("пробный запрос не удался");
+        }
+        return;
+    }
+    if (host.breaker == BreakerState::Open) return;  // Запрос был пропущен до размыкания
+
+    uint8_t& slot = host.outcomes[host.nextOutcome];
+    if (host.outcomeCount == host.outcomes.size()) {
+        host.outcomeFailures -= slot;
+    } else {
+        ++host.outcomeCount;
+    }
+    slot = success ? 0 : 1;
+    host.outcomeFailures += slot;
+    host.nextOutcome = (host.nextOutcome + 1) % host.outcomes.size();
+
+    if (host.outcomeCount >= host.options.breakerMinCalls &&
+        host.outcomeFailures >= host.options.breakerErrorRate * host.outcomeCount) {
+        open("доля ошибок превысила порог");
+    }
+}
+
+UpstreamPool::Response UpstreamPool::get(const std::string& name, const std::string& path, const Headers& headers,
+                                         Clock::time_point callerDeadline) {
+    Host& host = hostFor(name);
+    httplib::Headers requestHeaders(headers.begin(), headers.end());
+    Response response;
+
+    Options options;
+    {
+        std::lock_guard<std::mutex> lock(host.mutex);
+        host.lastDemand = Clock::now();
+        if (!admit(host)) {
+            ++host.rejected;
+            response.error = "цепь разомкнута";
+            response.circuitOpen = true;
+            return response;
+        }
+        options = host.options;
+    }
+
+    const auto started = Clock::now();
+    const auto deadline = std::min(started + std::chrono::milliseconds(options.budgetMs), callerDeadline);
+    bool answered = false;
+    bool sent = false;  // Хотя бы одна попытка дошла до запроса к хосту
+
+    // Повтор только для соединения из пула: сервер мог закрыть его между запросами
+    for (int attempt = 0; attempt < 2 && !answered; ++attempt) {
+        auto connection = acquire(host, deadline);
+        if (!connection) {
+            response.error = "нет свободного соединения в пределах бюджета";
+            LOG_WARN("Upstream") << "⚠️ " << name << ": " << response.error;
+            break;
+        }
+
+        // Таймауты соединения - не больше остатка бюджета
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        if (remaining <= 0) {
+            response.error = "бюджет времени исчерпан";
+            release(host, std::move(connection), true);
+            break;
+        }
+        const long long connectMs = std::min<long long>(remaining, options.connectTimeoutSeconds * 1000LL);
+        const long long readMs = std::min<long long>(remaining, options.readTimeoutSeconds * 1000LL);
+        connection->client->set_connection_timeout(connectMs / 1000, (connectMs % 1000) * 1000);
+        connection->client->set_read_timeout(readMs / 1000, (readMs % 1000) * 1000);
+
+        const bool wasReused = connection->requests > 0;
+        sent = true;
+        try {
+            auto result = connection->client->Get(path, requestHeaders);
+            if (result) {
+                response.status = result->status;
+                response.body = std::move(result->body);
+                response.error.clear();
+                const bool keepAlive = result->get_header_value("Connection") != "close";
+                connection->requests++;
+                connection->lastUsed = Clock::now();
+                release(host, std::move(connection), keepAlive);
+                answered = true;
+                break;
+            }
+            response.error = httplib::to_string(result.error());
+        } catch (const std::exception& e) {
+            response.error = e.what();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(host.mutex);
+            ++host.failures;
+        }
+        release(host, std::move(connection), false);
+        if (!wasReused) break;
+    }
+
+    // Для автомата ошибка - нет ответа, 5xx, 429 или слишком медленный ответ
+    const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - started).count();
+    const bool success = answered && response.status < 500 && response.status != 429 &&
+                         elapsedMs <= options.slowCallMs;
+
+    std::lock_guard<std::mutex> lock(host.mutex);
+    // Кончилось время вызывающего, а не бюджет хоста: о самом хосте это ничего не говорит
+    const bool callerExpired = !answered && callerDeadline < started + std::chrono::milliseconds(options.budgetMs) &&
+                               Clock::now() >= callerDeadline;
+    // Пул занят нашими же запросами: это перегрузка у нас, хост не получил ни одного запроса
+    const bool saturated = !sent;
+    if (callerExpired || saturated) {
+        if (host.breaker == BreakerState::HalfOpen) host.trialInFlight = false;
+    } else {
+        recordOutcome(host, success);
+    }
+    if (saturated) {
+        ++host.saturated;
+        return response;
+    }
+    if (answered) {
+        if (!host.healthy) LOG_INFO("Upstream") << "✅ " << name << " снова доступен";
+        host.healthy = true;
+    } else {
+        if (host.healthy) LOG_ERROR("Upstream") << "❌ " << name << " недоступен: " << response.error;
+        host.healthy = false;
+    }
+    return response;
+}
+
+// Закрыть простаивающие соединения, обновить DNS до истечения TTL и проверить хост
+// запросом HEAD / по одному соединению (для недоступного хоста - по новому). Проверка -
+// только для хостов с probe и недавними запросами: без нагрузки недоступный хост иначе
+// получал бы новое TLS-соединение каждые 15 с бесконечно
+void UpstreamPool::checkHost(Host& host) {
+    std::vector<std::unique_ptr<Connection>> expired;
+    bool refreshDns;
+    bool probe;
+    int connectTimeoutSeconds;
+    {
+        std::lock_guard<std::mutex> lock(host.mutex);
+        const auto now = Clock::now();
+        const auto idleLimit = std::chrono::seconds(host.options.idleSeconds);
+        for (auto it = host.idle.begin(); it != host.idle.end();) {
+            if (now - (*it)->lastUsed > idleLimit) {
+                expired.push_back(std::move(*it));
+                it = host.idle.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        refreshDns = !host.address.empty() && host.addressExpires - now < std::chrono::seconds(60);
+        const bool demanded = now - host.lastDemand < std::chrono::seconds(host.options.probeDemandSeconds);
+        probe = host.options.probe && demanded &&
+                (!host.idle.empty() || (!host.healthy && host.leased < host.options.maxConnections));
+        connectTimeoutSeconds = host.options.connectTimeoutSeconds;
+    }
+    if (!expired.empty()) {
+        LOG_DEBUG("Upstream") << "🔌 " << host.name << ": закрыто простаивающих соединений: " << expired.size();
+        expired.clear();
+    }
+
+    if (refreshDns) cachedAddress(host, true);
+    if (!probe) return;
+
+    auto connection = acquire(host, Clock::now() + std::chrono::seconds(connectTimeoutSeconds));
+    if (!connection) return;
+
+    bool alive = false;
+    try {
+        alive = static_cast<bool>(connection->client->Head("/", httplib::Headers{}));
+    } catch (const std::exception& e) {
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(host.mutex);
+        if (alive != host.healthy) {
+            LOG_AT(alive ? Logger::Level::Info : Logger::Level::Error, "Upstream")
+                << (alive ? "✅ " : "❌ ") << host.name
+                << (alive ? " снова доступен" : " не отвечает на проверку");
+        }
+        host.healthy = alive;
+        if (!alive) ++host.failures;
+    }
+    release(host, std::move(connection), alive);
+}
+
+void UpstreamPool::healthLoop(int intervalSeconds) {
+    std::unique_lock<std::mutex> lock(s_healthMutex);
+    while (s_healthRunning) {
+        s_healthWake.wait_for(lock, std::chrono::seconds(intervalSeconds), [] { return !s_healthRunning; });
+        if (!s_healthRunning) break;
+        lock.unlock();
+
+        std::vector<Host*> hosts;
+        {
+            std::lock_guard<std::mutex> hostsLock(s_mutex);
+            for (auto& entry : s_hosts) hosts.push_back(entry.second.get());
+        }
+        for (Host* host : hosts) checkHost(*host);
+
+        lock.lock();
+    }
+}
+
+void UpstreamPool::startHealthChecks(int intervalSeconds) {
+    std::lock_guard<std::mutex> lock(s_healthMutex);
+    if (s_healthRunning) return;
+    s_healthRunning = true;
+    s_healthThread = std::thread(&UpstreamPool::healthLoop, intervalSeconds > 0 ? intervalSeconds : 15);
+}
+
+void UpstreamPool::stopHealthChecks() {
+    {
+        std::lock_guard<std::mutex> lock(s_healthMutex);
+        s_healthRunning = false;
+    }
+    s_healthWake.notify_all();
+    if (s_healthThread.joinable()) s_healthThread.join();
+}
+
+std::vector<UpstreamPool::HostStats> UpstreamPool::stats() {
+    std::vector<HostStats> result;
+    std::lock_guard<std::mutex> hostsLock(s_mutex);
+    for (auto& entry : s_hosts) {
+        Host& host = *entry.second;
+        std::lock_guard<std::mutex> lock(host.mutex);
+        const double errorRate = host.outcomeCount > 0
+            ? static_cast<double>(host.outcomeFailures) / host.outcomeCount : 0.0;
+        result.push_back({host.name, host.address, host.idle.size(), host.leased,
+                          host.created, host.reused, host.failures, host.healthy,
+                          host.breaker, errorRate, host.trips, host.rejected, host.saturated});
+    }
+    return result;
+}
+
+bool UpstreamPool::circuitOpen(const std::string& name) {
+    Host& host = hostFor(name);
+    std::lock_guard<std::mutex> lock(host.mutex);
+    return host.breaker == BreakerState::Open &&
+           Clock::now() - host.openedAt < std::chrono::seconds(host.options.breakerOpenSeconds);
+}
+
+const char* UpstreamPool::breakerStateName(BreakerState state) {
+    switch (state) {
+    case BreakerState::Closed: return "closed";
+    case BreakerState::Open: return "open";
+    case BreakerState::HalfOpen: return "half-open";
+    }
+    return "unknown";
+}
@@ -0,0 +1,116 @@
+#ifndef UPSTREAMPOOL_H
+#define UPSTREAMPOOL_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+// Общий пул HTTPS-соединений к внешним API (Aladhan, Nominatim, Sunrise-Sunset).
+// На каждый хост - ограниченное число постоянных keep-alive соединений: запрос берет
+// свободное соединение из пула вместо создания клиента, TCP и TLS-рукопожатие делаются
+// один раз на соединение. Адрес хоста резолвится один раз и кешируется с TTL, новые
+// соединения идут на закешированный адрес (SNI и проверка сертификата - по имени хоста).
+// Фоновая проверка закрывает простаивающие соединения, пока их не закрыл сервер,
+// заранее обновляет DNS и, если к хосту недавно обращались, проверяет его доступность
+// (хосты с ограничением частоты запросов, как Nominatim, не проверяются - проверка
+// прошла бы мимо их очереди в UpstreamExecutor).
+//
+// У каждого хоста свой автомат защиты (circuit breaker): по скользящему окну последних
+// вызовов считается доля ошибок (нет ответа, 5xx, 429 или ответ медленнее slowCallMs).
+// При превышении порога цепь размыкается, и запросы сразу получают отказ, не дожидаясь
+// таймаутов; через breakerOpenSeconds пропускается один пробный запрос (half-open):
+// успех замыкает цепь, ошибка снова размыкает. Каждый запрос ограничен бюджетом budgetMs
+// (ожидание соединения, запрос и повтор вместе).
+class UpstreamPool {
+public:
+    struct Options {
+        size_t maxConnections = 4;     // Соединений на хост (занятых + свободных)
+        int connectTimeoutSeconds = 10;
+        int readTimeoutSeconds = 10;
+        int idleSeconds = 30;          // Свободное соединение дольше этого закрывается
+        int dnsTtlSeconds = 300;
+        int budgetMs = 15000;          // Бюджет времени одного запроса
+        int slowCallMs = 5000;         // Ответ медленнее считается ошибкой
+        size_t breakerWindow = 20;     // Вызовов в скользящем окне
+        size_t breakerMinCalls = 10;   // Меньше вызовов в окне - цепь не размыкается
+        double breakerErrorRate = 0.5; // Доля ошибок для размыкания
+        int breakerOpenSeconds = 30;   // Сколько цепь разомкнута до пробного запроса
+        bool probe = true;             // Проверять хост запросом HEAD / (false - хост с лимитом частоты)
+        int probeDemandSeconds = 300;  // Проверять, только если к хосту были запросы за это время
+    };
+
+    enum class BreakerState { Closed, Open, HalfOpen };
+
+    struct Response {
+        int status = 0;                // 0 - нет ответа (ошибка соединения или пул занят)
+        std::string body;
+        std::string error;
+        bool circuitOpen = false;      // Отказ без запроса: цепь разомкнута
+    };
+
+    struct HostStats {
+        std::string host;
+        std::string address;           // Закешированный адрес, пусто - резолвит httplib
+        size_t idle;
+        size_t leased;
+        uint64_t created;              // Открыто соединений
+        uint64_t reused;               // Запросов на уже открытом соединении
+        uint64_t failures;
+        bool healthy;
+        BreakerState breaker;
+        double errorRate;              // Доля ошибок в текущем окне
+        uint64_t trips;                // Сколько раз цепь размыкалась
+        uint64_t rejected;             // Запросов, отклоненных разомкнутой цепью
+        uint64_t saturated;            // Запросов без свободного соединения в пределах бюджета
+    };
+
+    using Headers = std::vector<std::pair<std::string, std::string>>;
+
+    // Настройки хоста; вызывать до первых запросов к нему (иначе - Options по умолчанию)
+    static void configure(const std::string& host, const Options& options);
+
+    // GET https://host/path через соединение из пула; запрос укладывается и в бюджет хоста,
+    // и в дедлайн вызывающего (входящего запроса)
+    static Response get(const std::string& host, const std::string& path, const Headers& headers = {},
+                        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+    // Фоновая проверка соединений и DNS; stopHealthChecks - до выхода из main()
+    static void startHealthChecks(int intervalSeconds = 15);
+    static void stopHealthChecks();
+
+    static std::vector<HostStats> stats();
+    static const char* breakerStateName(BreakerState state);
+    // Цепь хоста разомкнута (запросы к нему сейчас сразу получают отказ)
+    static bool circuitOpen(const std::string& host);
+
+private:
+    struct Connection;
+    struct Host;
+
+    static Host& hostFor(const std::string& name);
+    static std::unique_ptr<Connection> acquire(Host& host, std::chrono::steady_clock::time_point deadline);
+    static void release(Host& host, std::unique_ptr<Connection> connection, bool reusable);
+    static std::unique_ptr<Connection> connect(Host& host);
+    static std::string cachedAddress(Host& host, bool refresh);
+    static std::string resolveAddress(const std::string& name);
+    static bool admit(Host& host);
+    static void recordOutcome(Host& host, bool success);
+    static void checkHost(Host& host);
+    static void healthLoop(int intervalSeconds);
+
+    static std::mutex s_mutex;
+    static std::map<std::string, std::unique_ptr<Host>> s_hosts;
+    static std::mutex s_healthMutex;
+    static std::condition_variable s_healthWake;
+    static std::thread s_healthThread;
+    static bool s_healthRunning;
+};
+
+#endif // UPSTREAMPOOL_H
@@ -0,0 +1,76 @@
+#include "CityIndex.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+// Замер поиска городов по выборке запросов: каждый запрос выполняется rounds раз,
+// выводятся перцентили задержки и запросы без результатов. Код выхода 1 - p99 выше цели
+// Использование: bench_city_search [индекс] [запросы] [повторов] [результатов]
+int main(int argc, char* argv[]) {
+    std::string path = argc > 1 ? argv[1] : "data/cities.bin";
+    std::string queriesPath = argc > 2 ? argv[2] : "bench/city_queries.txt";
+    int rounds = argc > 3 ? std::stoi(argv[3]) : 50;
+    size_t limit = argc > 4 ? static_cast<size_t>(std::stoul(argv[4])) : 20;
+    const double targetP99Ms = 2.0;
+
+    if (!CityIndex::load(path)) {
+        std::cerr << "❌ Индекс не загружен: " << path << " (соберите его утилитой build_city_index)" << std::endl;
+        return 1;
+    }
+    const auto index = CityIndex::current();
+
+    std::vector<std::string> queries;
+    std::ifstream in(queriesPath);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        queries.push_back(line);
+    }
+    if (queries.empty()) {
+        std::cerr << "❌ Нет запросов: " << queriesPath << std::endl;
+        return 1;
+    }
+
+    // Прогрев (страницы отображения, счетчики потока) и запросы без результатов
+    std::vector<std::string> notFound;
+    for (const std::string& query : queries) {
+        if (index->search(query, limit).empty()) notFound.push_back(query);
+    }
+
+    std::vector<double> latencies;
+    latencies.reserve(queries.size() * static_cast<size_t>(std::max(1, rounds)));
+    size_t results = 0;
+    for (int round = 0; round < rounds; ++round) {
+        for (const std::string& query : queries) {
+            const auto started = std::chrono::steady_clock::now();
+            results += index->search(query, limit).size();
+            const auto elapsed = std::chrono::steady_clock::now() - started;
+            latencies.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * static_cast<double>(latencies.size())))];
+    };
+
+    std::cout << "📊 Поиск городов: " << queries.size() << " запросов x " << rounds << ", до " << limit
+              << " результатов (городов в индексе " << index->size() << ")" << std::endl;
+    std::cout << "   p50 " << percentile(0.50) << " мкс, p90 " << percentile(0.90) << " мкс, p99 "
+              << percentile(0.99) << " мкс, максимум " << latencies.back() << " мкс" << std::endl;
+    std::cout << "   Результатов в среднем " << static_cast<double>(results) / static_cast<double>(latencies.size())
+              << ", без результатов " << notFound.size() << " запросов" << std::endl;
+    for (const std::string& query : notFound) {
+        std::cout << "   ⚠️  Не найдено: " << query << std::endl;
+    }
+
+    if (percentile(0.99) > targetP99Ms * 1000.0) {
+        std::cerr << "❌ p99 выше цели " << targetP99Ms << " мс" << std::endl;
+        return 1;
+    }
+    std::cout << "✅ p99 в пределах цели " << targetP99Ms << " мс" << std::endl;
+    return 0;
+}
@@ -0,0 +1,28 @@
+#include "CityIndex.h"
+#include <iostream>
+#include <string>
+
+// Утилита построения индекса городов для сервера из выгрузки GeoNames
+// (https://download.geonames.org/export/dump/: cities15000.txt, countryInfo.txt,
+// admin1CodesASCII.txt в одном каталоге). Готовый файл заменяется атомарно, работающий
+// сервер подхватывает его сам (CITY_INDEX_RELOAD_SEC)
+// Использование: build_city_index [выгрузка] [путь индекса]
+int main(int argc, char* argv[]) {
+    std::string sourcePath = argc > 1 ? argv[1] : "data/cities15000.txt";
+    std::string path = argc > 2 ? argv[2] : "data/cities.bin";
+
+    std::cout << "🛠️  Построение индекса городов " << sourcePath << " -> " << path << std::endl;
+
+    if (!CityIndex::build(sourcePath, path)) {
+        std::cerr << "❌ Не удалось построить индекс" << std::endl;
+        return 1;
+    }
+
+    if (!CityIndex::load(path)) {
+        std::cerr << "❌ Построенный индекс не прошел проверку" << std::endl;
+        return 1;
+    }
+
+    std::cout << "✅ Индекс готов" << std::endl;
+    return 0;
+}
@@ -0,0 +1,27 @@
+#include "SolarEphemeris.h"
+#include <iostream>
+#include <string>
+
+// Утилита построения таблицы положения солнца для сервера
+// Использование: build_ephemeris [путь] [первый год] [последний год]
+int main(int argc, char* argv[]) {
+    std::string path = argc > 1 ? argv[1] : "data/solar_ephemeris.bin";
+    int fromYear = argc > 2 ? std::stoi(argv[2]) : 1900;
+    int toYear = argc > 3 ? std::stoi(argv[3]) : 2200;
+
+    std::cout << "🛠️  Построение таблицы положения солнца " << fromYear << "-" << toYear
+              << " -> " << path << std::endl;
+
+    if (!SolarEphemeris::build(path, fromYear, toYear + 1)) {
+        std::cerr << "❌ Не удалось построить таблицу" << std::endl;
+        return 1;
+    }
+
+    if (!SolarEphemeris::load(path)) {
+        std::cerr << "❌ Построенная таблица не прошла проверку" << std::endl;
+        return 1;
+    }
+
+    std::cout << "✅ Таблица готова" << std::endl;
+    return 0;
+}
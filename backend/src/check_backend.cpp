@@ -0,0 +1,365 @@
+#include "JsonReader.h"
+#include "CityIndex.h"
+#include "SolarBatch.h"
+#include "PrayerTimesCalculator.h"
+#include "CalculationMethods.h"
+#include "TimeZoneService.h"
+#include "PrayerTimeline.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <filesystem>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+// Проверки разбора недоверенного JSON (тела запросов авторизации) и сверка быстрых путей
+// с прямым расчетом: поиск городов рядом с точкой по сетке - с полным перебором,
+// SolarBatch (все наборы инструкций) - с PrayerTimesCalculator, кеш смещений TimeZoneService -
+// с расчетом без кеша (база tzdata из TZDIR или /usr/share/zoneinfo, без нее проверка
+// пропускается); ближайшие события PrayerTimeline.
+// Использование: check_backend [примеров SolarBatch] [запросов к сетке]. Код выхода 1 - есть ошибки
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        ++failures;
+        std::cerr << "❌ " << what << std::endl;
+    }
+}
+
+const double EARTH_RADIUS_KM = 6371.0088;
+const double DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+
+// Та же формула, что в CityIndex
+double distanceKm(double lat1, double lon1, double lat2, double lon2) {
+    const double dLat = (lat2 - lat1) * DEG_TO_RAD;
+    const double dLon = (lon2 - lon1) * DEG_TO_RAD;
+    const double a = std::sin(dLat / 2) * std::sin(dLat / 2) +
+                     std::cos(lat1 * DEG_TO_RAD) * std::cos(lat2 * DEG_TO_RAD) * std::sin(dLon / 2) * std::sin(dLon / 2);
+    return 2.0 * EARTH_RADIUS_KM * std::asin(std::min(1.0, std::sqrt(a)));
+}
+
+std::string nested(size_t depth) {
+    return std::string(depth, '[') + std::string(depth, ']');
+}
+
+// Декодированное значение единственной строки в тексте; пусто - ошибка разбора
+std::string decoded(const std::string& json) {
+    JsonReader reader(json);
+    if (reader.next() != JsonReader::Token::String) return {};
+    std::string value = reader.string();
+    return reader.next() == JsonReader::Token::End ? value : std::string();
+}
+
+void checkJsonReader() {
+    // Суррогатные пары UTF-16 и непарные суррогаты (заменяются на U+FFFD)
+    check(decoded("\"\\ud83d\\ude00\"") == "\xF0\x9F\x98\x80", "суррогатная пара -> U+1F600");
+    check(decoded("\"\\uD834\\uDD1E\"") == "\xF0\x9D\x84\x9E", "суррогатная пара в верхнем регистре");
+    check(decoded("\"\\ud83dx\"") == "\xEF\xBF\xBDx", "старший суррогат без пары");
+    check(decoded("\"\\ude00\"") == "\xEF\xBF\xBD", "младший суррогат без пары");
+    check(decoded("\"\\ud83d\\u0041\"") == "\xEF\xBF\xBD" "A", "старший суррогат перед обычным символом");
+    check(decoded("\"\\ud83d\"") == "\xEF\xBF\xBD", "старший суррогат в конце строки");
+    check(decoded("\"\\u0416\\u00e9\\u0000x\"") == std::string("\xD0\x96\xC3\xA9\0x", 6), "\\u вне суррогатов");
+    check(!JsonReader::valid("\"\\ud83"), "обрезанный \\u");
+    check(!JsonReader::valid("\"\\uZZZZ\""), "\\u с не-hex цифрами");
+
+    // Ограничение глубины вложенности (MAX_DEPTH = 64)
+    check(JsonReader::valid(nested(64)), "вложенность 64 принимается");
+    check(!JsonReader::valid(nested(65)), "вложенность 65 отклоняется");
+    check(!JsonReader::valid(nested(100000)), "очень глубокая вложенность отклоняется");
+    check(!JsonReader::valid(std::string(100000, '[')), "незакрытая глубокая вложенность отклоняется");
+
+    // Лишние символы после значения
+    const char* trailing[] = {"{\"a\":1}x", "{} {}", "[1]]", "\"a\"\"b\"", "1 2", "true false", "{\"a\":1}}", "null,"};
+    for (const char* json : trailing) check(!JsonReader::valid(json), std::string("лишние символы: ") + json);
+    check(!JsonReader::valid(std::string("{}\0", 3)), "NUL после значения");
+    check(JsonReader::valid(" {\"a\":1} \r\n\t"), "пробелы после значения допустимы");
+
+    // Прочие некорректные тексты
+    const char* invalid[] = {"", " ", "{", "[1,]", "{\"a\":1,}", "{\"a\"}", "{a:1}", "01", "-", "1.", "1e", ".5",
+                             "tru", "nul", "'a'", "\"a\nb\"", "\"\\x\"", "[1 2]", "{\"a\" 1}", "\"abc"};
+    for (const char* json : invalid) check(!JsonReader::valid(json), std::string("некорректный текст принят: ") + json);
+
+    size_t elements = 0;
+    check(JsonReader::valid("[{\"a\":[1,2]},{\"b\":{}},3]", &elements) && elements == 3, "число элементов массива");
+    check(JsonReader::valid("{\"email\":\"a@b.c\",\"password\":\"p\\\"w\"}", &elements) && elements == 2,
+          "число членов объекта");
+
+    // После ошибки reader больше ничего не возвращает
+    JsonReader reader("[1,]");
+    JsonReader::Token token;
+    do {
+        token = reader.next();
+    } while (token != JsonReader::Token::Error && token != JsonReader::Token::End);
+    check(token == JsonReader::Token::Error && reader.next() == JsonReader::Token::Error && reader.failed(),
+          "ошибка запоминается");
+}
+
+struct TestCity {
+    double latitude;
+    double longitude;
+};
+
+// Случайные города (в том числе у полюсов и у 180-го меридиана) в формате GeoNames
+bool writeCities(const std::filesystem::path& path, size_t count, std::mt19937& rng, std::vector<TestCity>& cities) {
+    std::ofstream out(path);
+    std::uniform_real_distribution<double> latitude(-90.0, 90.0);
+    std::uniform_real_distribution<double> longitude(-180.0, 180.0);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    char buffer[64];
+    for (size_t i = 0; i < count; ++i) {
+        double lat = latitude(rng);
+        double lon = longitude(rng);
+        const double kind = unit(rng);
+        if (kind < 0.1) lat = std::copysign(89.0 + unit(rng), lat);               // У полюса
+        else if (kind < 0.2) lon = std::copysign(179.0 + unit(rng), lon);         // У антимеридиана
+        else if (kind < 0.5) lat = 55.0 + unit(rng) * 2.0, lon = 37.0 + unit(rng) * 2.0;  // Плотный район
+
+        std::snprintf(buffer, sizeof(buffer), "%.5f\t%.5f", lat, lon);
+        const std::string coordinates = buffer;
+        const size_t tab = coordinates.find('\t');
+        cities.push_back({std::strtod(coordinates.substr(0, tab).c_str(), nullptr),
+                          std::strtod(coordinates.substr(tab + 1).c_str(), nullptr)});
+        out << (i + 1) << "\tCity" << i << "\tCity" << i << "\t\t" << coordinates
+            << "\tP\tPPL\tXX\t\t01\t\t\t\t" << (1000 + i) << "\t\t\tUTC\t2024-01-01\n";
+    }
+    return static_cast<bool>(out);
+}
+
+void checkNearby(size_t queries) {
+    const std::filesystem::path directory =
+        std::filesystem::temp_directory_path() / ("jummah_check_" + std::to_string(getpid()));
+    std::filesystem::create_directories(directory);
+
+    std::mt19937 rng(18);
+    std::vector<TestCity> cities;
+    const bool built = writeCities(directory / "cities.txt", 30000, rng, cities) &&
+                       CityIndex::build((directory / "cities.txt").string(), (directory / "cities.bin").string()) &&
+                       CityIndex::load((directory / "cities.bin").string());
+    const auto index = CityIndex::current();
+    if (!built || !index || index->size() != cities.size()) {
+        check(false, "индекс городов не собран");
+        std::filesystem::remove_all(directory);
+        return;
+    }
+
+    std::uniform_real_distribution<double> latitude(-90.0, 90.0);
+    std::uniform_real_distribution<double> longitude(-180.0, 180.0);
+    std::uniform_real_distribution<double> radius(0.0, 3000.0);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_int_distribution<size_t> limit(1, 30);
+
+    size_t mismatches = 0;
+    std::vector<double> expected;
+    for (size_t q = 0; q < queries; ++q) {
+        double lat = latitude(rng);
+        double lon = longitude(rng);
+        const double kind = unit(rng);
+        if (kind < 0.15) lat = std::copysign(88.0 + 2.0 * unit(rng), lat);
+        else if (kind < 0.3) lon = std::copysign(178.5 + 1.5 * unit(rng), lon);
+        else if (kind < 0.5) lat = 54.5 + unit(rng) * 3.0, lon = 36.5 + unit(rng) * 3.0;
+        const double radiusKm = q % 10 == 0 ? 50.0 : radius(rng);
+        const size_t count = q % 10 == 0 ? 1 : limit(rng);
+
+        expected.clear();
+        for (const TestCity& city : cities) {
+            const double distance = distanceKm(lat, lon, city.latitude, city.longitude);
+            if (distance <= radiusKm) expected.push_back(distance);
+        }
+        std::sort(expected.begin(), expected.end());
+        if (expected.size() > count) expected.resize(count);
+
+        const auto found = index->nearby(lat, lon, radiusKm, count);
+        bool same = found.size() == expected.size();
+        for (size_t i = 0; same && i < found.size(); ++i) {
+            const double direct = distanceKm(lat, lon, found[i].city.latitude, found[i].city.longitude);
+            same = std::fabs(found[i].distanceKm - expected[i]) <= 1e-9 && std::fabs(direct - expected[i]) <= 1e-9;
+        }
+        const auto nearest = index->nearest(lat, lon, radiusKm);
+        same = same && nearest.has_value() == !expected.empty() &&
+               (!nearest || std::fabs(nearest->distanceKm - expected.front()) <= 1e-9);
+        if (!same && ++mismatches <= 5) {
+            std::cerr << "   (" << lat << ", " << lon << "), радиус " << radiusKm << " км, до " << count
+                      << ": найдено " << found.size() << ", перебором " << expected.size() << std::endl;
+        }
+    }
+    check(mismatches == 0, "поиск рядом расходится с полным перебором");
+    std::cout << "📍 Поиск рядом: " << queries << " запросов к " << cities.size() << " городам, расхождений с перебором: "
+              << mismatches << std::endl;
+    std::filesystem::remove_all(directory);
+}
+
+void checkSolarBatch(size_t samples) {
+    using Calculator = PrayerTimesCalculator;
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<double> latitude(-60.0, 60.0);
+    std::uniform_real_distribution<double> longitude(-180.0, 180.0);
+    std::uniform_int_distribution<int> day(Calculator::daysFromCivil(1900, 1, 1), Calculator::daysFromCivil(2200, 1, 1));
+
+    std::vector<int> days(samples);
+    std::vector<double> julianDays(samples), latitudes(samples), longitudes(samples), timezones(samples);
+    for (size_t i = 0; i < samples; ++i) {
+        days[i] = day(rng);
+        julianDays[i] = Calculator::julianDayFromDays(days[i]);
+        latitudes[i] = latitude(rng);
+        longitudes[i] = longitude(rng);
+        timezones[i] = std::round(longitudes[i] / 15.0);
+    }
+    const SolarBatch::Input input{julianDays.data(), latitudes.data(), longitudes.data(), timezones.data(), samples};
+    std::vector<std::vector<double>> times(6, std::vector<double>(samples));
+    const SolarBatch::Output output{times[0].data(), times[1].data(), times[2].data(),
+                                    times[3].data(), times[4].data(), times[5].data()};
+
+    const double toleranceSeconds = 5e-8;
+    for (SolarBatch::Isa isa : {SolarBatch::Isa::Scalar, SolarBatch::Isa::Sse42, SolarBatch::Isa::Avx2}) {
+        double worstSeconds = 0.0;
+        size_t nanMismatches = 0;
+        for (int method = 0; method < CalculationMethods::METHOD_COUNT; ++method) {
+            for (int madhhab = 0; madhhab < CalculationMethods::MADHHAB_COUNT; ++madhhab) {
+                SolarBatch::computeWith(isa, input, SolarBatch::parametersFor(method, madhhab), output);
+                for (size_t i = 0; i < samples; ++i) {
+                    Calculator::Request request;
+                    Calculator::civilFromDays(days[i], request.year, request.month, request.day);
+                    request.latitude = latitudes[i];
+                    request.longitude = longitudes[i];
+                    request.timezone = timezones[i];
+                    request.method = method;
+                    request.madhhab = madhhab;
+                    const Calculator::Times direct = Calculator::computePrayerTimes(request);
+                    const double reference[6] = {direct.fajr, direct.sunrise, direct.dhuhr,
+                                                 direct.asr, direct.maghrib, direct.isha};
+                    for (int k = 0; k < 6; ++k) {
+                        if (std::isnan(reference[k]) || std::isnan(times[k][i])) {
+                            if (std::isnan(reference[k]) != std::isnan(times[k][i])) ++nanMismatches;
+                            continue;
+                        }
+                        double difference = std::fabs(reference[k] - times[k][i]);
+                        difference = std::min(difference, 24.0 - difference);
+                        worstSeconds = std::max(worstSeconds, difference * 3600.0);
+                    }
+                }
+            }
+        }
+        std::cout << "☀️ SolarBatch " << SolarBatch::isaName(isa) << ": " << samples << " примеров x "
+                  << CalculationMethods::METHOD_COUNT * CalculationMethods::MADHHAB_COUNT
+                  << " методов, макс. отклонение " << worstSeconds << " с, расхождений NaN: " << nanMismatches << std::endl;
+        check(worstSeconds <= toleranceSeconds && nanMismatches == 0,
+              std::string("SolarBatch ") + SolarBatch::isaName(isa) + " расходится с прямым расчетом");
+    }
+}
+
+void checkTimeZones() {
+    const char* zoneinfoDir = std::getenv("TZDIR");
+    if (!TimeZoneService::initialize(zoneinfoDir ? zoneinfoDir : "/usr/share/zoneinfo")) {
+        std::cout << "⚠️ Часовые пояса: база tzdata не найдена, проверка пропущена" << std::endl;
+        return;
+    }
+    using Calculator = PrayerTimesCalculator;
+    const TimeZoneService::TimeZone berlin = TimeZoneService::resolve("Europe/Berlin", 52.52, 13.40);
+    check(berlin.zone >= 0, "зона Europe/Berlin не найдена");
+    if (berlin.zone < 0) return;
+
+    // Дни, отстоящие на 2^20, не должны делить запись кеша
+    const int day = Calculator::daysFromCivil(2027, 11, 3);
+    TimeZoneService::offsetHours(berlin, day + (1 << 20));  // 4898-09-28, летнее время
+    check(TimeZoneService::offsetHours(berlin, day) == 1.0, "Берлин 2027-11-03: UTC+1");
+    check(TimeZoneService::offsetHours(berlin, Calculator::daysFromCivil(2027, 7, 1)) == 2.0, "Берлин 2027-07-01: UTC+2");
+    const TimeZoneService::TimeZone moscow = TimeZoneService::resolve("Europe/Moscow", 55.75, 37.62);
+    check(TimeZoneService::offsetHours(moscow, Calculator::daysFromCivil(2024, 1, 15)) == 3.0, "Москва 2024-01-15: UTC+3");
+    check(TimeZoneService::resolve("5.5", 0.0, 0.0).fixedHours == 5.5, "фиксированное смещение 5.5");
+
+    // Кешированные смещения совпадают с расчетом без кеша, в том числе для дней, дающих
+    // одинаковые младшие биты и один слот
+    const char* names[] = {"Europe/Berlin", "Europe/Moscow", "America/New_York", "America/Santiago",
+                           "Australia/Sydney", "Asia/Tehran", "Asia/Kolkata", "Pacific/Chatham",
+                           "Africa/Casablanca", "UTC"};
+    std::vector<TimeZoneService::TimeZone> zones;
+    for (const char* name : names) {
+        const TimeZoneService::TimeZone zone = TimeZoneService::resolve(name, 0.0, 0.0);
+        if (zone.zone >= 0) zones.push_back(zone);
+    }
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> days(Calculator::daysFromCivil(1900, 1, 1), Calculator::daysFromCivil(2100, 1, 1));
+    std::uniform_int_distribution<size_t> zoneIndex(0, zones.size() - 1);
+    size_t mismatches = 0;
+    size_t lookups = 0;
+    for (int i = 0; i < 20000; ++i) {
+        const TimeZoneService::TimeZone& zone = zones[zoneIndex(rng)];
+        const int base = days(rng);
+        for (int shift : {1 << 20, 0, -(1 << 20), 1 << 21, 0}) {
+            const int local = base + shift;
+            const int64_t noon = int64_t(local) * 86400 + 43200;
+            const double direct = TimeZoneService::offsetHoursAt(
+                zone, noon - static_cast<int64_t>(std::lround(TimeZoneService::offsetHoursAt(zone, noon) * 3600.0)));
+            ++lookups;
+            if (TimeZoneService::offsetHours(zone, local) != direct) ++mismatches;
+        }
+    }
+    check(mismatches == 0, "кеш смещений часовых поясов расходится с расчетом без кеша");
+    std::cout << "🕐 Часовые пояса: " << lookups << " запросов к " << zones.size() << " зонам (tzdata "
+              << TimeZoneService::dataVersion() << "), расхождений с расчетом без кеша: " << mismatches << std::endl;
+}
+
+void checkTimeline() {
+    using Prayer = PrayerTimeline::Prayer;
+    const PrayerTimesCalculator::Times day{5.0, 6.5, 12.25, 15.5, 18.0, 19.75};
+    const PrayerTimesCalculator::Times lateIsha{5.0, 6.5, 12.25, 15.5, 21.0, 0.5};  // Иша после полуночи
+    const PrayerTimeline timeline(day, day, day);
+    PrayerTimeline::Event events[PrayerTimeline::MAX_EVENTS];
+
+    // После Иши: события завтрашнего дня по порядку, первое совпадает с locate().next
+    size_t count = timeline.upcoming(20 * 3600, events, 3);
+    check(count == 3 && events[0].prayer == Prayer::Fajr && events[0].second == 86400 + 5 * 3600 &&
+          events[1].prayer == Prayer::Sunrise && events[2].prayer == Prayer::Dhuhr &&
+          events[2].second == 86400 + 12 * 3600 + 15 * 60, "upcoming после Иши");
+    check(timeline.locate(20 * 3600).next.second == events[0].second, "upcoming и locate согласованы");
+
+    // Днем: остаток сегодняшнего дня и весь завтрашний, не больше, чем есть в шкале
+    count = timeline.upcoming(13 * 3600, events, PrayerTimeline::MAX_EVENTS);
+    check(count == 9 && events[0].prayer == Prayer::Asr && events[2].prayer == Prayer::Isha &&
+          events[8].prayer == Prayer::Isha && events[8].second == 86400 + 19 * 3600 + 45 * 60, "upcoming днем");
+    // Ровно в момент события оно уже текущее
+    count = timeline.upcoming(15 * 3600 + 30 * 60, events, 1);
+    check(count == 1 && events[0].prayer == Prayer::Maghrib, "upcoming в момент события");
+    check(timeline.upcoming(13 * 3600, events, 0) == 0, "upcoming с count = 0");
+
+    // Иша после полуночи относится к прошедшему дню: в 23:00 следующая - Иша в 24:30
+    const PrayerTimeline late(lateIsha, lateIsha, lateIsha);
+    count = late.upcoming(23 * 3600, events, 2);
+    check(count == 2 && events[0].prayer == Prayer::Isha && events[0].second == 24 * 3600 + 30 * 60 &&
+          events[1].prayer == Prayer::Fajr, "upcoming с Ишей после полуночи");
+
+    // Полярный день: событий без времени (NaN) в шкале нет
+    const double nan = std::nan("");
+    const PrayerTimesCalculator::Times polar{nan, nan, 12.0, 16.0, nan, nan};
+    const PrayerTimeline polarTimeline(polar, polar, polar);
+    count = polarTimeline.upcoming(13 * 3600, events, PrayerTimeline::MAX_EVENTS);
+    check(count == 3 && events[0].prayer == Prayer::Asr && events[1].prayer == Prayer::Dhuhr, "upcoming без NaN-событий");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const size_t solarSamples = argc > 1 ? static_cast<size_t>(std::stoul(argv[1])) : 10000;
+    const size_t nearbyQueries = argc > 2 ? static_cast<size_t>(std::stoul(argv[2])) : 5000;
+
+    checkJsonReader();
+    checkNearby(nearbyQueries);
+    checkSolarBatch(solarSamples);
+    checkTimeZones();
+    checkTimeline();
+
+    if (failures > 0) {
+        std::cerr << "❌ Ошибок: " << failures << std::endl;
+        return 1;
+    }
+    std::cout << "✅ Все проверки пройдены" << std::endl;
+    return 0;
+}
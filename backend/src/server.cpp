@@ -2,11 +2,25 @@
 #define CPPHTTPLIB_USE_CERTS_FROM_MACOSX_KEYCHAIN
 #include <httplib.h>
 #include "PrayerTimesCalculator.h"
+#include "CalculationMethods.h"
 #include "FileService.h"
+#include "StaticAssets.h"
+#include "ResponseCompression.h"
 #include "JsonService.h"
+#include "JsonReader.h"
 #include "AuthService.h"
 #include "CitySearchService.h"
-#include <iostream>
+#include "CityIndex.h"
+#include "PrayerTimesService.h"
+#include "SolarBatch.h"
+#include "SolarEphemeris.h"
+#include "TimeZoneService.h"
+#include "PrayerTimesCache.h"
+#include "PrayerTimesCacheStore.h"
+#include "UpstreamPool.h"
+#include "UpstreamExecutor.h"
+#include "SingleFlight.h"
+#include "Logger.h"
 #include <sstream>
 #include <fstream>
 #include <string>
@@ -17,55 +31,195 @@
 #include <future>
 #include <cctype>
 #include <cstdio>
+#include <cstdlib>
 #include <chrono>
 #include <mutex>
+#include <memory>
+#include <algorithm>
+#include <cmath>
 
 
 int main(int argc, char* argv[]) {
-    std::cout << "🚀 [SERVER] Запуск сервера Jummah Prayer Backend..." << std::endl;
-    std::cout.flush();
+    // Журнал: уровень (LOG_LEVEL), формат text/json (LOG_FORMAT), файл (LOG_FILE, по умолчанию
+    // stdout) и доля журналируемых запросов частых маршрутов (LOG_SAMPLE, "путь=доля,...").
+    // SIGUSR1 включает и выключает отладочный уровень без перезапуска
+    Logger::Options logOptions;
+    if (const char* level = std::getenv("LOG_LEVEL")) {
+        logOptions.level = Logger::parseLevel(level, logOptions.level);
+    }
+    if (const char* format = std::getenv("LOG_FORMAT")) {
+        logOptions.format = std::string(format) == "json" ? Logger::Format::Json : Logger::Format::Text;
+    }
+    if (const char* file = std::getenv("LOG_FILE")) {
+        logOptions.path = file;
+    }
+    Logger::start(logOptions);
+    Logger::installSignalHandlers();
+    const char* logSample = std::getenv("LOG_SAMPLE");
+    Logger::configureSampling(logSample ? logSample : "/api/prayer-times=0.1");
+    
+    LOG_INFO("Server") << "🚀 Запуск сервера Jummah Prayer Backend...";
     
     httplib::Server server;
-    PrayerTimesCalculator calculator;
     AuthService authService;
     
-    std::cout << "🔧 [SERVER] Инициализация сервисов..." << std::endl;
-    std::cout.flush();
+    // Доля запросов, сверяемых с Aladhan API в фоне (0 - сверка отключена)
+    double verifyRate = 0.0;
+    if (const char* rate = std::getenv("ALADHAN_VERIFY_RATE")) {
+        try { verifyRate = std::stod(rate); } catch (const std::exception& e) {}
+    }
+    PrayerTimesService prayerTimesService(verifyRate);
+    
+    // Кеш результатов /api/prayer-times: шаг сетки в градусах и лимит памяти (0 - выключен)
+    double cacheCellDegrees = 0.01;
+    double cacheMaxMb = 64.0;
+    if (const char* cell = std::getenv("PRAYER_CACHE_CELL_DEG")) {
+        try { cacheCellDegrees = std::stod(cell); } catch (const std::exception& e) {}
+    }
+    if (const char* maxMb = std::getenv("PRAYER_CACHE_MAX_MB")) {
+        try { cacheMaxMb = std::stod(maxMb); } catch (const std::exception& e) {}
+    }
+    PrayerTimesCache prayerTimesCache(cacheCellDegrees, static_cast<size_t>(std::max(0.0, cacheMaxMb) * 1024 * 1024));
+    SingleFlight<PrayerTimesCache::Key, std::shared_ptr<const PrayerTimesCache::Entry>, PrayerTimesCache::KeyHash> prayerTimesFlights;
+    LOG_INFO("Server") << "🗄️ Кеш времени молитв: ячейка " << cacheCellDegrees << "°, лимит " << cacheMaxMb << " МБ";
+    
+    LOG_INFO("Server") << "🔧 Инициализация сервисов...";
+    
+    // Пул соединений к внешним API (UPSTREAM_MAX_CONNECTIONS - соединений на хост).
+    // Поиск городов ждет пользователь, поэтому бюджет короткий; сверка с Aladhan идет в фоне
+    UpstreamPool::Options upstreamOptions;
+    if (const char* maxConnections = std::getenv("UPSTREAM_MAX_CONNECTIONS")) {
+        try { upstreamOptions.maxConnections = std::max(1, std::stoi(maxConnections)); } catch (const std::exception& e) {}
+    }
+    UpstreamPool::Options nominatimOptions = upstreamOptions;
+    nominatimOptions.budgetMs = 8000;
+    nominatimOptions.slowCallMs = 4000;
+    nominatimOptions.probe = false;  // Политика Nominatim: 1 запрос/с, проверки шли бы мимо очереди
+    UpstreamPool::configure(CitySearchService::NOMINATIM_HOST, nominatimOptions);
+    UpstreamPool::configure("api.sunrise-sunset.org", upstreamOptions);
+    UpstreamPool::Options aladhanOptions = upstreamOptions;
+    aladhanOptions.connectTimeoutSeconds = 30;
+    aladhanOptions.readTimeoutSeconds = 30;
+    aladhanOptions.budgetMs = 30000;
+    aladhanOptions.slowCallMs = 10000;
+    UpstreamPool::configure("api.aladhan.com", aladhanOptions);
+    
+    // Исполнитель внешних запросов: потоки (UPSTREAM_THREADS) и лимиты на хост.
+    // Nominatim допускает один запрос в секунду, поэтому к нему - по одному запросу
+    int upstreamThreads = 4;
+    if (const char* threads = std::getenv("UPSTREAM_THREADS")) {
+        try { upstreamThreads = std::max(1, std::stoi(threads)); } catch (const std::exception& e) {}
+    }
+    UpstreamExecutor::limitHost(CitySearchService::NOMINATIM_HOST, 1, 8);
+    UpstreamExecutor::limitHost("api.aladhan.com", upstreamOptions.maxConnections, 64);
+    UpstreamExecutor::limitHost("api.sunrise-sunset.org", upstreamOptions.maxConnections, 32);
+    LOG_INFO("Server") << "🧮 Пакетный расчет времени молитв: " << SolarBatch::isaName(SolarBatch::activeIsa());
+    
+    // Таблица положения солнца (build_ephemeris); без нее расчет идет напрямую
+    const char* ephemerisPath = std::getenv("SOLAR_EPHEMERIS_PATH");
+    SolarEphemeris::load(ephemerisPath ? ephemerisPath : "data/solar_ephemeris.bin");
+    
+    // База часовых поясов IANA (TZDIR - стандартная переменная для ее каталога)
+    const char* zoneinfoDir = std::getenv("TZDIR");
+    TimeZoneService::initialize(zoneinfoDir ? zoneinfoDir : "/usr/share/zoneinfo");
+    
+    // Офлайн-индекс городов (файл собирает build_city_index из выгрузки GeoNames).
+    // Nominatim - запасной вариант, если индекса нет или в нем ничего не нашлось;
+    // CITY_SEARCH_FALLBACK=0 - не обращаться к Nominatim при поиске вовсе.
+    // Замененный файл подхватывается раз в CITY_INDEX_RELOAD_SEC секунд (0 - не следить)
+    const char* cityIndexEnv = std::getenv("CITY_INDEX_PATH");
+    const std::string cityIndexPath = cityIndexEnv ? cityIndexEnv : "data/cities.bin";
+    CityIndex::load(cityIndexPath);
+    int cityIndexReloadSeconds = 60;
+    if (const char* reload = std::getenv("CITY_INDEX_RELOAD_SEC")) {
+        try { cityIndexReloadSeconds = std::stoi(reload); } catch (const std::exception& e) {}
+    }
+    bool nominatimFallback = true;
+    if (const char* fallback = std::getenv("CITY_SEARCH_FALLBACK")) {
+        nominatimFallback = std::string(fallback) != "0";
+    }
+    
+    // Постоянный кеш: таблица prayer_cache в базе SQLite (PRAYER_CACHE_FLUSH_SEC=0 - отключен).
+    // Самые популярные записи загружаются до начала приема запросов
+    int cacheFlushSeconds = 60;
+    int cacheWarmEntries = 20000;
+    if (const char* flush = std::getenv("PRAYER_CACHE_FLUSH_SEC")) {
+        try { cacheFlushSeconds = std::stoi(flush); } catch (const std::exception& e) {}
+    }
+    if (const char* warm = std::getenv("PRAYER_CACHE_WARM_ENTRIES")) {
+        try { cacheWarmEntries = std::stoi(warm); } catch (const std::exception& e) {}
+    }
+    std::unique_ptr<PrayerTimesCacheStore> prayerTimesCacheStore;
+    if (prayerTimesCache.enabled() && cacheFlushSeconds > 0) {
+        const char* cacheDbPath = std::getenv("PRAYER_CACHE_DB");
+        prayerTimesCacheStore = std::make_unique<PrayerTimesCacheStore>(
+            prayerTimesCache, cacheDbPath ? cacheDbPath : "data/jummah_prayer.db", cacheFlushSeconds);
+        prayerTimesCacheStore->warmUp(static_cast<size_t>(std::max(0, cacheWarmEntries)));
+    }
     
     // Определяем путь к веб-файлам
     std::string webRoot = FileService::findWebRoot(argc, argv);
     if (webRoot.empty()) {
-        std::cerr << "❌ [SERVER] Не удалось найти путь к веб-файлам!" << std::endl;
-        std::cerr.flush();
+        LOG_ERROR("Server") << "❌ Не удалось найти путь к веб-файлам!";
+        Logger::stop();
         return 1;
     }
-    std::cout << "✅ [SERVER] Веб-корень: " << webRoot << std::endl;
-    std::cout.flush();
+    LOG_INFO("Server") << "✅ Веб-корень: " << webRoot;
+    
+    // Статические файлы отдаются из памяти (сжатые варианты и ETag готовятся при запуске).
+    // STATIC_WATCH=1 - перечитывать измененные файлы на ходу (разработка фронтенда)
+    StaticAssets::load(webRoot);
+    bool staticWatch = false;
+    if (const char* watch = std::getenv("STATIC_WATCH")) {
+        staticWatch = std::string(watch) == "1";
+    }
+    
+    // Сжатие ответов API по Accept-Encoding (RESPONSE_COMPRESSION=0 - выключено) для тел
+    // не меньше COMPRESSION_MIN_BYTES; статические файлы сжаты заранее в StaticAssets
+    ResponseCompression::Options compressionOptions;
+    if (const char* compression = std::getenv("RESPONSE_COMPRESSION")) {
+        compressionOptions.enabled = std::string(compression) != "0";
+    }
+    if (const char* minBytes = std::getenv("COMPRESSION_MIN_BYTES")) {
+        try { compressionOptions.minSize = static_cast<size_t>(std::max(0, std::stoi(minBytes))); } catch (const std::exception& e) {}
+    }
+    ResponseCompression::configure(compressionOptions);
+    if (compressionOptions.enabled) {
+        LOG_INFO("Server") << "🗜️ Сжатие ответов: " << ResponseCompression::available()
+                           << " (от " << compressionOptions.minSize << " байт)";
+    }
     
-    // Логирование всех запросов (БОЛЕЕ ДЕТАЛЬНОЕ)
+    // Готовое тело ответа сжимается после обработчика, до отправки заголовков
+    server.set_post_routing_handler([](const httplib::Request& req, httplib::Response& res) {
+        ResponseCompression::apply(req, res);
+    });
+    
+    // Начало запроса: решение о выборке для журнала (LOG_SAMPLE) и отсчет времени обработки
+    server.set_pre_routing_handler([](const httplib::Request& req, httplib::Response&) {
+        Logger::beginRequest(req.path);
+        return httplib::Server::HandlerResponse::Unhandled;
+    });
+    
+    // Журнал запросов: одна строка на запрос; ошибки сервера пишутся всегда
     server.set_logger([](const httplib::Request& req, const httplib::Response& res) {
-        std::cout << "\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━" << std::endl;
-        std::cout << "📥 [REQUEST] " << req.method << " " << req.path;
-        if (!req.params.empty()) {
-            std::cout << "?";
-            bool first = true;
+        const auto level = res.status >= 500 ? Logger::Level::Warn : Logger::Level::Info;
+        if (Logger::enabled(level)) {
+            std::string query;
             for (const auto& param : req.params) {
-                if (!first) std::cout << "&";
-                std::cout << param.first << "=" << param.second;
-                first = false;
+                if (!query.empty()) query += "&";
+                query += param.first + "=" + param.second;
             }
+            LOG_AT(level, "HTTP").field("method", req.method).field("path", req.path).field("query", query)
+                .field("status", res.status).field("ms", Logger::requestElapsedMs())
+                << "📥 " << req.method << " " << req.path << " -> " << res.status;
         }
-        std::cout << std::endl;
-        std::cout << "📤 [RESPONSE] Status: " << res.status << std::endl;
-        std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━" << std::endl;
-        std::cout.flush();
+        Logger::endRequest();
     });
     
     // Логирование ошибок
     server.set_error_handler([](const httplib::Request& req, httplib::Response& res) {
-        std::cerr << "\n❌ [ERROR HANDLER] Ошибка обработки запроса: " << req.method << " " << req.path << std::endl;
-        std::cerr << "   Статус: " << res.status << std::endl;
-        std::cerr.flush();
+        LOG_WARN("HTTP").field("status", res.status)
+            << "❌ Ошибка обработки запроса: " << req.method << " " << req.path;
     });
     
     // CORS headers
@@ -83,7 +237,7 @@ int main(int argc, char* argv[]) {
     
     // Обработчик для всех остальных запросов (статические файлы)
     // Регистрируем ДО API, но с проверкой внутри
-    auto handleStaticFile = [&webRoot, &setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
+    auto handleStaticFile = [&setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
         // Пропускаем API запросы
         if (req.path.find("/api/") == 0) {
             res.status = 404;
@@ -91,23 +245,10 @@ int main(int argc, char* argv[]) {
             return;
         }
         
-        std::string path = req.path;
-        if (path == "/") {
-            path = "/index.html";
-        }
-        
-        std::string filePath = webRoot + path.substr(1);
-        std::cout << "📄 Запрос: " << req.path << " -> файл: " << filePath << std::endl;
-        
-        std::string content = FileService::readFile(filePath);
-        
-        if (content.empty()) {
-            std::cout << "⚠️  Файл не найден: " << filePath << std::endl;
+        if (!StaticAssets::serve(req, res)) {
+            LOG_INFO("Static") << "⚠️ Файл не найден: " << req.path;
             res.status = 404;
-            res.set_content("Not Found: " + filePath, "text/plain");
-        } else {
-            std::cout << "✅ Файл найден, размер: " << content.size() << " байт" << std::endl;
-            res.set_content(content, FileService::getMimeType(filePath));
+            res.set_content("Not Found", "text/plain");
         }
         
         setCorsHeaders(res);
@@ -317,200 +458,55 @@ int main(int argc, char* argv[]) {
         res.set_content(result, "application/json");
     });
     
-    // Функция для получения кода метода для Aladhan API
-    auto getMethodCode = [](int method) -> std::string {
-        switch (method) {
-            case 0: return "3";  // MWL
-            case 1: return "2";  // ISNA
-            case 2: return "5";  // Egypt
-            case 3: return "4";  // Makkah
-            case 4: return "1";  // Karachi
-            case 5: return "7";  // Tehran
-            default: return "4";  // Makkah по умолчанию
-        }
-    };
-    
-    // Функция для запроса времени молитв из Aladhan API
-    auto httpGetAladhan = [&getMethodCode](double lat, double lon, int method, int madhhab, int year, int month, int day) -> std::string {
-        std::cout << "🕌 Запрос времени молитв из Aladhan API" << std::endl;
-        
-        std::cout << "🌐 [Aladhan] Подключение к api.aladhan.com..." << std::endl;
-        std::cout.flush();
-        
-        httplib::SSLClient cli("api.aladhan.com", 443);
-        cli.set_follow_location(true);
-        cli.set_connection_timeout(30);  // Увеличено с 10 до 30 секунд
-        cli.set_read_timeout(30);        // Увеличено с 10 до 30 секунд
-        
-        // Формируем дату в формате DD-MM-YYYY для явного указания григорианского календаря
-        // Aladhan API интерпретирует YYYY-MM-DD как хиджру, а DD-MM-YYYY как григорианский календарь
-        std::ostringstream dateStr;
-        dateStr << std::setfill('0') << std::setw(2) << day << "-"
-                << std::setw(2) << month << "-" << year;
-        
-        std::ostringstream url;
-        // Используем дату в формате DD-MM-YYYY для григорианского календаря
-        // Согласно документации Aladhan API: https://aladhan.com/prayer-times-api
-        url << "/v1/timings/" << dateStr.str() << "?";
-        url << "latitude=" << lat << "&";
-        url << "longitude=" << lon << "&";
-        url << "method=" << getMethodCode(method) << "&";
-        url << "school=" << (madhhab == 1 ? "1" : "0") << "&";  // 1 = Hanafi, 0 = Shafi'i
-        url << "calendar=gregorian";  // Явно указываем григорианский календарь
-        
-        httplib::Headers headers = {
-            {"Accept", "application/json"},
-            {"Cache-Control", "no-cache, no-store, must-revalidate"},
-            {"Pragma", "no-cache"}
-        };
-        
-        std::string fullUrl = url.str();
-        std::cout << "🌐 [Aladhan] Запрос к: https://api.aladhan.com" << fullUrl << std::endl;
-        std::cout << "   [Aladhan] Дата запроса: " << dateStr.str() << std::endl;
-        std::cout.flush();
-        
-        std::cout << "🌐 [Aladhan] Выполнение HTTP GET запроса..." << std::endl;
-        std::cout.flush();
-        
-        auto response = cli.Get(fullUrl.c_str(), headers);
-        
-        std::cout << "🌐 [Aladhan] Ответ получен" << std::endl;
-        std::cout.flush();
-        if (response) {
-            std::cout << "✅ [Aladhan] Получен ответ, статус: " << response->status << ", размер: " << response->body.size() << " байт" << std::endl;
-            std::cout.flush();
-            
-            if (response->status == 200) {
-                std::cout << "✅ [Aladhan] Успешный ответ, возвращаем данные" << std::endl;
-                std::cout.flush();
-                return response->body;
-            } else {
-                std::cout << "❌ [Aladhan] Ошибка HTTP статус: " << response->status << std::endl;
-                std::cout << "   [Aladhan] Тело ответа (первые 200 символов): " << response->body.substr(0, 200) << std::endl;
-                std::cout.flush();
-            }
-        } else {
-            std::cout << "❌ [Aladhan] Не удалось получить ответ (response == nullptr)" << std::endl;
-            std::cout.flush();
-        }
-        
-        std::cout << "❌ [Aladhan] Возвращаем пустую строку" << std::endl;
-        std::cout.flush();
-        return "";
-    };
-    
-    // Простая функция для извлечения значения из JSON (упрощенный парсер)
-    // Ищет значение внутри структуры {"data":{"timings":{"Fajr":"05:30","Sunrise":"07:00",...}}}
-    auto extractJsonValue = [](const std::string& json, const std::string& key) -> std::string {
-        // Сначала ищем внутри "timings"
-        std::string timingsKey = "\"timings\"";
-        size_t timingsPos = json.find(timingsKey);
-        if (timingsPos == std::string::npos) {
-            // Если timings не найден, ищем ключ напрямую
-            timingsPos = 0;
-        } else {
-            // Ищем открывающую скобку после "timings"
-            timingsPos = json.find("{", timingsPos);
-            if (timingsPos == std::string::npos) return "";
-        }
-        
-        // Ищем ключ в формате "Fajr", "Sunrise" и т.д.
-        std::string searchKey = "\"" + key + "\"";
-        size_t pos = json.find(searchKey, timingsPos);
-        if (pos == std::string::npos) {
-            std::cout << "   ⚠️ Ключ \"" << key << "\" не найден в JSON" << std::endl;
-            return "";
-        }
-        
-        // Находим двоеточие после ключа
-        pos = json.find(":", pos);
-        if (pos == std::string::npos) return "";
-        pos++;
-        
-        // Пропускаем пробелы и табы
-        while (pos < json.size() && (json[pos] == ' ' || json[pos] == '\t' || json[pos] == '\n' || json[pos] == '\r')) {
-            pos++;
-        }
-        
-        if (pos >= json.size() || json[pos] != '"') {
-            std::cout << "   ⚠️ Ожидалась кавычка после ключа \"" << key << "\"" << std::endl;
-            return "";
-        }
-        pos++; // Пропускаем открывающую кавычку
-        
-        // Извлекаем значение до закрывающей кавычки
-        size_t end = pos;
-        while (end < json.size() && json[end] != '"') {
-            if (json[end] == '\\' && end + 1 < json.size()) {
-                end += 2; // Пропускаем экранированные символы
-            } else {
-                end++;
-            }
-        }
-        
-        if (end > pos) {
-            std::string value = json.substr(pos, end - pos);
-            // Убираем возможные экранированные символы (упрощенно)
-            size_t escPos = 0;
-            while ((escPos = value.find("\\", escPos)) != std::string::npos && escPos + 1 < value.size()) {
-                value.erase(escPos, 1);
-            }
-            return value;
-        }
-        return "";
-    };
-    
     // Функция для запроса восхода/заката из Sunrise-Sunset API (более точные данные)
-    auto httpGetSunriseSunset = [&extractJsonValue](double lat, double lon, int year, int month, int day) -> std::pair<std::string, std::string> {
-        std::cout << "🌅 Запрос восхода/заката из Sunrise-Sunset API" << std::endl;
+    auto httpGetSunriseSunset = [](double lat, double lon, int year, int month, int day) -> std::pair<std::string, std::string> {
+        LOG_DEBUG("Sunrise") << "🌅 Запрос восхода/заката из Sunrise-Sunset API";
         
         try {
-            httplib::SSLClient cli("api.sunrise-sunset.org", 443);
-            cli.set_follow_location(true);
-            cli.set_connection_timeout(10);
-            cli.set_read_timeout(10);
-            
             std::ostringstream url;
             url << "/json?lat=" << lat << "&lng=" << lon 
                 << "&date=" << year << "-" << std::setfill('0') << std::setw(2) << month 
                 << "-" << std::setw(2) << day << "&formatted=1";
             
-            httplib::Headers headers = {
-                {"Accept", "application/json"}
-            };
-            
             std::string fullUrl = url.str();
-            std::cout << "🌐 Запрос к Sunrise-Sunset: https://api.sunrise-sunset.org" << fullUrl << std::endl;
+            LOG_DEBUG("Sunrise") << "🌐 Запрос к Sunrise-Sunset: https://api.sunrise-sunset.org" << fullUrl;
             
-            auto response = cli.Get(fullUrl.c_str(), headers);
-            if (response && response->status == 200) {
-                std::cout << "✅ Получен ответ от Sunrise-Sunset API" << std::endl;
-                std::cout << "   Полный ответ: " << response->body << std::endl;
+            auto response = UpstreamExecutor::get("api.sunrise-sunset.org", fullUrl, {{"Accept", "application/json"}},
+                                                   std::chrono::steady_clock::now() + std::chrono::seconds(10));
+            if (response.status == 200) {
+                LOG_DEBUG("Sunrise") << "✅ Получен ответ от Sunrise-Sunset API, размер: " << response.body.size() << " байт";
                 
-                // Парсим ответ: {"results":{"sunrise":"7:46:00 AM","sunset":"4:44:00 PM",...}}
+                // Парсим ответ: {"results":{"sunrise":"7:46:00 AM","sunset":"4:44:00 PM",...},"status":"OK"}
                 // С formatted=1 API возвращает время в локальном часовом поясе в формате "H:MM:SS AM/PM"
-                // Ищем внутри "results"
-                std::string resultsKey = "\"results\"";
-                size_t resultsPos = response->body.find(resultsKey);
-                if (resultsPos == std::string::npos) {
-                    std::cout << "⚠️  В ответе отсутствует объект 'results'" << std::endl;
-                    std::cout << "   Ответ: " << response->body << std::endl;
-                    return {"", ""};
+                std::string sunrise;
+                std::string sunset;
+                bool hasResults = false;
+                JsonReader reader(response.body);
+                if (reader.next() == JsonReader::Token::BeginObject) {
+                    reader.forEachMember([&](std::string_view key) {
+                        if (key != "results") return false;
+                        if (!reader.nextObject()) return true;
+                        hasResults = true;
+                        reader.forEachMember([&](std::string_view field) {
+                            if (field == "sunrise") sunrise = reader.nextString();
+                            else if (field == "sunset") sunset = reader.nextString();
+                            else return false;
+                            return true;
+                        });
+                        return true;
+                    });
                 }
-                
-                // Ищем открывающую скобку после "results"
-                resultsPos = response->body.find("{", resultsPos);
-                if (resultsPos == std::string::npos) {
-                    std::cout << "⚠️  Не найдена открывающая скобка после 'results'" << std::endl;
+                if (!hasResults || reader.failed()) {
+                    if (reader.failed()) {
+                        LOG_WARN("Sunrise").field("error", reader.error()).field("offset", reader.offset())
+                            << "⚠️ В ответе отсутствует объект 'results'";
+                    } else {
+                        LOG_WARN("Sunrise") << "⚠️ В ответе отсутствует объект 'results'";
+                    }
                     return {"", ""};
                 }
                 
-                // Извлекаем sunrise и sunset из results
-                std::string resultsJson = response->body.substr(resultsPos);
-                std::string sunrise = extractJsonValue(resultsJson, "sunrise");
-                std::string sunset = extractJsonValue(resultsJson, "sunset");
-                
-                std::cout << "   Извлечено из JSON - sunrise: '" << sunrise << "', sunset: '" << sunset << "'" << std::endl;
+                LOG_DEBUG("Sunrise") << "Извлечено из JSON - sunrise: '" << sunrise << "', sunset: '" << sunset << "'";
                 
                 // Конвертируем из формата "H:MM:SS AM/PM" в "HH:mm"
                 auto convertTo24Hour = [](const std::string& time12h) -> std::string {
@@ -556,57 +552,47 @@ int main(int argc, char* argv[]) {
                 sunrise = convertTo24Hour(sunrise);
                 sunset = convertTo24Hour(sunset);
                 
-                std::cout << "   Восход (локальное время): " << sunrise << ", Закат (локальное время): " << sunset << std::endl;
+                LOG_DEBUG("Sunrise") << "Восход (локальное время): " << sunrise << ", Закат (локальное время): " << sunset;
                 return {sunrise, sunset};
             } else {
-                std::cout << "❌ Ошибка подключения к Sunrise-Sunset API" << std::endl;
-                if (response) {
-                    std::cout << "   Статус: " << response->status << std::endl;
+                if (response.status != 0) {
+                    LOG_ERROR("Sunrise").field("status", response.status) << "❌ Ошибка подключения к Sunrise-Sunset API";
+                } else {
+                    LOG_ERROR("Sunrise").field("error", response.error) << "❌ Ошибка подключения к Sunrise-Sunset API";
                 }
             }
         } catch (const std::exception& e) {
-            std::cout << "❌ Исключение при запросе к Sunrise-Sunset API: " << e.what() << std::endl;
+            LOG_ERROR("Sunrise") << "❌ Исключение при запросе к Sunrise-Sunset API: " << e.what();
         }
         
         return {"", ""};
     };
     
-    std::cout << "🔌 [SERVER] Регистрация обработчика /api/prayer-times..." << std::endl;
-    std::cout.flush();
+    LOG_INFO("Server") << "🔌 Регистрация обработчика /api/prayer-times...";
     
-    // API: Получить время молитв из Aladhan API
-    server.Get("/api/prayer-times", [&httpGetAladhan, &extractJsonValue, &calculator, &setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
-        std::cout << "\n🕌🕌🕌 [API] ОБРАБОТЧИК ВЫЗВАН: /api/prayer-times 🕌🕌🕌" << std::endl;
-        std::cout << "   Метод: " << req.method << std::endl;
-        std::cout << "   Путь: " << req.path << std::endl;
-        std::cout << "   Версия: " << req.version << std::endl;
-        std::cout << "   Количество параметров: " << req.params.size() << std::endl;
-        std::cout.flush();  // Принудительно выводим логи
-        
+    // API: Получить время молитв (локальный расчет, Aladhan - только фоновая сверка)
+    server.Get("/api/prayer-times", [&prayerTimesService, &prayerTimesCache, &prayerTimesFlights, &setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
         setCorsHeaders(res);
         
-        // Отключаем кэширование ответа
-        res.set_header("Cache-Control", "no-cache, no-store, must-revalidate");
-        res.set_header("Pragma", "no-cache");
-        res.set_header("Expires", "0");
+        // Ошибки не кешируются; успешный ответ получает max-age и ETag ниже
+        auto setNoStore = [&res]() {
+            res.set_header("Cache-Control", "no-cache, no-store, must-revalidate");
+            res.set_header("Pragma", "no-cache");
+            res.set_header("Expires", "0");
+        };
         
         try {
         
         // Парсинг параметров
-        std::cout << "📋 [API] Парсинг параметров запроса..." << std::endl;
-        std::cout.flush();
-        
         std::map<std::string, std::string> params;
         for (const auto& param : req.params) {
             params[param.first] = param.second;
-            std::cout << "   Параметр: " << param.first << " = " << param.second << std::endl;
         }
-        std::cout.flush();
         
         // Получаем координаты
         if (params.find("lat") == params.end() || params.find("lon") == params.end()) {
-            std::cout << "❌ [API] Отсутствуют обязательные параметры lat/lon" << std::endl;
-            std::cout.flush();
+            LOG_INFO("API") << "❌ Отсутствуют обязательные параметры lat/lon";
+            setNoStore();
             res.status = 400;
             res.set_content("{\"success\": false, \"error\": \"lat and lon parameters are required\"}", "application/json");
             return;
@@ -616,50 +602,51 @@ int main(int argc, char* argv[]) {
         try {
             lat = std::stod(params["lat"]);
             lon = std::stod(params["lon"]);
-            std::cout << "✅ [API] Координаты: lat=" << lat << ", lon=" << lon << std::endl;
-            std::cout.flush();
         } catch (const std::exception& e) {
-            std::cout << "❌ [API] Ошибка парсинга координат: " << e.what() << std::endl;
-            std::cout.flush();
+            LOG_INFO("API") << "❌ Ошибка парсинга координат: " << e.what();
+            setNoStore();
+            res.status = 400;
+            res.set_content("{\"success\": false, \"error\": \"Invalid latitude or longitude\"}", "application/json");
+            return;
+        }
+        // NaN/inf и координаты вне диапазона дали бы произвольную ячейку кеша
+        if (!std::isfinite(lat) || !std::isfinite(lon) || std::fabs(lat) > 90.0 || std::fabs(lon) > 180.0) {
+            LOG_INFO("API") << "❌ Координаты вне диапазона: " << params["lat"] << ", " << params["lon"];
+            setNoStore();
             res.status = 400;
             res.set_content("{\"success\": false, \"error\": \"Invalid latitude or longitude\"}", "application/json");
             return;
         }
         
         std::string city = (params.find("city") != params.end()) ? params["city"] : "";
-        std::cout << "✅ [API] Город: " << city << std::endl;
-        std::cout.flush();
         
         // Получаем метод и мазхаб
         int method = 3; // Makkah по умолчанию
         int madhhab = 0; // Shafi'i по умолчанию
         
         if (params.find("method") != params.end()) {
-            try {
-                method = std::stoi(params["method"]);
-                std::cout << "✅ [API] Метод: " << method << std::endl;
-            } catch (const std::exception& e) {
-                std::cout << "⚠️  [API] Ошибка парсинга method, используем значение по умолчанию: 3" << std::endl;
-            }
+            try { method = std::stoi(params["method"]); } catch (const std::exception& e) {}
         }
-        std::cout.flush();
-        
         if (params.find("madhhab") != params.end()) {
-            try {
-                madhhab = std::stoi(params["madhhab"]);
-                std::cout << "✅ [API] Мазхаб: " << madhhab << std::endl;
-            } catch (const std::exception& e) {
-                std::cout << "⚠️  [API] Ошибка парсинга madhhab, используем значение по умолчанию: 0" << std::endl;
-            }
+            try { madhhab = std::stoi(params["madhhab"]); } catch (const std::exception& e) {}
         }
-        std::cout.flush();
-        
-        // Получаем дату
-        std::time_t t = std::time(nullptr);
-        std::tm* now = std::localtime(&t);
-        int year = now->tm_year + 1900;
-        int month = now->tm_mon + 1;
-        int day = now->tm_mday;
+        // Ключ кеша и расчет - по одним и тем же значениям: неизвестный метод считается как
+        // метод по умолчанию и должен попасть в его запись, а не в чужую (65536 -> int16_t 0)
+        method = CalculationMethods::normalizeMethod(method);
+        madhhab = CalculationMethods::normalizeMadhhab(madhhab);
+        
+        // Часовой пояс: параметр tz (зона IANA или часы от UTC), иначе по координатам
+        TimeZoneService::TimeZone timeZone = TimeZoneService::resolve(
+            params.find("tz") != params.end() ? params["tz"] : "", lat, lon);
+        
+        // Получаем дату (по умолчанию - сегодня в часовом поясе запроса)
+        const int64_t utcNow = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        const int64_t localNow = utcNow + static_cast<int64_t>(TimeZoneService::offsetHoursAt(timeZone, utcNow) * 3600.0);
+        const int64_t localDays = (localNow >= 0 ? localNow : localNow - 86399) / 86400;
+        int year, month, day;
+        PrayerTimesCalculator::civilFromDays(static_cast<int>(localDays), year, month, day);
+        double nowHours = (localNow - localDays * 86400) / 3600.0;
         
         if (params.find("year") != params.end()) {
             try { year = std::stoi(params["year"]); } catch (const std::exception& e) {}
@@ -670,123 +657,492 @@ int main(int argc, char* argv[]) {
         if (params.find("day") != params.end()) {
             try { day = std::stoi(params["day"]); } catch (const std::exception& e) {}
         }
-        
-        std::cout << "✅ [API] Дата: " << year << "-" << month << "-" << day << std::endl;
-        std::cout.flush();
-        
-        std::cout << "📡 [API] Параметры запроса: lat=" << lat << ", lon=" << lon 
-                  << ", city=" << city << ", method=" << method 
-                  << ", date=" << year << "-" << month << "-" << day << std::endl;
-        std::cout.flush();
-        
-        // Запрос к Aladhan API
-        std::cout << "📡 [API] Вызов httpGetAladhan..." << std::endl;
-        std::cout.flush();
-        
-        std::string apiResponse = httpGetAladhan(lat, lon, method, madhhab, year, month, day);
-        
-        std::cout << "📡 [API] Ответ от httpGetAladhan получен, размер: " << apiResponse.size() << " байт" << std::endl;
-        std::cout.flush();
-        
-        if (apiResponse.empty()) {
-            std::cout << "⚠️ [API] Пустой ответ от Aladhan API" << std::endl;
-            std::cout.flush();
-            res.status = 500;
-            res.set_content("{\"success\": false, \"error\": \"Failed to fetch prayer times from API\"}", "application/json");
+        // Год вне окна переполнил бы int в daysFromCivil, а результат стал бы ключом кешей
+        if (year < PrayerTimesCalculator::MIN_YEAR || year > PrayerTimesCalculator::MAX_YEAR ||
+            month < 1 || month > 12 || day < 1 || day > 31) {
+            LOG_INFO("API") << "❌ Дата вне диапазона: " << year << "-" << month << "-" << day;
+            setNoStore();
+            res.status = 400;
+            res.set_content("{\"success\": false, \"error\": \"Invalid date\"}", "application/json");
             return;
         }
         
-        // Парсим ответ от Aladhan API
-        // Формат: {"data":{"timings":{"Fajr":"05:30","Sunrise":"07:00",...}}}
-        std::cout << "📋 Парсинг ответа от Aladhan API для даты: " << year << "-" << month << "-" << day << std::endl;
-        std::cout << "   Координаты: " << lat << ", " << lon << std::endl;
-        std::cout << "   Первые 800 символов ответа: " << apiResponse.substr(0, 800) << std::endl;
-        
-        // Проверяем наличие ключевых полей в ответе
-        if (apiResponse.find("\"timings\"") == std::string::npos) {
-            std::cout << "⚠️  В ответе API отсутствует объект 'timings'!" << std::endl;
-            std::cout << "   Полный ответ: " << apiResponse << std::endl;
-        }
-        
-        std::string fajr = extractJsonValue(apiResponse, "Fajr");
-        std::string sunrise = extractJsonValue(apiResponse, "Sunrise");
-        std::string dhuhr = extractJsonValue(apiResponse, "Dhuhr");
-        std::string asr = extractJsonValue(apiResponse, "Asr");
-        std::string maghrib = extractJsonValue(apiResponse, "Maghrib");
-        std::string isha = extractJsonValue(apiResponse, "Isha");
-        
-        // НЕ используем Sunrise-Sunset API, так как он возвращает время в UTC, а не в локальном часовом поясе
-        // Aladhan API уже возвращает правильные времена в локальном часовом поясе
-        // Если нужно использовать Sunrise-Sunset API, нужно добавить конвертацию UTC -> локальное время
+        // Результат для ячейки сетки, даты, метода и часового пояса берется из кеша;
+        // при промахе - локальный расчет (чистая функция, блокировки не нужны)
+        const int requestDays = PrayerTimesCalculator::daysFromCivil(year, month, day);
+        const PrayerTimesCache::Key cacheKey = prayerTimesCache.makeKey(
+            lat, lon, requestDays, method, madhhab, timeZone.zone, timeZone.fixedHours);
+        std::shared_ptr<const PrayerTimesCache::Entry> entry = prayerTimesCache.find(cacheKey, utcNow);
+        
+        // Запись кеша для местной даты entryDays той же ячейки, метода и часового пояса
+        auto makeEntry = [&](int entryDays, bool sampleForVerify) -> std::shared_ptr<const PrayerTimesCache::Entry> {
+            PrayerTimesCalculator::Request request;
+            request.latitude = lat;
+            request.longitude = lon;
+            request.method = method;
+            request.madhhab = madhhab;
+            request.timezone = TimeZoneService::offsetHours(timeZone, entryDays);
+            PrayerTimesCalculator::civilFromDays(entryDays, request.year, request.month, request.day);
+            
+            PrayerTimesCalculator::Times result;
+            PrayerTimeline timeline = PrayerTimeline::build(request, result);
+            
+            std::map<std::string, std::string> times;
+            times["fajr"] = PrayerTimesCalculator::formatTime(result.fajr);
+            times["sunrise"] = PrayerTimesCalculator::formatTime(result.sunrise);
+            times["dhuhr"] = PrayerTimesCalculator::formatTime(result.dhuhr);
+            times["asr"] = PrayerTimesCalculator::formatTime(result.asr);
+            times["maghrib"] = PrayerTimesCalculator::formatTime(result.maghrib);
+            times["isha"] = PrayerTimesCalculator::formatTime(result.isha);
+            times["date"] = PrayerTimesCalculator::formatDate(request.year, request.month, request.day);
+            
+            // Часть результатов сверяется с Aladhan в фоне (очередь, без ожидания)
+            if (sampleForVerify) {
+                prayerTimesService.maybeVerify({lat, lon, method, madhhab, request.year, request.month, request.day, times});
+            }
+            
+            // Неизменяемая часть ответа сериализуется один раз на запись кеша
+            std::ostringstream body;
+            body << "    \"fajr\": \"" << times["fajr"] << "\",\n";
+            body << "    \"sunrise\": \"" << times["sunrise"] << "\",\n";
+            body << "    \"dhuhr\": \"" << times["dhuhr"] << "\",\n";
+            body << "    \"asr\": \"" << times["asr"] << "\",\n";
+            body << "    \"maghrib\": \"" << times["maghrib"] << "\",\n";
+            body << "    \"isha\": \"" << times["isha"] << "\",\n";
+            body << "    \"date\": \"" << times["date"] << "\",\n";
+            body << "    \"timezone\": \"" << TimeZoneService::name(timeZone) << "\",\n";
+            body << "    \"utcOffset\": " << request.timezone << ",\n";
+            body << "    \"source\": \"local\",\n";
+            
+            // Запись живет до конца своего дня, но не меньше чем до ближайшей местной полуночи
+            const int64_t utcOffsetSeconds = localNow - utcNow;
+            const int64_t expiresAt = (std::max<int64_t>(localDays, entryDays) + 1) * 86400 - utcOffsetSeconds;
+            return std::make_shared<const PrayerTimesCache::Entry>(
+                PrayerTimesCache::Entry{body.str(), timeline, expiresAt});
+        };
         
-        std::cout << "📊 Извлеченные времена:" << std::endl;
-        std::cout << "   Fajr: " << (fajr.empty() ? "(пусто)" : fajr) << std::endl;
-        std::cout << "   Sunrise: " << (sunrise.empty() ? "(пусто)" : sunrise) << std::endl;
-        std::cout << "   Dhuhr: " << (dhuhr.empty() ? "(пусто)" : dhuhr) << std::endl;
-        std::cout << "   Asr: " << (asr.empty() ? "(пусто)" : asr) << std::endl;
-        std::cout << "   Maghrib: " << (maghrib.empty() ? "(пусто)" : maghrib) << std::endl;
-        std::cout << "   Isha: " << (isha.empty() ? "(пусто)" : isha) << std::endl;
+        // Промах по ячейке означает, что место появилось впервые (или сменился месяц): весь месяц
+        // запрошенной даты (в последние дни - и следующий) считается сразу, чтобы навигация
+        // по календарю попадала в кеш. Месяц - около 0.1 мс расчета, поэтому без фонового потока
+        auto computeMonth = [&]() -> std::shared_ptr<const PrayerTimesCache::Entry> {
+            auto requested = makeEntry(requestDays, true);
+            prayerTimesCache.insert(cacheKey, requested);
+            if (!prayerTimesCache.enabled() || month < 1 || month > 12) return requested;
+            
+            const int monthStart = PrayerTimesCalculator::daysFromCivil(year, month, 1);
+            const int monthEnd = month == 12 ? PrayerTimesCalculator::daysFromCivil(year + 1, 1, 1)
+                                             : PrayerTimesCalculator::daysFromCivil(year, month + 1, 1);
+            if (requestDays < monthStart || requestDays >= monthEnd) return requested;  // День вне месяца (day=40)
+            
+            constexpr int prefetchDays = 3;
+            int prefillEnd = monthEnd;
+            if (requestDays + prefetchDays >= monthEnd) {
+                int nextYear = month == 12 ? year + 1 : year;
+                int nextMonth = month == 12 ? 1 : month + 1;
+                prefillEnd = nextMonth == 12 ? PrayerTimesCalculator::daysFromCivil(nextYear + 1, 1, 1)
+                                             : PrayerTimesCalculator::daysFromCivil(nextYear, nextMonth + 1, 1);
+            }
+            for (int days = monthStart; days < prefillEnd; ++days) {
+                if (days == requestDays) continue;
+                prayerTimesCache.insert(
+                    prayerTimesCache.makeKey(lat, lon, days, method, madhhab, timeZone.zone, timeZone.fixedHours),
+                    makeEntry(days, false));
+            }
+            return requested;
+        };
         
-        // Проверяем, что все времена извлечены
-        if (fajr.empty() || sunrise.empty() || dhuhr.empty() || asr.empty() || maghrib.empty() || isha.empty()) {
-            std::cout << "⚠️  Не все времена молитв извлечены из ответа API!" << std::endl;
+        if (!entry) {
+            // Одновременные промахи по одному ключу (смена дня в популярном городе) считаются один раз
+            auto shared = prayerTimesFlights.run(cacheKey, std::chrono::milliseconds(2000), computeMonth);
+            entry = shared ? *shared : computeMonth();
         }
         
-        // Форматируем дату
-        std::ostringstream dateStream;
-        dateStream << std::setfill('0') << std::setw(2) << day << "."
-                   << std::setw(2) << month << "." << year;
+        const int32_t nowSecond = static_cast<int32_t>(std::floor(nowHours * 3600.0));
+        const PrayerTimeline::Position position = entry->timeline.locate(nowSecond);
         
-        // Устанавливаем местоположение для определения текущей/следующей молитвы
-        calculator.setLocation(lat, lon, city);
-        calculator.setDate(year, month, day);
+        // Таблица дня не меняется до местной полуночи. Текущая/следующая молитва - до
+        // ближайшего события шкалы; current=0 отдает только таблицу дня (календарь, кеш SW)
+        const bool withCurrent = params.find("current") == params.end() || params["current"] != "0";
+        // upcoming=N - еще N ближайших событий (до конца завтрашнего дня), вместе с текущей молитвой
+        size_t upcomingCount = 0;
+        if (withCurrent && params.find("upcoming") != params.end()) {
+            try {
+                upcomingCount = static_cast<size_t>(std::clamp(std::stoi(params["upcoming"]), 0,
+                                                               static_cast<int>(PrayerTimeline::MAX_EVENTS)));
+            } catch (const std::exception& e) {}
+        }
+        int64_t maxAge = (localDays + 1) * 86400 - localNow;
+        if (withCurrent) maxAge = std::min<int64_t>(maxAge, position.secondsUntilNext);
+        maxAge = std::max<int64_t>(maxAge, 0);
+        
+        // ETag по ключу кеша (ячейка, дата, метод, мазхаб, часовой пояс) и готовому фрагменту
+        // времен: тот же адрес получает тот же ETag до смены дня. С текущей молитвой ETag
+        // слабый: secondsUntilNext меняется каждую секунду, а смысл ответа - только на событии
+        uint64_t bodyHash = 1469598103934665603ull;  // FNV-1a
+        for (unsigned char c : entry->body) bodyHash = (bodyHash ^ c) * 1099511628211ull;
+        std::ostringstream etag;
+        etag << (withCurrent ? "W/\"" : "\"") << std::hex
+             << PrayerTimesCache::KeyHash()(cacheKey) << "-" << bodyHash;
+        if (withCurrent) etag << "-" << static_cast<int>(position.current.prayer);
+        etag << "\"";
+        
+        res.set_header("ETag", etag.str());
+        res.set_header("Cache-Control", "public, max-age=" + std::to_string(maxAge));
+        if (req.has_header("If-None-Match") &&
+            StaticAssets::matchesEtag(req.get_header_value("If-None-Match"), etag.str())) {
+            res.status = 304;
+            return;
+        }
         
-        // Формируем JSON ответ
+        // Формируем JSON ответ: готовый фрагмент + поля конкретного запроса
         std::ostringstream json;
         json << "{\n";
         json << "  \"success\": true,\n";
         json << "  \"data\": {\n";
-        json << "    \"fajr\": \"" << fajr << "\",\n";
-        json << "    \"sunrise\": \"" << sunrise << "\",\n";
-        json << "    \"dhuhr\": \"" << dhuhr << "\",\n";
-        json << "    \"asr\": \"" << asr << "\",\n";
-        json << "    \"maghrib\": \"" << maghrib << "\",\n";
-        json << "    \"isha\": \"" << isha << "\",\n";
-        json << "    \"date\": \"" << dateStream.str() << "\",\n";
+        json << entry->body;
         json << "    \"city\": \"" << city << "\",\n";
         json << "    \"latitude\": " << lat << ",\n";
-        json << "    \"longitude\": " << lon << ",\n";
-        json << "    \"currentPrayer\": \"" << calculator.getCurrentPrayer() << "\",\n";
-        json << "    \"nextPrayer\": \"" << calculator.getNextPrayer() << "\"\n";
+        json << "    \"longitude\": " << lon;
+        if (withCurrent) {
+            json << ",\n";
+            json << "    \"currentPrayer\": \"" << PrayerTimesCalculator::prayerName(position.current.prayer) << "\",\n";
+            json << "    \"nextPrayer\": \"" << PrayerTimesCalculator::prayerName(position.next.prayer) << "\",\n";
+            json << "    \"secondsUntilNext\": " << position.secondsUntilNext;
+            if (upcomingCount > 0) {
+                // dayOffset: 0 - сегодня, 1 - завтра (Иша после полуночи - тоже завтра)
+                PrayerTimeline::Event events[PrayerTimeline::MAX_EVENTS];
+                const size_t count = entry->timeline.upcoming(nowSecond, events, upcomingCount);
+                json << ",\n    \"upcoming\": [";
+                for (size_t i = 0; i < count; ++i) {
+                    const int32_t dayOffset = events[i].second / 86400;
+                    json << (i > 0 ? ", " : "") << "{\"prayer\": \"" << PrayerTimesCalculator::prayerName(events[i].prayer)
+                         << "\", \"time\": \"" << PrayerTimesCalculator::formatTime((events[i].second - dayOffset * 86400) / 3600.0)
+                         << "\", \"dayOffset\": " << dayOffset
+                         << ", \"secondsUntil\": " << events[i].second - nowSecond << "}";
+                }
+                json << "]";
+            }
+        }
+        json << "\n";
         json << "  }\n";
         json << "}";
         
-        std::string jsonResponse = json.str();
-        std::cout << "✅ [API] JSON ответ сформирован, размер: " << jsonResponse.size() << " байт" << std::endl;
-        std::cout.flush();
-        
-        res.set_content(jsonResponse, "application/json");
-        
-        std::cout << "✅ [API] Ответ установлен, статус: " << res.status << std::endl;
-        std::cout.flush();
+        res.set_content(json.str(), "application/json");
         } catch (const std::exception& e) {
-            std::cerr << "❌ Ошибка обработки запроса /api/prayer-times: " << e.what() << std::endl;
+            LOG_ERROR("API") << "❌ Ошибка обработки запроса /api/prayer-times: " << e.what();
+            setNoStore();
             res.status = 500;
             std::ostringstream errorJson;
             errorJson << "{\"success\": false, \"error\": \"Internal server error: " << e.what() << "\"}";
             res.set_content(errorJson.str(), "application/json");
         } catch (...) {
-            std::cerr << "❌ Неизвестная ошибка при обработке запроса /api/prayer-times" << std::endl;
+            LOG_ERROR("API") << "❌ Неизвестная ошибка при обработке запроса /api/prayer-times";
+            setNoStore();
             res.status = 500;
             res.set_content("{\"success\": false, \"error\": \"Internal server error\"}", "application/json");
         }
     });
     
-    // API: Поиск городов через Nominatim (OpenStreetMap)
-    server.Get("/api/cities/search", [&setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
-        std::cout << "🔍 API запрос: /api/cities/search" << std::endl;
+    // API: Статистика кеша времени молитв
+    server.Get("/api/cache/stats", [&prayerTimesCache, &prayerTimesFlights, &setCorsHeaders](const httplib::Request& /*req*/, httplib::Response& res) {
+        setCorsHeaders(res);
+        
+        const PrayerTimesCache::Stats stats = prayerTimesCache.stats();
+        const uint64_t lookups = stats.hits + stats.misses;
+        const auto flights = prayerTimesFlights.stats();
+        
+        std::ostringstream json;
+        json << "{\n";
+        json << "  \"success\": true,\n";
+        json << "  \"data\": {\n";
+        json << "    \"enabled\": " << (prayerTimesCache.enabled() ? "true" : "false") << ",\n";
+        json << "    \"cellDegrees\": " << stats.cellDegrees << ",\n";
+        json << "    \"entries\": " << stats.entries << ",\n";
+        json << "    \"bytes\": " << stats.bytes << ",\n";
+        json << "    \"capacityBytes\": " << stats.capacityBytes << ",\n";
+        json << "    \"hits\": " << stats.hits << ",\n";
+        json << "    \"misses\": " << stats.misses << ",\n";
+        json << "    \"hitRate\": " << (lookups > 0 ? static_cast<double>(stats.hits) / lookups : 0.0) << ",\n";
+        json << "    \"insertions\": " << stats.insertions << ",\n";
+        json << "    \"evictions\": " << stats.evictions << ",\n";
+        json << "    \"expirations\": " << stats.expirations << ",\n";
+        json << "    \"computations\": " << flights.calls << ",\n";
+        json << "    \"coalesced\": " << flights.coalesced << "\n";
+        json << "  }\n";
+        json << "}";
+        res.set_content(json.str(), "application/json");
+    });
+
+    // API: Пути статических файлов с отпечатком содержимого (для Service Worker)
+    server.Get("/api/assets/manifest", [&setCorsHeaders](const httplib::Request& /*req*/, httplib::Response& res) {
+        setCorsHeaders(res);
+
+        std::ostringstream json;
+        json << "{\n";
+        json << "  \"success\": true,\n";
+        json << "  \"data\": {\n";
+        json << "    \"files\": " << StaticAssets::count() << ",\n";
+        json << "    \"assets\": " << StaticAssets::manifestJson() << "\n";
+        json << "  }\n";
+        json << "}";
+        res.set_header("Cache-Control", "no-cache");
+        res.set_content(json.str(), "application/json");
+    });
+
+    // API: Состояние внешних API: пул соединений и автомат защиты
+    server.Get("/api/upstreams", [&setCorsHeaders](const httplib::Request& /*req*/, httplib::Response& res) {
+        setCorsHeaders(res);
+        
+        std::ostringstream json;
+        json << "{\n";
+        json << "  \"success\": true,\n";
+        json << "  \"data\": [";
+        bool first = true;
+        for (const auto& host : UpstreamPool::stats()) {
+            json << (first ? "\n" : ",\n");
+            first = false;
+            json << "    {\"host\": \"" << host.host << "\", ";
+            json << "\"address\": \"" << host.address << "\", ";
+            json << "\"breaker\": \"" << UpstreamPool::breakerStateName(host.breaker) << "\", ";
+            json << "\"trips\": " << host.trips << ", ";
+            json << "\"rejected\": " << host.rejected << ", ";
+            json << "\"saturated\": " << host.saturated << ", ";
+            json << "\"errorRate\": " << host.errorRate << ", ";
+            json << "\"healthy\": " << (host.healthy ? "true" : "false") << ", ";
+            json << "\"idle\": " << host.idle << ", ";
+            json << "\"leased\": " << host.leased << ", ";
+            json << "\"created\": " << host.created << ", ";
+            json << "\"reused\": " << host.reused << ", ";
+            json << "\"failures\": " << host.failures << ", ";
+            const UpstreamExecutor::HostStats executor = UpstreamExecutor::stats(host.host);
+            json << "\"inFlight\": " << executor.inFlight << ", ";
+            json << "\"queued\": " << executor.queued << ", ";
+            json << "\"expiredInQueue\": " << executor.expired << ", ";
+            json << "\"rejectedQueueFull\": " << executor.rejected << "}";
+        }
+        json << "\n  ]\n";
+        json << "}";
+        res.set_content(json.str(), "application/json");
+    });
+    
+    // API: Время молитв за диапазон дат (месяц или год одним запросом)
+    // Параметры: lat, lon, method, madhhab, tz и from/to (YYYY-MM-DD) либо year[&month]
+    server.Get("/api/prayer-times/range", [&setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
         setCorsHeaders(res);
         
+        if (!req.has_param("lat") || !req.has_param("lon")) {
+            res.status = 400;
+            res.set_content("{\"success\": false, \"error\": \"lat and lon parameters are required\"}", "application/json");
+            return;
+        }
+        
+        double lat, lon;
+        try {
+            lat = std::stod(req.get_param_value("lat"));
+            lon = std::stod(req.get_param_value("lon"));
+        } catch (const std::exception& e) {
+            res.status = 400;
+            res.set_content("{\"success\": false, \"error\": \"Invalid latitude or longitude\"}", "application/json");
+            return;
+        }
+        if (!std::isfinite(lat) || !std::isfinite(lon) || std::fabs(lat) > 90.0 || std::fabs(lon) > 180.0) {
+            res.status = 400;
+            res.set_content("{\"success\": false, \"error\": \"Invalid latitude or longitude\"}", "application/json");
+            return;
+        }
+        
+        int method = 3; // Makkah по умолчанию
+        int madhhab = 0; // Shafi'i по умолчанию
+        if (req.has_param("method")) {
+            try { method = std::stoi(req.get_param_value("method")); } catch (const std::exception& e) {}
+        }
+        if (req.has_param("madhhab")) {
+            try { madhhab = std::stoi(req.get_param_value("madhhab")); } catch (const std::exception& e) {}
+        }
+        // В ответе - метод и мазхаб, по которым действительно идет расчет
+        method = CalculationMethods::normalizeMethod(method);
+        madhhab = CalculationMethods::normalizeMadhhab(madhhab);
+        // Часовой пояс: параметр tz (зона IANA или часы от UTC), иначе по координатам;
+        // смещение берется на каждый день, с учетом перехода на летнее время
+        TimeZoneService::TimeZone timeZone = TimeZoneService::resolve(
+            req.has_param("tz") ? req.get_param_value("tz") : "", lat, lon);
+        
+        // "YYYY-MM-DD" -> дни от 1970-01-01; false для некорректной даты
+        auto parseDate = [](const std::string& value, int& days) -> bool {
+            int y = 0, m = 0, d = 0;
+            if (std::sscanf(value.c_str(), "%d-%d-%d", &y, &m, &d) != 3) return false;
+            if (y < PrayerTimesCalculator::MIN_YEAR || y > PrayerTimesCalculator::MAX_YEAR) return false;
+            if (m < 1 || m > 12 || d < 1 || d > 31) return false;
+            days = PrayerTimesCalculator::daysFromCivil(y, m, d);
+            int cy, cm, cd;
+            PrayerTimesCalculator::civilFromDays(days, cy, cm, cd);
+            return cy == y && cm == m && cd == d;
+        };
+        
+        int fromDays = 0;
+        int toDays = 0;
+        if (req.has_param("from") && req.has_param("to")) {
+            if (!parseDate(req.get_param_value("from"), fromDays) || !parseDate(req.get_param_value("to"), toDays)) {
+                res.status = 400;
+                res.set_content("{\"success\": false, \"error\": \"from and to must be dates in YYYY-MM-DD format\"}", "application/json");
+                return;
+            }
+        } else if (req.has_param("year")) {
+            int year = 0;
+            int month = 0;
+            try {
+                year = std::stoi(req.get_param_value("year"));
+                if (req.has_param("month")) month = std::stoi(req.get_param_value("month"));
+            } catch (const std::exception& e) {
+                month = -1;
+            }
+            if (month < 0 || month > 12 ||
+                year < PrayerTimesCalculator::MIN_YEAR || year > PrayerTimesCalculator::MAX_YEAR) {
+                res.status = 400;
+                res.set_content("{\"success\": false, \"error\": \"Invalid year or month\"}", "application/json");
+                return;
+            }
+            if (month == 0) {
+                // Весь год
+                fromDays = PrayerTimesCalculator::daysFromCivil(year, 1, 1);
+                toDays = PrayerTimesCalculator::daysFromCivil(year + 1, 1, 1) - 1;
+            } else {
+                // Весь месяц
+                fromDays = PrayerTimesCalculator::daysFromCivil(year, month, 1);
+                toDays = (month == 12 ? PrayerTimesCalculator::daysFromCivil(year + 1, 1, 1)
+                                      : PrayerTimesCalculator::daysFromCivil(year, month + 1, 1)) - 1;
+            }
+        } else {
+            res.status = 400;
+            res.set_content("{\"success\": false, \"error\": \"from/to or year parameters are required\"}", "application/json");
+            return;
+        }
+        
+        const int maxRangeDays = 366;
+        if (toDays < fromDays || toDays - fromDays + 1 > maxRangeDays) {
+            res.status = 400;
+            res.set_content("{\"success\": false, \"error\": \"Date range must contain 1 to 366 days\"}", "application/json");
+            return;
+        }
+        
+        // Все, что не зависит от даты (параметры метода), считается один раз на весь диапазон
+        struct RangeState {
+            SolarBatch::Parameters parameters;
+            double latitude;
+            double longitude;
+            TimeZoneService::TimeZone timeZone;
+            int nextDay;
+            int lastDay;
+            bool firstRow;
+            std::string header;
+            std::unique_ptr<ResponseCompression::Stream> compressor;  // Части сжимаются по мере отдачи
+        };
+        auto state = std::make_shared<RangeState>();
+        state->parameters = SolarBatch::parametersFor(method, madhhab);
+        state->latitude = lat;
+        state->longitude = lon;
+        state->timeZone = timeZone;
+        state->nextDay = fromDays;
+        state->lastDay = toDays;
+        state->firstRow = true;
+        
+        auto isoDate = [](int days) {
+            int y, m, d;
+            PrayerTimesCalculator::civilFromDays(days, y, m, d);
+            std::ostringstream out;
+            out << std::setfill('0') << std::setw(4) << y << "-" << std::setw(2) << m << "-" << std::setw(2) << d;
+            return out.str();
+        };
+        
+        std::ostringstream header;
+        header << "{\n";
+        header << "  \"success\": true,\n";
+        header << "  \"data\": {\n";
+        header << "    \"from\": \"" << isoDate(fromDays) << "\",\n";
+        header << "    \"to\": \"" << isoDate(toDays) << "\",\n";
+        header << "    \"latitude\": " << lat << ",\n";
+        header << "    \"longitude\": " << lon << ",\n";
+        header << "    \"method\": " << method << ",\n";
+        header << "    \"madhhab\": " << madhhab << ",\n";
+        header << "    \"timezone\": \"" << TimeZoneService::name(timeZone) << "\",\n";
+        header << "    \"source\": \"local\",\n";
+        header << "    \"days\": [";
+        state->header = header.str();
+        
+        // Размер ответа заранее неизвестен: оценка по числу дней (~150 байт на строку)
+        const ResponseCompression::Encoding encoding = ResponseCompression::choose(
+            req, state->header.size() + static_cast<size_t>(toDays - fromDays + 1) * 150);
+        if (encoding != ResponseCompression::Encoding::Identity) {
+            state->compressor = std::make_unique<ResponseCompression::Stream>(encoding);
+            res.set_header("Content-Encoding", ResponseCompression::name(encoding));
+        }
+        res.set_header("Vary", "Accept-Encoding");
+        
+        // Строки отдаются частями (chunked), не собирая весь год в одну строку
+        res.set_chunked_content_provider("application/json", [state](size_t /*offset*/, httplib::DataSink& sink) {
+            constexpr int rowsPerChunk = 32;
+            std::string chunk = std::move(state->header);
+            state->header.clear();
+            
+            // Дни блока считаются одним пакетом SolarBatch (SIMD)
+            const int count = std::min(rowsPerChunk, state->lastDay - state->nextDay + 1);
+            double julianDays[rowsPerChunk];
+            double latitudes[rowsPerChunk];
+            double longitudes[rowsPerChunk];
+            double timezones[rowsPerChunk];
+            double fajr[rowsPerChunk], sunrise[rowsPerChunk], dhuhr[rowsPerChunk];
+            double asr[rowsPerChunk], maghrib[rowsPerChunk], isha[rowsPerChunk];
+            for (int i = 0; i < count; ++i) {
+                julianDays[i] = PrayerTimesCalculator::julianDayFromDays(state->nextDay + i);
+                latitudes[i] = state->latitude;
+                longitudes[i] = state->longitude;
+                timezones[i] = TimeZoneService::offsetHours(state->timeZone, state->nextDay + i);
+            }
+            SolarBatch::Input input{julianDays, latitudes, longitudes, timezones, static_cast<size_t>(count)};
+            SolarBatch::Output output{fajr, sunrise, dhuhr, asr, maghrib, isha};
+            SolarBatch::compute(input, state->parameters, output);
+            
+            for (int i = 0; i < count; ++i, ++state->nextDay) {
+                int y, m, d;
+                PrayerTimesCalculator::civilFromDays(state->nextDay, y, m, d);
+                
+                chunk += state->firstRow ? "\n" : ",\n";
+                state->firstRow = false;
+                chunk += "      {\"date\": \"" + PrayerTimesCalculator::formatDate(y, m, d) + "\"";
+                chunk += ", \"fajr\": \"" + PrayerTimesCalculator::formatTime(fajr[i]) + "\"";
+                chunk += ", \"sunrise\": \"" + PrayerTimesCalculator::formatTime(sunrise[i]) + "\"";
+                chunk += ", \"dhuhr\": \"" + PrayerTimesCalculator::formatTime(dhuhr[i]) + "\"";
+                chunk += ", \"asr\": \"" + PrayerTimesCalculator::formatTime(asr[i]) + "\"";
+                chunk += ", \"maghrib\": \"" + PrayerTimesCalculator::formatTime(maghrib[i]) + "\"";
+                chunk += ", \"isha\": \"" + PrayerTimesCalculator::formatTime(isha[i]) + "\"}";
+            }
+            
+            const bool last = state->nextDay > state->lastDay;
+            if (last) chunk += "\n    ]\n  }\n}";
+            if (state->compressor) {
+                std::string compressed;
+                if (!state->compressor->write(chunk, compressed) || (last && !state->compressor->finish(compressed))) {
+                    return false;
+                }
+                chunk.swap(compressed);
+            }
+            
+            if (last) {
+                sink.write(chunk.data(), chunk.size());
+                sink.done();
+                return true;
+            }
+            
+            return sink.write(chunk.data(), chunk.size());
+        });
+    });
+    
+    // API: Поиск городов (офлайн-индекс GeoNames, запасной вариант - Nominatim)
+    server.Get("/api/cities/search", [&setCorsHeaders, nominatimFallback](const httplib::Request& req, httplib::Response& res) {
+        setCorsHeaders(res);
+        // Дедлайн обработчика передается в исполнитель внешних запросов и дальше в пул соединений
+        const auto deadline = std::chrono::steady_clock::now() + CitySearchService::REQUEST_TIMEOUT;
+        
         // Получаем параметр запроса
         std::string query;
         if (req.has_param("q")) {
@@ -795,10 +1151,10 @@ int main(int argc, char* argv[]) {
             query = req.get_param_value("query");
         }
         
-        std::cout << "📝 Параметр запроса: \"" << query << "\"" << std::endl;
+        LOG_DEBUG("Cities") << "🔍 Поиск городов: \"" << query << "\"";
         
         if (query.empty() || query.length() < 2) {
-            std::cout << "⚠️  Запрос слишком короткий или пустой" << std::endl;
+            LOG_DEBUG("Cities") << "⚠️ Запрос слишком короткий или пустой";
             res.status = 400;
             res.set_content("{\"success\": false, \"error\": \"Query must be at least 2 characters\"}", "application/json");
             return;
@@ -812,61 +1168,74 @@ int main(int argc, char* argv[]) {
                 if (limit < 1) limit = 1;
                 if (limit > 50) limit = 50; // Nominatim ограничивает до 50
             } catch (const std::exception& e) {
-                std::cout << "⚠️  Некорректный лимит, используем значение по умолчанию: 20" << std::endl;
+                LOG_DEBUG("Cities") << "⚠️ Некорректный лимит, используем значение по умолчанию: 20";
                 limit = 20;
             }
         }
         
-        std::cout << "📊 Лимит результатов: " << limit << std::endl;
-        
-        // Формируем параметры для Nominatim
-        std::map<std::string, std::string> params;
-        params["q"] = query;
-        params["format"] = "json";
-        params["limit"] = std::to_string(limit);
-        params["addressdetails"] = "1";
-        params["extratags"] = "1";
-        params["accept-language"] = "ru,en";
-        
-        std::cout << "🌐 Отправка запроса к Nominatim..." << std::endl;
+        LOG_DEBUG("Cities") << "📊 Лимит результатов: " << limit;
         
-        // Делаем запрос к Nominatim
-        std::string responseBody = CitySearchService::searchCities(query, limit);
+        // Сначала офлайн-индекс: без сети и без общей очереди политики Nominatim (1 запрос/с)
+        std::string responseBody = CitySearchService::searchOffline(query, limit);
+        const bool haveOffline = !responseBody.empty();
+        std::string source = "offline";
         
-        if (responseBody.empty()) {
-            std::cout << "❌ Пустой ответ от Nominatim" << std::endl;
-            res.status = 500;
-            res.set_content("{\"success\": false, \"error\": \"Failed to fetch cities from external API\"}", "application/json");
+        if ((!haveOffline || responseBody == "[]") && nominatimFallback) {
+            LOG_DEBUG("Cities") << "🌐 Отправка запроса к Nominatim...";
+            std::string nominatimBody = CitySearchService::searchCities(query, limit, deadline);
+            
+            if (!nominatimBody.empty()) {
+                responseBody = nominatimBody;
+                source = "nominatim";
+            } else if (!haveOffline && !CitySearchService::isAvailable()) {
+                LOG_WARN("Cities") << "🔴 Nominatim отключен автоматом защиты, запрос не отправлялся";
+                res.status = 503;
+                res.set_header("Retry-After", "30");
+                res.set_content("{\"success\": false, \"error\": \"City search is temporarily unavailable\"}", "application/json");
+                return;
+            } else if (!haveOffline) {
+                LOG_ERROR("Cities") << "❌ Пустой ответ от Nominatim";
+                res.status = 500;
+                res.set_content("{\"success\": false, \"error\": \"Failed to fetch cities from external API\"}", "application/json");
+                return;
+            }
+        } else if (!haveOffline) {
+            LOG_WARN("Cities") << "⚠️ Индекс городов не загружен, а Nominatim отключен (CITY_SEARCH_FALLBACK=0)";
+            res.status = 503;
+            res.set_content("{\"success\": false, \"error\": \"City search is unavailable\"}", "application/json");
             return;
         }
         
-        // Проверяем, что ответ валидный JSON (начинается с [ или {)
-        if (responseBody.empty() || (responseBody[0] != '[' && responseBody[0] != '{')) {
-            std::cout << "⚠️  Некорректный формат ответа от Nominatim" << std::endl;
+        // Ответ вставляется в наш JSON как есть, поэтому он проверяется целиком за один проход
+        size_t cityCount = 0;
+        if (!JsonReader::valid(responseBody, &cityCount) || responseBody[0] != '[') {
+            LOG_WARN("Cities") << "⚠️ Некорректный формат ответа (" << source << ")";
             res.status = 500;
             res.set_content("{\"success\": false, \"error\": \"Invalid response format from external API\"}", "application/json");
             return;
         }
         
-        // Возвращаем ответ от Nominatim в формате, который ожидает фронтенд
+        // Офлайн-индекс отдает массив в формате Nominatim, фронтенд разбирает оба одинаково
         std::ostringstream json;
         json << "{\n";
         json << "  \"success\": true,\n";
-        json << "  \"query\": \"" << query << "\",\n";
+        json << "  \"query\": \"" << JsonService::escapeJsonString(query) << "\",\n";
+        json << "  \"source\": \"" << source << "\",\n";
         json << "  \"data\": {\n";
         json << "    \"cities\": " << responseBody << "\n";
         json << "  }\n";
         json << "}";
         
         std::string jsonResponse = json.str();
-        std::cout << "✅ Отправка ответа клиенту, размер: " << jsonResponse.size() << " байт" << std::endl;
+        LOG_DEBUG("Cities") << "✅ Отправка ответа клиенту: городов " << cityCount << ", размер " << jsonResponse.size() << " байт";
         
         res.set_content(jsonResponse, "application/json");
     });
     
-    // API: Получить город по координатам через Nominatim (обратное геокодирование)
-    server.Get("/api/cities/nearest", [&setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
+    // API: Получить город по координатам (офлайн-индекс, запасной вариант - Nominatim /reverse)
+    server.Get("/api/cities/nearest", [&setCorsHeaders, nominatimFallback](const httplib::Request& req, httplib::Response& res) {
         setCorsHeaders(res);
+        const auto deadline = std::chrono::steady_clock::now() + CitySearchService::REQUEST_TIMEOUT;
         
         if (!req.has_param("lat") || !req.has_param("lon")) {
             res.status = 400;
@@ -878,27 +1247,43 @@ int main(int argc, char* argv[]) {
             double lat = std::stod(req.get_param_value("lat"));
             double lon = std::stod(req.get_param_value("lon"));
             
-            // Формируем параметры для обратного геокодирования
-            std::map<std::string, std::string> params;
-            params["lat"] = std::to_string(lat);
-            params["lon"] = std::to_string(lon);
-            params["format"] = "json";
-            params["addressdetails"] = "1";
-            params["accept-language"] = "ru,en";
+            // Сначала сетка офлайн-индекса: геолокация браузера не расходует квоту Nominatim
+            std::string responseBody = CitySearchService::nearestOffline(lat, lon);
+            std::string source = "offline";
             
-            // Делаем запрос к Nominatim через сервис
-            std::string responseBody = CitySearchService::findNearestCity(lat, lon);
+            if (responseBody.empty() && nominatimFallback) {
+                responseBody = CitySearchService::findNearestCity(lat, lon, deadline);
+                source = "nominatim";
+                
+                if (responseBody.empty() && !CitySearchService::isAvailable()) {
+                    res.status = 503;
+                    res.set_header("Retry-After", "30");
+                    res.set_content("{\"success\": false, \"error\": \"City lookup is temporarily unavailable\"}", "application/json");
+                    return;
+                }
+                
+                if (responseBody.empty()) {
+                    res.status = 500;
+                    res.set_content("{\"success\": false, \"error\": \"Failed to fetch city from external API\"}", "application/json");
+                    return;
+                }
+            } else if (responseBody.empty()) {
+                res.status = 404;
+                res.set_content("{\"success\": false, \"error\": \"No city found nearby\"}", "application/json");
+                return;
+            }
             
-            if (responseBody.empty()) {
+            if (!JsonReader::valid(responseBody)) {
+                LOG_WARN("Cities") << "⚠️ Некорректный формат ответа (" << source << ")";
                 res.status = 500;
-                res.set_content("{\"success\": false, \"error\": \"Failed to fetch city from external API\"}", "application/json");
+                res.set_content("{\"success\": false, \"error\": \"Invalid response format from external API\"}", "application/json");
                 return;
             }
             
-            // Возвращаем ответ от Nominatim
             std::ostringstream json;
             json << "{\n";
             json << "  \"success\": true,\n";
+            json << "  \"source\": \"" << source << "\",\n";
             json << "  \"data\": " << responseBody << "\n";
             json << "}";
             
@@ -909,6 +1294,51 @@ int main(int argc, char* argv[]) {
         }
     });
     
+    // API: Города в радиусе от точки (только офлайн-индекс), по возрастанию расстояния
+    server.Get("/api/cities/nearby", [&setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
+        setCorsHeaders(res);
+        
+        if (!req.has_param("lat") || !req.has_param("lon")) {
+            res.status = 400;
+            res.set_content("{\"success\": false, \"error\": \"lat and lon parameters are required\"}", "application/json");
+            return;
+        }
+        
+        double lat = 0.0;
+        double lon = 0.0;
+        double radiusKm = 50.0;
+        int limit = 20;
+        try {
+            lat = std::stod(req.get_param_value("lat"));
+            lon = std::stod(req.get_param_value("lon"));
+            if (req.has_param("radius")) radiusKm = std::stod(req.get_param_value("radius"));
+            if (req.has_param("limit")) limit = std::stoi(req.get_param_value("limit"));
+        } catch (const std::exception& e) {
+            res.status = 400;
+            res.set_content("{\"success\": false, \"error\": \"Invalid parameters\"}", "application/json");
+            return;
+        }
+        radiusKm = std::clamp(radiusKm, 0.0, 500.0);
+        limit = std::clamp(limit, 1, 100);
+        
+        std::string cities = CitySearchService::nearbyOffline(lat, lon, radiusKm, limit);
+        if (cities.empty()) {
+            res.status = 503;
+            res.set_content("{\"success\": false, \"error\": \"City index is not loaded\"}", "application/json");
+            return;
+        }
+        
+        std::ostringstream json;
+        json << "{\n";
+        json << "  \"success\": true,\n";
+        json << "  \"radius_km\": " << radiusKm << ",\n";
+        json << "  \"data\": {\n";
+        json << "    \"cities\": " << cities << "\n";
+        json << "  }\n";
+        json << "}";
+        res.set_content(json.str(), "application/json");
+    });
+    
     // API: Установить местоположение
     server.Post("/api/location", [&setCorsHeaders](const httplib::Request& /*req*/, httplib::Response& res) {
         setCorsHeaders(res);
@@ -928,54 +1358,33 @@ int main(int argc, char* argv[]) {
     server.Get("/manifest.json", handleStaticFile);
     
     // Fallback для всех остальных файлов (должен быть последним)
-    // Используем паттерн, который не перехватывает /api/
-    server.Get(".*", [&webRoot, &setCorsHeaders](const httplib::Request& req, httplib::Response& res) {
-        // Пропускаем API запросы
-        if (req.path.find("/api/") == 0) {
-            res.status = 404;
-            res.set_content("Not Found", "text/plain");
-            return;
-        }
-        
-        // Пропускаем уже зарегистрированные пути
-        if (req.path == "/" || req.path == "/styles.css" || req.path == "/app.js" || 
-            req.path == "/prayer-calculator.js" || req.path == "/translations.js" || 
-            req.path == "/manifest.json") {
-            res.status = 404;
-            res.set_content("Not Found", "text/plain");
-            return;
-        }
-        
-        std::string path = req.path;
-        std::string filePath = webRoot + path.substr(1);
-        std::cout << "📄 Запрос: " << req.path << " -> файл: " << filePath << std::endl;
-        
-        std::string content = FileService::readFile(filePath);
-        
-        if (content.empty()) {
-            std::cout << "⚠️  Файл не найден: " << filePath << std::endl;
-            res.status = 404;
-            res.set_content("Not Found: " + filePath, "text/plain");
-        } else {
-            std::cout << "✅ Файл найден, размер: " << content.size() << " байт" << std::endl;
-            res.set_content(content, FileService::getMimeType(filePath));
-        }
-        
-        setCorsHeaders(res);
-    });
+    server.Get(".*", handleStaticFile);
     
-    std::cout << "🚀 Сервер запущен на http://localhost:8080\n";
-    std::cout << "📡 Ожидание запросов...\n";
-    std::cout.flush();
+    LOG_INFO("Server") << "🚀 Сервер запущен на http://localhost:8080";
+    LOG_INFO("Server") << "📡 Ожидание запросов...";
+    
+    UpstreamExecutor::start(static_cast<size_t>(upstreamThreads));
+    UpstreamPool::startHealthChecks();
+    if (cityIndexReloadSeconds > 0) CityIndex::startWatching(cityIndexPath, cityIndexReloadSeconds);
+    if (staticWatch) StaticAssets::startWatching();
     
     if (!server.listen("0.0.0.0", 8080)) {
-        std::cerr << "❌ Ошибка запуска сервера на порту 8080!\n";
-        std::cerr.flush();
+        LOG_ERROR("Server") << "❌ Ошибка запуска сервера на порту 8080!";
+        UpstreamExecutor::stop();
+        UpstreamPool::stopHealthChecks();
+        CityIndex::stopWatching();
+        StaticAssets::stopWatching();
+        Logger::stop();
         return 1;
     }
     
-    std::cout << "✅ Сервер остановлен\n";
-    std::cout.flush();
+    UpstreamExecutor::stop();
+    UpstreamPool::stopHealthChecks();
+    CityIndex::stopWatching();
+    StaticAssets::stopWatching();
+    
+    LOG_INFO("Server") << "✅ Сервер остановлен";
+    Logger::stop();
     
     return 0;
 }
\ No newline at end of file
@@ -8,6 +8,7 @@ class PrayerTimesCalculator {
         this.madhhab = 0; // Shafi'i по умолчанию
         this.prayerTimes = {};
         this.selectedDate = new Date();
+        this.monthCache = {}; // Таблицы времени молитв по месяцам (из /api/prayer-times/range)
         
         // Загружаем сохраненные настройки
         this.loadSettings();
@@ -62,7 +63,14 @@ class PrayerTimesCalculator {
             2: "5",  // Egypt
             3: "4",  // Makkah
             4: "1",  // Karachi
-            5: "7"   // Tehran
+            5: "7",  // Tehran
+            6: "9",  // Kuwait
+            7: "10", // Qatar
+            8: "11", // Singapore
+            9: "13", // Turkey
+            10: "16", // Dubai
+            11: "12", // France
+            12: "14"  // Russia
         };
         return methodCodes[this.calculationMethod] || "4";
     }
@@ -75,6 +83,29 @@ class PrayerTimesCalculator {
         return `${year}-${month}-${day}`;
     }
     
+    // Таблица времени молитв за месяц одним запросом (ключ кэша учитывает настройки)
+    async fetchMonthPrayerTimes(year, month) {
+        const key = `${this.latitude},${this.longitude},${this.calculationMethod},${this.madhhab},${year}-${month}`;
+        if (this.monthCache[key]) {
+            return this.monthCache[key];
+        }
+        
+        const apiUrl = window.location.origin;
+        const url = `${apiUrl}/api/prayer-times/range?lat=${this.latitude}&lon=${this.longitude}&method=${this.calculationMethod}&madhhab=${this.madhhab}&year=${year}&month=${month}`;
+        const response = await fetch(url, { headers: { 'Accept': 'application/json' } });
+        const data = await response.json();
+        if (!data.success || !data.data || !Array.isArray(data.data.days)) {
+            throw new Error('Invalid API response');
+        }
+        
+        const days = {};
+        data.data.days.forEach(row => {
+            days[row.date] = row;
+        });
+        this.monthCache[key] = days;
+        return days;
+    }
+    
     // Запрос времени молитв из C++ API
     async fetchPrayerTimes(date = null) {
         const targetDate = date || this.selectedDate;
@@ -82,19 +113,43 @@ class PrayerTimesCalculator {
         const month = targetDate.getMonth() + 1;
         const day = targetDate.getDate();
         
+        // Для других дней (навигация по календарю) берем строку из таблицы месяца:
+        // текущая/следующая молитва для них не нужны, а месяц загружается одним запросом
+        const today = new Date();
+        const isToday = year === today.getFullYear() && month === today.getMonth() + 1 && day === today.getDate();
+        if (!isToday) {
+            try {
+                const days = await this.fetchMonthPrayerTimes(year, month);
+                const row = days[this.formatDateDisplay(targetDate)];
+                if (row) {
+                    this.prayerTimes = {
+                        fajr: row.fajr,
+                        sunrise: row.sunrise,
+                        dhuhr: row.dhuhr,
+                        asr: row.asr,
+                        maghrib: row.maghrib,
+                        isha: row.isha,
+                        date: row.date
+                    };
+                    return this.prayerTimes;
+                }
+            } catch (error) {
+                console.error('Ошибка при получении таблицы месяца:', error);
+            }
+        }
+        
         // Используем локальный C++ API вместо внешнего
         const apiUrl = window.location.origin; // Используем тот же домен
         const url = `${apiUrl}/api/prayer-times?lat=${this.latitude}&lon=${this.longitude}&city=${encodeURIComponent(this.city)}&method=${this.calculationMethod}&madhhab=${this.madhhab}&year=${year}&month=${month}&day=${day}`;
         
         try {
+            // Сервер задает max-age до следующей молитвы и ETag: повторный запрос берется
+            // из кеша браузера или подтверждается ответом 304
             const response = await fetch(url, {
                 method: 'GET',
                 headers: {
-                    'Accept': 'application/json',
-                    'Cache-Control': 'no-cache, no-store, must-revalidate',
-                    'Pragma': 'no-cache'
-                },
-                cache: 'no-store'
+                    'Accept': 'application/json'
+                }
             });
             const data = await response.json();
             
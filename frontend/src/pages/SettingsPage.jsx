@@ -144,6 +144,13 @@ const SettingsPage = () => {
                         <option value="3">Makkah - Umm al-Qura</option>
                         <option value="4">Karachi - Islamic Sciences</option>
                         <option value="5">Tehran - Geophysics</option>
+                        <option value="6">Kuwait</option>
+                        <option value="7">Qatar</option>
+                        <option value="8">Singapore - MUIS</option>
+                        <option value="9">Turkey - Diyanet</option>
+                        <option value="10">Dubai</option>
+                        <option value="11">France - UOIF</option>
+                        <option value="12">Russia - ДУМ</option>
                     </select>
                 </div>
 
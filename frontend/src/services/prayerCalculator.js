@@ -94,14 +94,13 @@ class PrayerTimesCalculator {
         const url = `${getApiUrl('/prayer-times')}?lat=${this.latitude}&lon=${this.longitude}&city=${encodeURIComponent(this.city)}&method=${this.calculationMethod}&madhhab=${this.madhhab}&year=${year}&month=${month}&day=${day}`;
         
         try {
+            // Сервер задает max-age до следующей молитвы и ETag: повторный запрос берется
+            // из кеша браузера или подтверждается ответом 304
             const response = await fetch(url, {
                 method: 'GET',
                 headers: {
-                    'Accept': 'application/json',
-                    'Cache-Control': 'no-cache, no-store, must-revalidate',
-                    'Pragma': 'no-cache'
-                },
-                cache: 'no-store'
+                    'Accept': 'application/json'
+                }
             });
             const data = await response.json();
             
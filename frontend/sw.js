@@ -1,23 +1,20 @@
 // Service Worker для PWA
-const CACHE_NAME = 'jummah-prayer-v1';
-const urlsToCache = [
-    '/',
-    '/index.html',
-    '/styles.css',
-    '/app.js',
-    '/prayer-calculator.js',
-    '/translations.js',
-    '/manifest.json'
-];
+const CACHE_NAME = 'jummah-prayer-v2';
+// Пути с отпечатком содержимого сервер отдает из /api/assets/manifest
+const MANIFEST_URL = '/api/assets/manifest';
+const FINGERPRINTED = /\.[0-9a-f]{12}(\.[^/.]+)?$/;
 
 // Установка Service Worker
 self.addEventListener('install', (event) => {
     event.waitUntil(
-        caches.open(CACHE_NAME)
-            .then((cache) => {
-                console.log('Кеш открыт');
-                return cache.addAll(urlsToCache);
-            })
+        Promise.all([
+            caches.open(CACHE_NAME),
+            fetch(MANIFEST_URL).then((response) => response.json()).catch(() => null)
+        ]).then(([cache, manifest]) => {
+            console.log('Кеш открыт');
+            const assets = manifest && manifest.success ? Object.values(manifest.data.assets) : [];
+            return cache.addAll(['/', ...assets]);
+        })
     );
 });
 
@@ -39,12 +36,38 @@ self.addEventListener('activate', (event) => {
 
 // Перехват запросов
 self.addEventListener('fetch', (event) => {
+    const url = new URL(event.request.url);
+    if (event.request.method !== 'GET' || url.origin !== self.location.origin || url.pathname.startsWith('/api/')) {
+        return;
+    }
+
+    // Файл с отпечатком не меняется: берем из кеша без обращения к сети
+    if (FINGERPRINTED.test(url.pathname)) {
+        event.respondWith(
+            caches.match(event.request).then((cached) => {
+                return cached || fetch(event.request).then((response) => {
+                    if (response.ok) {
+                        const copy = response.clone();
+                        caches.open(CACHE_NAME).then((cache) => cache.put(event.request, copy));
+                    }
+                    return response;
+                });
+            })
+        );
+        return;
+    }
+
+    // Страницы и обычные пути: сначала сеть (ссылки на новые версии), без сети - кеш
     event.respondWith(
-        caches.match(event.request)
+        fetch(event.request)
             .then((response) => {
-                // Возвращаем из кеша или делаем запрос
-                return response || fetch(event.request);
+                if (response.ok) {
+                    const copy = response.clone();
+                    caches.open(CACHE_NAME).then((cache) => cache.put(event.request, copy));
+                }
+                return response;
             })
+            .catch(() => caches.match(event.request))
     );
 });
 